@@ -0,0 +1,513 @@
+#include "File/Codecs/Base64.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define OMNI_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+namespace omnisphere::codecs
+{
+
+namespace
+{
+
+// ---------------------------------------------------------------------------
+// Scalar kernels
+// ---------------------------------------------------------------------------
+
+constexpr char encodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr uint8_t invalid = 0x80;
+
+constexpr std::array<uint8_t, 256> decodeTable = []
+{
+    std::array<uint8_t, 256> t{};
+    for (auto& v : t) v = invalid;
+    for (uint8_t i = 0; i < 64; ++i)
+        t[static_cast<unsigned char>(encodeTable[i])] = i;
+    return t;
+}();
+
+// Encodes whole 3-byte groups; returns the number of input bytes consumed
+size_t EncodeScalar(const unsigned char* in, size_t size, char* out)
+{
+    const size_t groups = size / 3;
+    for (size_t g = 0; g < groups; ++g, in += 3, out += 4)
+    {
+        const uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+        out[0] = encodeTable[(v >> 18) & 0x3F];
+        out[1] = encodeTable[(v >> 12) & 0x3F];
+        out[2] = encodeTable[(v >> 6) & 0x3F];
+        out[3] = encodeTable[v & 0x3F];
+    }
+    return groups * 3;
+}
+
+// Decodes unpadded quads until the input ends or an invalid character shows up.
+// Returns the number of characters consumed (always a multiple of 4).
+size_t DecodeScalar(const char* in, size_t size, unsigned char* out)
+{
+    const size_t quads = size / 4;
+    size_t q = 0;
+    for (; q < quads; ++q, in += 4, out += 3)
+    {
+        const uint8_t a = decodeTable[static_cast<unsigned char>(in[0])];
+        const uint8_t b = decodeTable[static_cast<unsigned char>(in[1])];
+        const uint8_t c = decodeTable[static_cast<unsigned char>(in[2])];
+        const uint8_t d = decodeTable[static_cast<unsigned char>(in[3])];
+        if ((a | b | c | d) & invalid)
+            break;
+        const uint32_t v = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | d;
+        out[0] = static_cast<unsigned char>(v >> 16);
+        out[1] = static_cast<unsigned char>(v >> 8);
+        out[2] = static_cast<unsigned char>(v);
+    }
+    return q * 4;
+}
+
+// ---------------------------------------------------------------------------
+// SIMD kernels (Muła/Lemire lookup-free encoding and nibble-LUT validation).
+// They only cover a prefix of the input and leave the tail and any invalid
+// characters to the scalar loop, which also reports the error.
+// ---------------------------------------------------------------------------
+
+#ifdef OMNI_BASE64_X86
+
+__attribute__((target("sse4.1")))
+inline __m128i EncodeLookupSse(__m128i indices)
+{
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+}
+
+__attribute__((target("sse4.1")))
+size_t EncodeSse41(const unsigned char* in, size_t size, char* out)
+{
+    const unsigned char* start = in;
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    // Each iteration loads 16 bytes and consumes 12
+    while (size >= 16)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), shuffle);
+        const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), EncodeLookupSse(_mm_or_si128(t0, t1)));
+        in += 12;
+        out += 16;
+        size -= 12;
+    }
+    return static_cast<size_t>(in - start);
+}
+
+__attribute__((target("sse4.1")))
+size_t DecodeSse41(const char* in, size_t size, unsigned char* out)
+{
+    const char* start = in;
+    const __m128i lutLo   = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                          0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lutHi   = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                          0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask2F  = _mm_set1_epi8(0x2F);
+    const __m128i pack    = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    // Each iteration loads 16 characters and stores 16 bytes of which 12 are
+    // valid; keeping 8 characters in reserve guarantees room for the overrun.
+    while (size >= 24)
+    {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+        const __m128i loNibbles = _mm_and_si128(str, mask2F);
+        const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+        const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+        if (!_mm_testz_si128(lo, hi))
+            break;
+
+        const __m128i eq2F = _mm_cmpeq_epi8(str, mask2F);
+        str = _mm_add_epi8(str, _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles)));
+
+        const __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(packed, pack));
+        in += 16;
+        out += 12;
+        size -= 16;
+    }
+    return static_cast<size_t>(in - start);
+}
+
+__attribute__((target("avx2")))
+size_t EncodeAvx2(const unsigned char* in, size_t size, char* out)
+{
+    const unsigned char* start = in;
+    const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                           'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    // Each iteration reads 28 bytes (two overlapping 16-byte lanes) and consumes 24
+    while (size >= 28)
+    {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        v = _mm256_shuffle_epi8(v, shuffle);
+
+        const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+        const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t0, t1);
+
+        __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        result = _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);
+        in += 24;
+        out += 32;
+        size -= 24;
+    }
+    return static_cast<size_t>(in - start);
+}
+
+__attribute__((target("avx2")))
+size_t DecodeAvx2(const char* in, size_t size, unsigned char* out)
+{
+    const char* start = in;
+    const __m256i lutLo   = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                             0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                             0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                             0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lutHi   = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                             0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask2F  = _mm256_set1_epi8(0x2F);
+    const __m256i pack    = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                             2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i lanes   = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    // 32 characters in, 32 bytes stored of which 24 are valid; 16 characters
+    // stay in reserve so the 8-byte overrun always lands inside `out`.
+    while (size >= 48)
+    {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+        const __m256i loNibbles = _mm256_and_si256(str, mask2F);
+        const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+
+        const __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+        str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles)));
+
+        const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        packed = _mm256_shuffle_epi8(packed, pack);
+        packed = _mm256_permutevar8x32_epi32(packed, lanes);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+        in += 32;
+        out += 24;
+        size -= 32;
+    }
+    return static_cast<size_t>(in - start);
+}
+
+#endif // OMNI_BASE64_X86
+
+// ---------------------------------------------------------------------------
+// Runtime dispatch
+// ---------------------------------------------------------------------------
+
+size_t EncodeNone(const unsigned char*, size_t, char*) { return 0; }
+size_t DecodeNone(const char*, size_t, unsigned char*) { return 0; }
+
+struct Kernels
+{
+    size_t (*Encode)(const unsigned char*, size_t, char*) = EncodeNone;
+    size_t (*Decode)(const char*, size_t, unsigned char*) = DecodeNone;
+    const char* Name = "scalar";
+};
+
+const Kernels& ActiveKernels()
+{
+    static const Kernels kernels = []
+    {
+        Kernels k;
+#ifdef OMNI_BASE64_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            k.Encode = EncodeAvx2;
+            k.Decode = DecodeAvx2;
+            k.Name   = "avx2";
+        }
+        else if (__builtin_cpu_supports("sse4.1"))
+        {
+            k.Encode = EncodeSse41;
+            k.Decode = DecodeSse41;
+            k.Name   = "sse4.1";
+        }
+#endif
+        return k;
+    }();
+    return kernels;
+}
+
+// Decodes the final quad, which may carry one or two '=' characters.
+// Returns the number of bytes written or -1 when the quad is malformed.
+int DecodeFinalQuad(const char* in, unsigned char* out)
+{
+    const uint8_t a = decodeTable[static_cast<unsigned char>(in[0])];
+    const uint8_t b = decodeTable[static_cast<unsigned char>(in[1])];
+    if ((a | b) & invalid)
+        return -1;
+
+    if (in[2] == '=')
+    {
+        // "xx==": the low 4 bits of b must be zero for a canonical encoding
+        if (in[3] != '=' || (b & 0x0F))
+            return -1;
+        out[0] = static_cast<unsigned char>((a << 2) | (b >> 4));
+        return 1;
+    }
+
+    const uint8_t c = decodeTable[static_cast<unsigned char>(in[2])];
+    if (c & invalid)
+        return -1;
+
+    if (in[3] == '=')
+    {
+        if (c & 0x03)
+            return -1;
+        out[0] = static_cast<unsigned char>((a << 2) | (b >> 4));
+        out[1] = static_cast<unsigned char>((b << 4) | (c >> 2));
+        return 2;
+    }
+
+    const uint8_t d = decodeTable[static_cast<unsigned char>(in[3])];
+    if (d & invalid)
+        return -1;
+    out[0] = static_cast<unsigned char>((a << 2) | (b >> 4));
+    out[1] = static_cast<unsigned char>((b << 4) | (c >> 2));
+    out[2] = static_cast<unsigned char>((c << 6) | d);
+    return 3;
+}
+
+// Decodes a whole number of quads where only the last one may be padded.
+// Sets `padded` when it was. Returns false on malformed input.
+bool DecodeQuads(const char* in, size_t size, unsigned char* out, size_t& written, bool& padded)
+{
+    written = 0;
+    padded  = false;
+    if (size == 0)
+        return true;
+
+    const size_t body = size - 4;
+    size_t done = ActiveKernels().Decode(in, body, out);
+    done += DecodeScalar(in + done, body - done, out + done / 4 * 3);
+    if (done != body)
+        return false;
+
+    const int tail = DecodeFinalQuad(in + body, out + body / 4 * 3);
+    if (tail < 0)
+        return false;
+
+    padded  = tail < 3;
+    written = body / 4 * 3 + static_cast<size_t>(tail);
+    return true;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Base64
+// ---------------------------------------------------------------------------
+
+void Base64::Encode(const unsigned char* data, size_t size, char* out)
+{
+    size_t done = ActiveKernels().Encode(data, size, out);
+    done += EncodeScalar(data + done, size - done, out + done / 3 * 4);
+
+    const size_t rest = size - done;
+    if (rest == 0)
+        return;
+
+    char* tail = out + done / 3 * 4;
+    const uint32_t v = (uint32_t(data[done]) << 16) | (rest == 2 ? uint32_t(data[done + 1]) << 8 : 0);
+    tail[0] = encodeTable[(v >> 18) & 0x3F];
+    tail[1] = encodeTable[(v >> 12) & 0x3F];
+    tail[2] = rest == 2 ? encodeTable[(v >> 6) & 0x3F] : '=';
+    tail[3] = '=';
+}
+
+std::string Base64::Encode(const unsigned char* data, size_t size)
+{
+    std::string out(EncodedLength(size), '\0');
+    Encode(data, size, out.data());
+    return out;
+}
+
+bool Base64::Decode(const char* data, size_t size, unsigned char* out, size_t& written)
+{
+    written = 0;
+    if (size % 4 != 0)
+        return false;
+    bool padded = false;
+    return DecodeQuads(data, size, out, written, padded);
+}
+
+std::vector<unsigned char> Base64::Decode(std::string_view text)
+{
+    std::vector<unsigned char> out(DecodedMaxLength(text.size()));
+    size_t written = 0;
+    if (!Decode(text.data(), text.size(), out.data(), written))
+        throw std::invalid_argument("Invalid Base64 input");
+    out.resize(written);
+    return out;
+}
+
+const char* Base64::Implementation()
+{
+    return ActiveKernels().Name;
+}
+
+// ---------------------------------------------------------------------------
+// Base64Encoder
+// ---------------------------------------------------------------------------
+
+void Base64Encoder::Update(const unsigned char* data, size_t size, std::string& out)
+{
+    // Complete the group left over from the previous chunk
+    if (pendingSize > 0)
+    {
+        while (pendingSize < 3 && size > 0)
+        {
+            pending[pendingSize++] = *data++;
+            --size;
+        }
+        if (pendingSize < 3)
+            return;
+
+        const size_t at = out.size();
+        out.resize(at + 4);
+        Base64::Encode(pending, 3, out.data() + at);
+        pendingSize = 0;
+    }
+
+    const size_t whole = size - size % 3;
+    if (whole > 0)
+    {
+        const size_t at = out.size();
+        out.resize(at + Base64::EncodedLength(whole));
+        Base64::Encode(data, whole, out.data() + at);
+    }
+
+    for (size_t i = whole; i < size; ++i)
+        pending[pendingSize++] = data[i];
+}
+
+void Base64Encoder::Finish(std::string& out)
+{
+    if (pendingSize > 0)
+    {
+        const size_t at = out.size();
+        out.resize(at + 4);
+        Base64::Encode(pending, pendingSize, out.data() + at);
+    }
+    pendingSize = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Base64Decoder
+// ---------------------------------------------------------------------------
+
+void Base64Decoder::Update(const char* data, size_t size, std::vector<unsigned char>& out)
+{
+    const size_t at = out.size();
+    out.resize(at + Base64::DecodedMaxLength(size + pendingSize));
+    const size_t written = Update(data, size, out.data() + at);
+    out.resize(at + written);
+}
+
+size_t Base64Decoder::Update(const char* data, size_t size, unsigned char* out)
+{
+    if (size == 0)
+        return 0;
+    if (padded)
+        throw std::invalid_argument("Invalid Base64 input: data after padding at offset " + std::to_string(consumed));
+
+    size_t written = 0;
+    bool quadPadded = false;
+
+    // Complete the quad left over from the previous chunk
+    if (pendingSize > 0)
+    {
+        const size_t take = std::min(4 - pendingSize, size);
+        std::memcpy(pending + pendingSize, data, take);
+        pendingSize += take;
+        data += take;
+        size -= take;
+        if (pendingSize < 4)
+            return 0;
+
+        size_t n = 0;
+        if (!DecodeQuads(pending, 4, out, n, quadPadded))
+            throw std::invalid_argument("Invalid Base64 input near offset " + std::to_string(consumed));
+        consumed += 4;
+        written += n;
+        pendingSize = 0;
+        if (quadPadded)
+        {
+            padded = true;
+            if (size > 0)
+                throw std::invalid_argument("Invalid Base64 input: data after padding at offset " + std::to_string(consumed));
+            return written;
+        }
+    }
+
+    const size_t whole = size - size % 4;
+    if (whole > 0)
+    {
+        size_t n = 0;
+        if (!DecodeQuads(data, whole, out + written, n, quadPadded))
+            throw std::invalid_argument("Invalid Base64 input near offset " + std::to_string(consumed));
+        consumed += whole;
+        written += n;
+        if (quadPadded)
+        {
+            padded = true;
+            if (size > whole)
+                throw std::invalid_argument("Invalid Base64 input: data after padding at offset " + std::to_string(consumed));
+            return written;
+        }
+    }
+
+    pendingSize = size - whole;
+    std::memcpy(pending, data + whole, pendingSize);
+    return written;
+}
+
+void Base64Decoder::Finish()
+{
+    const bool truncated = pendingSize != 0;
+    pendingSize = 0;
+    padded      = false;
+    consumed    = 0;
+    if (truncated)
+        throw std::invalid_argument("Invalid Base64 input: truncated quad at end of stream");
+}
+
+} // namespace omnisphere::codecs
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace omnisphere::codecs
+{
+    // Standard (RFC 4648) Base64 with strict validation: the alphabet is A-Z a-z 0-9 + /,
+    // input length must be a multiple of 4 and '=' may only pad the final quad.
+    // Bulk work runs on AVX2 or SSE4.1 when the CPU supports it, otherwise on a scalar loop.
+    class Base64
+    {
+    public:
+        static constexpr size_t EncodedLength(size_t size) { return ((size + 2) / 3) * 4; }
+
+        // Upper bound for the decoded size of `size` Base64 characters
+        static constexpr size_t DecodedMaxLength(size_t size) { return (size / 4) * 3; }
+
+        // Writes exactly EncodedLength(size) characters to `out`
+        static void Encode(const unsigned char* data, size_t size, char* out);
+
+        static std::string Encode(const unsigned char* data, size_t size);
+
+        // `out` must hold DecodedMaxLength(size) bytes. Returns false on malformed input.
+        static bool Decode(const char* data, size_t size, unsigned char* out, size_t& written);
+
+        // Throws std::invalid_argument on malformed input
+        static std::vector<unsigned char> Decode(std::string_view text);
+
+        // Name of the kernel picked at startup: "avx2", "sse4.1" or "scalar"
+        static const char* Implementation();
+    };
+
+    // Incremental encoder for chunked I/O. Bytes that do not complete a 3-byte group are
+    // held back until the next Update or Finish, so concatenated output equals Base64::Encode.
+    class Base64Encoder
+    {
+    public:
+        // Appends the Base64 text for every complete group to `out`
+        void Update(const unsigned char* data, size_t size, std::string& out);
+
+        // Flushes the held-back bytes with padding and resets the encoder
+        void Finish(std::string& out);
+
+    private:
+        unsigned char pending[3] = {};
+        size_t pendingSize = 0;
+    };
+
+    // Incremental strict decoder for chunked I/O; chunk boundaries may fall anywhere.
+    // Throws std::invalid_argument on malformed input.
+    class Base64Decoder
+    {
+    public:
+        // Appends the decoded bytes of every complete quad to `out`
+        void Update(const char* data, size_t size, std::vector<unsigned char>& out);
+
+        // Same, writing to a caller buffer of at least DecodedMaxLength(size + 3) bytes.
+        // Returns the number of bytes written.
+        size_t Update(const char* data, size_t size, unsigned char* out);
+
+        // Fails if the input ended in the middle of a quad, then resets the decoder
+        void Finish();
+
+    private:
+        char pending[4] = {};
+        size_t pendingSize = 0;
+        bool padded = false;
+        size_t consumed = 0;
+    };
+} // namespace omnisphere::codecs
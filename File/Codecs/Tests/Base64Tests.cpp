@@ -0,0 +1,200 @@
+// Round-trip and validation tests for File/Codecs/Base64. Exercises the kernel picked for
+// this CPU (see Base64::Implementation) and the streaming encoder and decoder.
+// Prints each failure and exits non-zero if there was any.
+
+#include "File/Codecs/Base64.hpp"
+#include "File/Codecs/Tests/LegacyBase64.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using omnisphere::codecs::Base64;
+using omnisphere::codecs::Base64Decoder;
+using omnisphere::codecs::Base64Encoder;
+
+namespace
+{
+
+constexpr size_t maxLength = 1024;      // Every length up to this, so each kernel tail is hit
+constexpr int fuzzRounds   = 20000;
+
+int failures = 0;
+
+void Fail(const char* what, size_t length)
+{
+    std::fprintf(stderr, "FAIL %s (length %zu)\n", what, length);
+    if (++failures >= 10)
+        std::exit(1);
+}
+
+bool Rejects(std::string_view text)
+{
+    try
+    {
+        Base64::Decode(text);
+    }
+    catch (const std::invalid_argument&)
+    {
+        return true;
+    }
+    return false;
+}
+
+bool StreamRejects(std::string_view text, size_t split)
+{
+    try
+    {
+        Base64Decoder decoder;
+        std::vector<unsigned char> out;
+        decoder.Update(text.data(), std::min(split, text.size()), out);
+        if (split < text.size())
+            decoder.Update(text.data() + split, text.size() - split, out);
+        decoder.Finish();
+    }
+    catch (const std::invalid_argument&)
+    {
+        return true;
+    }
+    return false;
+}
+
+std::vector<unsigned char> RandomBytes(std::mt19937& rng, size_t length)
+{
+    std::vector<unsigned char> bytes(length);
+    for (auto& b : bytes)
+        b = static_cast<unsigned char>(rng());
+    return bytes;
+}
+
+// Every length 0..maxLength: matches the old encoder, decodes back, and the fixed-size entry
+// points agree with EncodedLength / DecodedMaxLength
+void RoundTripAllLengths(std::mt19937& rng)
+{
+    for (size_t length = 0; length <= maxLength; ++length)
+    {
+        const std::vector<unsigned char> bytes = RandomBytes(rng, length);
+        const std::string text = Base64::Encode(bytes.data(), bytes.size());
+
+        std::string legacy;
+        omnisphere::codecs::tests::LegacyEncode(bytes.data(), bytes.size(), legacy);
+        if (text != legacy)
+            Fail("encode differs from the old codec", length);
+        if (text.size() != Base64::EncodedLength(length))
+            Fail("EncodedLength", length);
+        if (Base64::Decode(text) != bytes)
+            Fail("round trip", length);
+
+        std::vector<unsigned char> out(Base64::DecodedMaxLength(text.size()));
+        size_t written = 0;
+        if (!Base64::Decode(text.data(), text.size(), out.data(), written) || written != length ||
+            !std::equal(bytes.begin(), bytes.end(), out.begin()))
+            Fail("buffer decode", length);
+    }
+}
+
+// Random chunk boundaries through Base64Encoder and Base64Decoder
+void StreamingSplits(std::mt19937& rng)
+{
+    for (int round = 0; round < fuzzRounds; ++round)
+    {
+        const size_t length = rng() % maxLength;
+        const std::vector<unsigned char> bytes = RandomBytes(rng, length);
+        const std::string text = Base64::Encode(bytes.data(), bytes.size());
+
+        Base64Encoder encoder;
+        std::string streamed;
+        for (size_t pos = 0; pos < length;)
+        {
+            const size_t chunk = std::min<size_t>(rng() % 64, length - pos);
+            encoder.Update(bytes.data() + pos, chunk, streamed);
+            pos += chunk;
+        }
+        encoder.Finish(streamed);
+        if (streamed != text)
+            Fail("streaming encode", length);
+
+        Base64Decoder decoder;
+        std::vector<unsigned char> decoded;
+        for (size_t pos = 0; pos < text.size();)
+        {
+            const size_t chunk = std::min<size_t>(rng() % 96, text.size() - pos);
+            decoder.Update(text.data() + pos, chunk, decoded);
+            pos += chunk;
+        }
+        decoder.Finish();
+        if (decoded != bytes)
+            Fail("streaming decode", length);
+    }
+}
+
+// One character replaced by something outside the alphabet, anywhere in the text
+void CorruptedInput(std::mt19937& rng)
+{
+    static const char invalid[] = "!*-_ \n.\t\x80\xff";
+    for (int round = 0; round < fuzzRounds; ++round)
+    {
+        const size_t length = 1 + rng() % maxLength;
+        const std::vector<unsigned char> bytes = RandomBytes(rng, length);
+        std::string text = Base64::Encode(bytes.data(), bytes.size());
+        text[rng() % text.size()] = invalid[rng() % (sizeof(invalid) - 1)];
+
+        if (!Rejects(text))
+            Fail("corrupted text accepted", length);
+        if (!StreamRejects(text, rng() % (text.size() + 1)))
+            Fail("corrupted text accepted by the stream decoder", length);
+    }
+}
+
+void Padding()
+{
+    struct Case
+    {
+        const char* Text;
+        bool Valid;
+    };
+    const Case cases[] = {
+        {"", true},         {"QQ==", true},     {"QUI=", true},     {"QUJD", true},
+        {"QUJDRA==", true}, {"QR==", false},    {"QUJ=", false},    {"Q===", false},
+        {"====", false},    {"QQ=", false},     {"QQ", false},      {"Q", false},
+        {"=QQQ", false},    {"Q=QQ", false},    {"QQ=Q", false},    {"QQ==QQ==", false},
+        {"QUI=QUJD", false}, {"QUJD=", false},  {"QUJDR", false},   {"QUJD\n", false},
+    };
+    for (const Case& c : cases)
+    {
+        const std::string_view text(c.Text);
+        if (Rejects(text) == c.Valid)
+            Fail(c.Valid ? "valid padding rejected" : "invalid padding accepted", text.size());
+        for (size_t split = 0; split <= text.size(); ++split)
+            if (StreamRejects(text, split) == c.Valid)
+                Fail(c.Valid ? "valid padding rejected by the stream decoder"
+                             : "invalid padding accepted by the stream decoder", text.size());
+    }
+
+    // The buffer entry point reports instead of throwing
+    std::vector<unsigned char> out(8);
+    size_t written = 0;
+    if (Base64::Decode("QR==", 4, out.data(), written))
+        Fail("buffer decode accepted non-canonical padding", 4);
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 rng(0x0B64);
+    std::printf("Base64 kernel: %s\n", Base64::Implementation());
+
+    RoundTripAllLengths(rng);
+    StreamingSplits(rng);
+    CorruptedInput(rng);
+    Padding();
+
+    if (failures)
+        return 1;
+    std::printf("OK\n");
+    return 0;
+}
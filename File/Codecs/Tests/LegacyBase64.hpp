@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace omnisphere::codecs::tests
+{
+    // The codec File.cpp used before File/Codecs/Base64, kept as the reference for the
+    // round-trip test and the baseline of the benchmark. Its decoder stops at the first
+    // character outside the alphabet instead of rejecting the input.
+    inline void LegacyEncode(const unsigned char* data, size_t size, std::string& out)
+    {
+        static const char lookup[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        out.clear();
+        out.reserve(((size + 2) / 3) * 4);
+        int val = 0, valb = -6;
+        for (size_t i = 0; i < size; ++i)
+        {
+            val  = (val << 8) + data[i];
+            valb += 8;
+            while (valb >= 0)
+            {
+                out.push_back(lookup[(val >> valb) & 0x3F]);
+                valb -= 6;
+            }
+        }
+        if (valb > -6) out.push_back(lookup[((val << 8) >> (valb + 8)) & 0x3F]);
+        while (out.size() % 4) out.push_back('=');
+    }
+
+    inline std::vector<unsigned char> LegacyDecode(std::string_view in)
+    {
+        std::vector<unsigned char> out;
+        std::vector<int> T(256, -1);
+        for (int i = 0; i < 64; i++)
+            T[static_cast<unsigned char>("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[i])] = i;
+        int val = 0, valb = -8;
+        for (unsigned char c : in)
+        {
+            if (T[c] == -1) break;
+            val  = (val << 6) + T[c];
+            valb += 6;
+            if (valb >= 0)
+            {
+                out.push_back(static_cast<unsigned char>((val >> valb) & 0xFF));
+                valb -= 8;
+            }
+        }
+        return out;
+    }
+} // namespace omnisphere::codecs::tests
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace omnisphere::dtos
+{
+    struct AppendUpload
+    {
+        std::string UploadId;
+        uint64_t Offset = 0;    // Where Data goes in the file; chunks may come in any order
+        std::string Data;       // Base64 encoded chunk
+    };
+} // namespace omnisphere::dtos
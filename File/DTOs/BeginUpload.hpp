@@ -0,0 +1,17 @@
+#pragma once
+#include "File/Enums/FsyncPolicy.hpp"
+#include <cstdint>
+#include <string>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    struct BeginUpload
+    {
+        std::string FileName;
+        std::optional<std::string> Path;
+        uint64_t Size = 0;                      // Total size of the file in bytes
+        std::optional<std::string> ContentHash; // BLAKE2b hex, verified on commit
+        std::optional<omnisphere::enums::FsyncPolicy> Durability; // Defaults to FsyncPolicy::File
+    };
+} // namespace omnisphere::dtos
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    struct ConfigureContentCache
+    {
+        bool Enabled = true;
+        std::optional<std::string> Directory;                   // Default ~/.cache/omnisphere/content
+        std::optional<uint64_t> MaxBytes;                       // Default 2 GiB
+        std::optional<uint32_t> RevalidateSeconds;              // Default 30
+        std::optional<std::vector<std::string>> RemotePrefixes; // Extra paths treated as network-backed
+    };
+} // namespace omnisphere::dtos
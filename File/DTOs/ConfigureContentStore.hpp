@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace omnisphere::dtos
+{
+    struct ConfigureContentStore
+    {
+        std::vector<std::string> Directories; // One per filesystem; others get a .omnisphere-store at the top of the filesystem
+    };
+} // namespace omnisphere::dtos
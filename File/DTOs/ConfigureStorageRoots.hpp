@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    // Only the paths that are set change; an empty string removes that root
+    struct ConfigureStorageRoots
+    {
+        std::optional<std::string> ImagePath;
+        std::optional<std::string> PDFPath;
+        std::optional<std::string> XMLPath;
+    };
+} // namespace omnisphere::dtos
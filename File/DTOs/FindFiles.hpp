@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    // Looks names up in the filename index of the configured storage roots
+    struct FindFiles
+    {
+        std::string Query;                                  // Case-insensitive (ASCII)
+        std::optional<bool> Substring;                      // Default: names starting with Query
+        std::optional<std::vector<std::string>> Roots;      // "ImagePath", "PDFPath", "XMLPath"; default all
+        std::optional<bool> IncludeDirectories;             // Default true
+        std::optional<size_t> MaxResults;                   // Default 1000
+    };
+} // namespace omnisphere::dtos
@@ -10,5 +10,7 @@ namespace omnisphere::dtos
         std::optional<std::string> Username;
         std::optional<std::string> Password;
         std::optional<std::string> Domain;
+        std::optional<bool> IncludeMetadata;    // Fill DirectoryItem Size and ModifiedAt (one statx per entry)
+        std::optional<bool> ForceRefresh;   // Bypass the listing cache and re-read the directory
     };
 } // namespace omnisphere::dtos
@@ -0,0 +1,24 @@
+#pragma once
+#include "File/Enums/DirectorySortKey.hpp"
+#include <cstddef>
+#include <string>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    struct ListDirectoryPage
+    {
+        std::optional<std::string> Path;
+        std::optional<std::string> Username;
+        std::optional<std::string> Password;
+        std::optional<std::string> Domain;
+        std::optional<size_t> PageSize;                 // Default 200, at most 5000
+        std::optional<std::string> ContinuationToken;   // From the previous page
+        std::optional<std::string> NamePrefix;          // Case-insensitive
+        std::optional<std::string> NameGlob;            // Case-insensitive, '*' and '?'
+        std::optional<bool> IncludeFiles;               // Default: directories only
+        std::optional<bool> IncludeMetadata;
+        std::optional<omnisphere::enums::DirectorySortKey> SortBy;
+        std::optional<bool> Descending;
+    };
+} // namespace omnisphere::dtos
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    struct ListTree
+    {
+        std::optional<std::string> Path;
+        std::optional<std::string> Username;
+        std::optional<std::string> Password;
+        std::optional<std::string> Domain;
+        std::optional<int> MaxDepth;                    // Default 8, at most 64; 0 lists only Path
+        std::optional<std::string> NamePrefix;          // Case-insensitive, applies to reported entries
+        std::optional<std::string> NameGlob;            // Case-insensitive, '*' and '?'
+        std::optional<bool> IncludeFiles;               // Default: directories only
+        std::optional<bool> IncludeMetadata;
+        std::optional<bool> IncludeAggregates;          // FileCount and TotalBytes per directory
+        std::optional<size_t> MaxConcurrencyPerMount;   // Network mounts only, default 4
+    };
+} // namespace omnisphere::dtos
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    struct ReadFileChunked
+    {
+        std::string FileName;
+        std::optional<std::string> Path;
+        std::optional<uint64_t> Offset;    // First byte to read (default 0)
+        std::optional<uint64_t> Length;    // Bytes to read (default: up to EOF)
+        std::optional<size_t> ChunkSize;   // Raw bytes per chunk (default 1 MiB)
+        std::optional<bool> Base64;        // Encode each chunk as Base64 text
+    };
+} // namespace omnisphere::dtos
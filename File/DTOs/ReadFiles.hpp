@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    struct ReadFiles
+    {
+        std::vector<std::string> FileNames;
+        std::optional<std::string> Path;        // Resolved once for the whole batch
+        std::optional<bool> Binary;             // Return Bytes instead of a data URL
+        std::optional<size_t> MaxParallel;      // Default 8
+    };
+} // namespace omnisphere::dtos
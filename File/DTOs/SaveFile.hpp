@@ -1,4 +1,5 @@
 #pragma once
+#include "File/Enums/FsyncPolicy.hpp"
 #include <string>
 #include <optional>
 
@@ -9,5 +10,9 @@ namespace omnisphere::dtos
         std::string FileName;
         std::optional<std::string> Path;
         std::string Content; // Base64 encoded content
+        std::optional<omnisphere::enums::FsyncPolicy> Durability; // Defaults to FsyncPolicy::File
+        std::optional<bool> Deduplicate;        // Store the content once by hash and hard-link the file to it
+        std::optional<std::string> ContentHash; // BLAKE2b hex; checked against Content, or with no Content links stored content
+        std::optional<std::string> ContentSource; // With ContentHash and no Content: full path of a readable file already holding that content
     };
 } // namespace omnisphere::dtos
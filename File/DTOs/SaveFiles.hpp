@@ -0,0 +1,18 @@
+#pragma once
+#include "File/DTOs/SaveFile.hpp"
+#include "File/Enums/FsyncPolicy.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace omnisphere::dtos
+{
+    struct SaveFiles
+    {
+        std::vector<SaveFile> Files;            // Path and Durability of each file are taken from the batch
+        std::optional<std::string> Path;        // Resolved once for the whole batch
+        std::optional<omnisphere::enums::FsyncPolicy> Durability; // Defaults to FsyncPolicy::File
+        std::optional<size_t> MaxParallel;      // Default 8
+    };
+} // namespace omnisphere::dtos
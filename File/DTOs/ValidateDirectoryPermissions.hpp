@@ -1,10 +1,12 @@
 #pragma once
 #include <string>
+#include <optional>
 
 namespace omnisphere::dtos
 {
     struct ValidateDirectoryPermissions
     {
         std::string Path;
+        std::optional<bool> ForceRefresh;   // Check again even if a cached result is still fresh
     };
 } // namespace omnisphere::dtos
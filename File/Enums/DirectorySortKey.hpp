@@ -0,0 +1,7 @@
+#pragma once
+
+namespace omnisphere::enums
+{
+    // None keeps filesystem order, which is the cheapest to page through
+    enum class DirectorySortKey { None, Name, ModifiedAt };
+} // namespace omnisphere::enums
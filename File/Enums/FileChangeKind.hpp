@@ -0,0 +1,9 @@
+#pragma once
+
+namespace omnisphere::enums
+{
+    // What happened to a path under a watched directory. Rescan means events were lost
+    // (a queue overflowed or the directory could not be followed) and the subscriber
+    // should list the directory again instead of trusting its own picture of it.
+    enum class FileChangeKind { Created, Modified, Deleted, Rescan };
+} // namespace omnisphere::enums
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace omnisphere::enums
+{
+    // Type of a directory entry after following symlinks; Symlink only remains for dangling links
+    enum class FileType { Unknown, Directory, File, Symlink, Other };
+} // namespace omnisphere::enums
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace omnisphere::enums
+{
+    // How hard a save waits for the data to reach stable storage. None leaves it to the
+    // page cache, File fsyncs the new file before the rename, FileAndDirectory also fsyncs
+    // the parent directory so the rename itself survives a power loss.
+    enum class FsyncPolicy { None, File, FileAndDirectory };
+} // namespace omnisphere::enums
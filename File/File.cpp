@@ -1,10 +1,23 @@
 #include "File/File.hpp"
+#include "File/Codecs/Base64.hpp"
+#include "File/Repositories/AtomicFile.hpp"
+#include "File/Repositories/ContentCache.hpp"
+#include "File/Repositories/ContentHash.hpp"
+#include "File/Repositories/ContentStore.hpp"
 #include "File/Repositories/File.hpp"
+#include "File/Repositories/FilenameIndex.hpp"
+#include "File/Repositories/FileWatcher.hpp"
+#include "File/Repositories/StorageRoots.hpp"
+#include "File/Repositories/UploadSessions.hpp"
+#include "File/Repositories/WorkStealingPool.hpp"
 #include <filesystem>
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <chrono>
 #include <cctype>
+#include <set>
+#include <string_view>
 
 namespace fs = std::filesystem;
 
@@ -30,44 +43,28 @@ File::~File() = default;
 
 std::string File::Base64Encode(const std::vector<unsigned char>& data)
 {
-    static const char lookup[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string out;
-    out.reserve(((data.size() + 2) / 3) * 4);
-    int val = 0, valb = -6;
-    for (unsigned char c : data)
-    {
-        val  = (val << 8) + c;
-        valb += 8;
-        while (valb >= 0)
-        {
-            out.push_back(lookup[(val >> valb) & 0x3F]);
-            valb -= 6;
-        }
-    }
-    if (valb > -6) out.push_back(lookup[((val << 8) >> (valb + 8)) & 0x3F]);
-    while (out.size() % 4) out.push_back('=');
-    return out;
+    return omnisphere::codecs::Base64::Encode(data.data(), data.size());
+}
+
+void File::Base64Encode(const unsigned char* data, size_t size, std::string& out)
+{
+    out.resize(omnisphere::codecs::Base64::EncodedLength(size));
+    omnisphere::codecs::Base64::Encode(data, size, out.data());
 }
 
 std::vector<unsigned char> File::Base64Decode(const std::string& in)
 {
-    std::vector<unsigned char> out;
-    std::vector<int> T(256, -1);
-    for (int i = 0; i < 64; i++)
-        T[static_cast<unsigned char>("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[i])] = i;
-    int val = 0, valb = -8;
-    for (unsigned char c : in)
-    {
-        if (T[c] == -1) break;
-        val  = (val << 6) + T[c];
-        valb += 6;
-        if (valb >= 0)
-        {
-            out.push_back(static_cast<unsigned char>((val >> valb) & 0xFF));
-            valb -= 8;
-        }
-    }
-    return out;
+    return omnisphere::codecs::Base64::Decode(in);
+}
+
+std::string File::BuildFullPath(const std::optional<std::string>& path, const std::string& fileName)
+{
+    std::string resolved = ResolvePath(path.value_or(""));
+    if (!resolved.empty() && fs::is_directory(resolved))
+        return (fs::path(resolved) / fileName).string();
+    if (!resolved.empty())
+        return resolved;
+    return fileName;
 }
 
 std::string File::DetectMimeType(const std::string& fileName)
@@ -112,6 +109,70 @@ std::vector<omnisphere::models::DirectoryItem> File::ListDirectory(const omnisph
     }
 }
 
+// ---------------------------------------------------------------------------
+// ListDirectoryAsync
+// ---------------------------------------------------------------------------
+
+std::future<std::vector<omnisphere::models::DirectoryItem>> File::ListDirectoryAsync(const omnisphere::dtos::ListDirectory& input) const
+{
+    auto promise = std::make_shared<std::promise<std::vector<omnisphere::models::DirectoryItem>>>();
+    auto future  = promise->get_future();
+    try
+    {
+        // The task gets its own (stateless) service so it may outlive this instance
+        pimpl->repo.WhenReachable(input.Path.value_or(""), input.Username.value_or(""), input.Password.value_or(""),
+                                  input.Domain.value_or(""), [promise, input]
+        {
+            try
+            {
+                promise->set_value(File().ListDirectory(input));
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        });
+    }
+    catch (const std::exception& e)
+    {
+        promise->set_exception(std::make_exception_ptr(std::runtime_error(std::string("[File::ListDirectoryAsync] ") + e.what())));
+    }
+    return future;
+}
+
+// ---------------------------------------------------------------------------
+// ListDirectoryPage
+// ---------------------------------------------------------------------------
+
+omnisphere::models::DirectoryPage File::ListDirectoryPage(const omnisphere::dtos::ListDirectoryPage& input) const
+{
+    try
+    {
+        return pimpl->repo.ReadDirPage(input);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ListDirectoryPage] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ListTree
+// ---------------------------------------------------------------------------
+
+omnisphere::models::TreeSummary File::ListTree(const omnisphere::dtos::ListTree& input,
+                                               const std::function<bool(omnisphere::models::TreeDirectory&&)>& callback) const
+{
+    try
+    {
+        return pimpl->repo.ReadTree(input, callback);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ListTree] ") + e.what());
+    }
+}
+
 // ---------------------------------------------------------------------------
 // ValidateDirectoryPermissions
 // ---------------------------------------------------------------------------
@@ -128,6 +189,19 @@ omnisphere::models::DirectoryPermissions File::ValidateDirectoryPermissions(cons
     }
 }
 
+std::vector<omnisphere::models::DirectoryPermissions> File::ValidateDirectoryPermissions(const std::vector<std::string>& paths,
+                                                                                         bool forceRefresh) const
+{
+    try
+    {
+        return pimpl->repo.TestPermissions(paths, forceRefresh);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ValidateDirectoryPermissions] ") + e.what());
+    }
+}
+
 // ---------------------------------------------------------------------------
 // ConnectNetworkShare
 // ---------------------------------------------------------------------------
@@ -148,6 +222,159 @@ std::string File::ConnectNetworkShare(const omnisphere::dtos::ConnectNetworkShar
     }
 }
 
+// ---------------------------------------------------------------------------
+// ConfigureStorageRoots
+// ---------------------------------------------------------------------------
+
+void File::ConfigureStorageRoots(const omnisphere::dtos::ConfigureStorageRoots& input) const
+{
+    try
+    {
+        auto& roots = omnisphere::repositories::StorageRoots::Instance();
+        auto& index = omnisphere::repositories::FilenameIndex::Instance();
+        if (input.ImagePath) { roots.Set("ImagePath", *input.ImagePath); index.Set("ImagePath", *input.ImagePath); }
+        if (input.PDFPath)   { roots.Set("PDFPath", *input.PDFPath);     index.Set("PDFPath", *input.PDFPath); }
+        if (input.XMLPath)   { roots.Set("XMLPath", *input.XMLPath);     index.Set("XMLPath", *input.XMLPath); }
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ConfigureStorageRoots] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GetStorageRoots
+// ---------------------------------------------------------------------------
+
+std::vector<omnisphere::models::StorageRootStatus> File::GetStorageRoots() const
+{
+    try
+    {
+        return omnisphere::repositories::StorageRoots::Instance().Status();
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::GetStorageRoots] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// FindFiles
+// ---------------------------------------------------------------------------
+
+std::vector<omnisphere::models::IndexedFile> File::FindFiles(const omnisphere::dtos::FindFiles& input) const
+{
+    try
+    {
+        omnisphere::repositories::FilenameQuery query;
+        query.Text               = input.Query;
+        query.Substring          = input.Substring.value_or(false);
+        query.IncludeDirectories = input.IncludeDirectories.value_or(true);
+        query.MaxResults         = input.MaxResults.value_or(1000);
+        query.Roots              = input.Roots.value_or(std::vector<std::string>{});
+        return omnisphere::repositories::FilenameIndex::Instance().Find(query);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::FindFiles] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GetFilenameIndex
+// ---------------------------------------------------------------------------
+
+std::vector<omnisphere::models::FilenameIndexStatus> File::GetFilenameIndex() const
+{
+    try
+    {
+        return omnisphere::repositories::FilenameIndex::Instance().Status();
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::GetFilenameIndex] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ConfigureContentCache
+// ---------------------------------------------------------------------------
+
+void File::ConfigureContentCache(const omnisphere::dtos::ConfigureContentCache& input) const
+{
+    try
+    {
+        auto& cache = omnisphere::repositories::ContentCache::Instance();
+        if (!input.Enabled)
+        {
+            cache.Disable();
+            return;
+        }
+
+        omnisphere::repositories::ContentCacheOptions options;
+        options.Directory = input.Directory.value_or("");
+        if (input.MaxBytes) options.MaxBytes = *input.MaxBytes;
+        if (input.RevalidateSeconds) options.RevalidateInterval = std::chrono::seconds(*input.RevalidateSeconds);
+        if (input.RemotePrefixes) options.RemotePrefixes = *input.RemotePrefixes;
+        cache.Configure(options);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ConfigureContentCache] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GetContentCacheStats
+// ---------------------------------------------------------------------------
+
+omnisphere::models::ContentCacheStats File::GetContentCacheStats() const
+{
+    try
+    {
+        return omnisphere::repositories::ContentCache::Instance().Stats();
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::GetContentCacheStats] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ConfigureContentStore
+// ---------------------------------------------------------------------------
+
+void File::ConfigureContentStore(const omnisphere::dtos::ConfigureContentStore& input) const
+{
+    try
+    {
+        std::vector<std::string> directories;
+        for (const auto& directory : input.Directories)
+            directories.push_back(ResolvePath(directory));
+        omnisphere::repositories::ContentStore::Instance().Configure(directories);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ConfigureContentStore] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// CollectContentStore
+// ---------------------------------------------------------------------------
+
+size_t File::CollectContentStore() const
+{
+    try
+    {
+        return omnisphere::repositories::ContentStore::Instance().Collect();
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::CollectContentStore] ") + e.what());
+    }
+}
+
 // ---------------------------------------------------------------------------
 // GetMountedShares
 // ---------------------------------------------------------------------------
@@ -188,35 +415,267 @@ omnisphere::models::FileContent File::ReadFile(const omnisphere::dtos::ReadFile&
 {
     try
     {
-        std::string dirPath  = input.Path.value_or("");
-        std::string resolved = ResolvePath(dirPath);
+        omnisphere::models::FileContent result = ReadFileBinary(input);
+        result.EnsureDataUrl();
+        result.Bytes.reset();
+        return result;
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ReadFile] ") + e.what());
+    }
+}
 
-        std::string fullPath;
-        if (!resolved.empty() && fs::is_directory(resolved))
-            fullPath = (fs::path(resolved) / input.FileName).string();
-        else if (!resolved.empty())
-            fullPath = resolved;
-        else
-            fullPath = input.FileName;
+// ---------------------------------------------------------------------------
+// ReadFileAsync
+// ---------------------------------------------------------------------------
 
-        auto bytes    = pimpl->repo.ReadBytes(fullPath);
-        std::string mime    = DetectMimeType(input.FileName);
-        std::string b64     = Base64Encode(bytes);
-        std::string dataUrl = "data:" + mime + ";base64," + b64;
+std::future<omnisphere::models::FileContent> File::ReadFileAsync(const omnisphere::dtos::ReadFile& input) const
+{
+    auto promise = std::make_shared<std::promise<omnisphere::models::FileContent>>();
+    auto future  = promise->get_future();
+    try
+    {
+        pimpl->repo.WhenReachable(input.Path.value_or(""), "", "", "", [promise, input]
+        {
+            try
+            {
+                promise->set_value(File().ReadFile(input));
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+        });
+    }
+    catch (const std::exception& e)
+    {
+        promise->set_exception(std::make_exception_ptr(std::runtime_error(std::string("[File::ReadFileAsync] ") + e.what())));
+    }
+    return future;
+}
+
+// ---------------------------------------------------------------------------
+// ReadFileBinary
+// ---------------------------------------------------------------------------
+
+omnisphere::models::FileContent File::ReadFileBinary(const omnisphere::dtos::ReadFile& input) const
+{
+    try
+    {
+        std::string fullPath = BuildFullPath(input.Path, input.FileName);
 
         omnisphere::models::FileContent result;
         result.FileName = input.FileName;
         result.FullPath = fullPath;
-        result.DataUrl  = dataUrl;
-        result.MimeType = mime;
+        result.MimeType = DetectMimeType(input.FileName);
+        result.Bytes    = pimpl->repo.ReadShared(fullPath);
+        result.Size     = result.Bytes->Size;
         return result;
     }
     catch (const std::exception& e)
     {
-        throw std::runtime_error(std::string("[File::ReadFile] ") + e.what());
+        throw std::runtime_error(std::string("[File::ReadFileBinary] ") + e.what());
     }
 }
 
+// ---------------------------------------------------------------------------
+// ReadFiles
+// ---------------------------------------------------------------------------
+
+std::vector<omnisphere::models::FileResult> File::ReadFiles(const omnisphere::dtos::ReadFiles& input) const
+{
+    constexpr size_t defaultParallel = 8;
+
+    try
+    {
+        const std::string directory = ResolvePath(input.Path.value_or(""));
+        if (!directory.empty() && !fs::is_directory(directory))
+            throw std::runtime_error("Not a directory: " + directory);
+
+        const bool binary = input.Binary.value_or(false);
+        std::vector<omnisphere::models::FileResult> results(input.FileNames.size());
+
+        omnisphere::repositories::WorkStealingPool::Instance().ForEach(
+            results.size(), input.MaxParallel.value_or(defaultParallel), [&](size_t i)
+            {
+                const std::string& name = input.FileNames[i];
+                results[i].FileName = name;
+                try
+                {
+                    omnisphere::models::FileContent content;
+                    content.FileName = name;
+                    content.FullPath = directory.empty() ? name : (fs::path(directory) / name).string();
+                    content.MimeType = DetectMimeType(name);
+                    content.Bytes    = pimpl->repo.ReadShared(content.FullPath);
+                    content.Size     = content.Bytes->Size;
+                    if (!binary)
+                    {
+                        content.EnsureDataUrl();
+                        content.Bytes.reset();
+                    }
+                    results[i].Content = std::move(content);
+                }
+                catch (const std::exception& e)
+                {
+                    results[i].Error = e.what();
+                }
+            });
+        return results;
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ReadFiles] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ReadFileChunked
+// ---------------------------------------------------------------------------
+
+void File::ReadFileChunked(const omnisphere::dtos::ReadFileChunked& input,
+                           const std::function<bool(const omnisphere::models::FileChunk&)>& sink) const
+{
+    constexpr size_t defaultChunkSize = 1 << 20;
+    constexpr size_t maxChunkSize     = 64 << 20;
+
+    try
+    {
+        std::string fullPath = BuildFullPath(input.Path, input.FileName);
+        const bool base64    = input.Base64.value_or(false);
+
+        size_t chunkSize = std::min(input.ChunkSize.value_or(defaultChunkSize), maxChunkSize);
+        // Whole 3-byte groups keep every Base64 chunk free of padding except the last,
+        // so the client can simply concatenate them.
+        if (base64)
+            chunkSize = std::max<size_t>(chunkSize - chunkSize % 3, 3);
+
+        if (!base64)
+        {
+            pimpl->repo.ReadChunks(fullPath, input.Offset.value_or(0), input.Length, chunkSize, sink);
+            return;
+        }
+
+        std::string encoded;
+        pimpl->repo.ReadChunks(fullPath, input.Offset.value_or(0), input.Length, chunkSize,
+            [&](const omnisphere::models::FileChunk& raw)
+            {
+                Base64Encode(reinterpret_cast<const unsigned char*>(raw.Data.data()), raw.Data.size(), encoded);
+                omnisphere::models::FileChunk chunk = raw;
+                chunk.Data = encoded;
+                return sink(chunk);
+            });
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::ReadFileChunked] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Staged saves, shared by SaveFile and SaveFiles
+// ---------------------------------------------------------------------------
+
+namespace
+{
+
+// A file whose content is written and hashed but not yet visible under its name
+struct StagedSave
+{
+    std::string FullPath;
+    std::unique_ptr<omnisphere::repositories::ContentStore::Writer> Stored;
+    std::optional<omnisphere::repositories::AtomicFile> Out;
+    std::unique_ptr<omnisphere::repositories::ContentCache::Writer> Cached;
+    std::string Hash;
+    uint64_t Size = 0;
+    bool Linked = false;    // Already in place, linked to stored content by hash
+};
+
+// Strip "data:<mime>;base64," prefix if present
+std::string_view Base64Payload(const std::string& content)
+{
+    std::string_view raw = content;
+    size_t commaPos = raw.find(',');
+    if (commaPos != std::string_view::npos && raw.rfind("data:", 0) == 0)
+        raw.remove_prefix(commaPos + 1);
+    return raw;
+}
+
+// Decode in fixed-size slices straight into a temp file next to the target, hashing on the
+// way. Deduplicated content goes to the content store instead, the target becoming a link
+// to it on Publish. A save carrying only a hash links the stored content right away.
+void Stage(StagedSave& save, const omnisphere::dtos::SaveFile& input, omnisphere::enums::FsyncPolicy durability)
+{
+    const std::string_view rawContent = Base64Payload(input.Content);
+
+    if (rawContent.empty() && input.ContentHash)
+    {
+        // The client already knows the hash and names a file it can read with that content:
+        // link content stored by an earlier save
+        if (!omnisphere::repositories::ContentStore::Instance().LinkExisting(*input.ContentHash, input.ContentSource.value_or(""),
+                                                                             save.FullPath, durability))
+            throw std::runtime_error("Content " + *input.ContentHash + " is not stored or not readable from ContentSource; upload it");
+        save.Hash   = *input.ContentHash;
+        save.Size   = fs::file_size(save.FullPath);
+        save.Linked = true;
+        return;
+    }
+
+    constexpr size_t chunkChars = 1 << 20;
+    if (input.Deduplicate.value_or(false))
+        save.Stored = omnisphere::repositories::ContentStore::Instance().BeginWrite(save.FullPath);
+    if (!save.Stored)
+        save.Out.emplace(save.FullPath);
+    // Files on network mounts are also written into the local content cache
+    save.Cached = omnisphere::repositories::ContentCache::Instance().BeginWrite(save.FullPath);
+
+    omnisphere::repositories::ContentHasher hasher;
+    omnisphere::codecs::Base64Decoder decoder;
+    std::vector<unsigned char> buffer(omnisphere::codecs::Base64::DecodedMaxLength(chunkChars + 3));
+    for (size_t pos = 0; pos < rawContent.size(); pos += chunkChars)
+    {
+        const size_t n = std::min(chunkChars, rawContent.size() - pos);
+        const size_t written = decoder.Update(rawContent.data() + pos, n, buffer.data());
+        hasher.Update(buffer.data(), written);
+        if (save.Stored) save.Stored->Write(buffer.data(), written);
+        else             save.Out->Write(buffer.data(), written);
+        if (save.Cached) save.Cached->Write(buffer.data(), written);
+        save.Size += written;
+    }
+    decoder.Finish();
+
+    save.Hash = hasher.Final();
+    if (input.ContentHash && *input.ContentHash != save.Hash)
+        throw std::runtime_error("Content does not match its hash " + *input.ContentHash + " (got " + save.Hash + ")");
+}
+
+// Rename (or link) the staged content into place
+void Publish(StagedSave& save, omnisphere::enums::FsyncPolicy durability)
+{
+    if (!save.Linked)
+    {
+        if (save.Stored) save.Stored->Commit(save.Hash, durability);
+        else             save.Out->Commit(durability);
+    }
+    // Either the cache takes the new content or the entry for the file it replaced goes
+    if (save.Cached && !save.Linked)
+        save.Cached->Commit(save.Hash);
+    else
+        omnisphere::repositories::ContentCache::Instance().Invalidate(save.FullPath);
+}
+
+omnisphere::models::FileContent Saved(const std::string& fileName, const StagedSave& save)
+{
+    omnisphere::models::FileContent result;
+    result.FileName    = fileName;
+    result.FullPath    = save.FullPath;
+    result.ContentHash = save.Hash;
+    result.Size        = save.Size;
+    return result;
+}
+
+} // namespace
+
 // ---------------------------------------------------------------------------
 // SaveFile
 // ---------------------------------------------------------------------------
@@ -225,34 +684,242 @@ omnisphere::models::FileContent File::SaveFile(const omnisphere::dtos::SaveFile&
 {
     try
     {
-        std::string dirPath  = input.Path.value_or("");
-        std::string resolved = ResolvePath(dirPath);
+        const auto durability = input.Durability.value_or(omnisphere::enums::FsyncPolicy::File);
+
+        StagedSave save;
+        save.FullPath = BuildFullPath(input.Path, input.FileName);
+        Stage(save, input, durability);
+        Publish(save, durability);
+        return Saved(input.FileName, save);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::SaveFile] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// SaveFiles
+// ---------------------------------------------------------------------------
+
+std::vector<omnisphere::models::FileResult> File::SaveFiles(const omnisphere::dtos::SaveFiles& input) const
+{
+    constexpr size_t defaultParallel = 8;
+    using omnisphere::enums::FsyncPolicy;
+
+    try
+    {
+        const std::string directory = ResolvePath(input.Path.value_or(""));
+        if (!directory.empty() && !fs::is_directory(directory))
+            throw std::runtime_error("Not a directory: " + directory);
+
+        const FsyncPolicy durability = input.Durability.value_or(FsyncPolicy::File);
+        const size_t count = input.Files.size();
+        auto& pool = omnisphere::repositories::WorkStealingPool::Instance();
+
+        std::vector<omnisphere::models::FileResult> results(count);
+        std::vector<std::unique_ptr<StagedSave>> staged(count);
+        auto fail = [&](size_t i, const std::exception& e)
+        {
+            results[i].Error = e.what();
+            staged[i].reset();      // Drops the temp file
+        };
+
+        // 1. Write and hash every file in parallel; none of them is visible yet
+        pool.ForEach(count, input.MaxParallel.value_or(defaultParallel), [&](size_t i)
+        {
+            const auto& file = input.Files[i];
+            results[i].FileName = file.FileName;
+            try
+            {
+                auto save = std::make_unique<StagedSave>();
+                save->FullPath = directory.empty() ? file.FileName : (fs::path(directory) / file.FileName).string();
+                Stage(*save, file, durability);
+                staged[i] = std::move(save);
+            }
+            catch (const std::exception& e)
+            {
+                fail(i, e);
+            }
+        });
+
+        // 2. Flush them together: the device sees every write before the first fsync
+        //    waits, and the fsyncs overlap instead of queueing behind each other
+        if (durability != FsyncPolicy::None)
+        {
+            pool.ForEach(count, input.MaxParallel.value_or(defaultParallel), [&](size_t i)
+            {
+                if (!staged[i] || !staged[i]->Out)
+                    return;
+                try
+                {
+                    staged[i]->Out->Sync();
+                }
+                catch (const std::exception& e)
+                {
+                    fail(i, e);
+                }
+            });
+        }
+
+        // 3. Rename into place, then sync each directory once instead of once per file.
+        //    Deduplicated files flush their blob while publishing.
+        std::set<std::string> directories;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!staged[i])
+                continue;
+            try
+            {
+                Publish(*staged[i], staged[i]->Stored ? (durability == FsyncPolicy::None ? FsyncPolicy::None : FsyncPolicy::File)
+                                                      : FsyncPolicy::None);
+                results[i].Content = Saved(input.Files[i].FileName, *staged[i]);
+                directories.insert(fs::path(staged[i]->FullPath).parent_path().string());
+            }
+            catch (const std::exception& e)
+            {
+                fail(i, e);
+            }
+        }
+        if (durability == FsyncPolicy::FileAndDirectory)
+        {
+            for (const auto& dir : directories)
+                omnisphere::repositories::AtomicFile::SyncDirectory(dir.empty() ? "." : dir);
+        }
+        return results;
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::SaveFiles] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BeginUpload
+// ---------------------------------------------------------------------------
+
+omnisphere::models::UploadSession File::BeginUpload(const omnisphere::dtos::BeginUpload& input) const
+{
+    try
+    {
+        const std::string fullPath = BuildFullPath(input.Path, input.FileName);
+        return omnisphere::repositories::UploadSessions::Instance().Begin(
+            fullPath, input.FileName, input.Size, input.ContentHash,
+            input.Durability.value_or(omnisphere::enums::FsyncPolicy::File));
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::BeginUpload] ") + e.what());
+    }
+}
 
-        std::string fullPath;
-        if (!resolved.empty() && fs::is_directory(resolved))
-            fullPath = (fs::path(resolved) / input.FileName).string();
-        else if (!resolved.empty())
-            fullPath = resolved;
-        else
-            fullPath = input.FileName;
+// ---------------------------------------------------------------------------
+// AppendUpload
+// ---------------------------------------------------------------------------
 
-        // Strip "data:<mime>;base64," prefix if present
-        std::string rawContent = input.Content;
-        size_t commaPos = rawContent.find(',');
-        if (commaPos != std::string::npos && rawContent.rfind("data:", 0) == 0)
-            rawContent = rawContent.substr(commaPos + 1);
+omnisphere::models::UploadSession File::AppendUpload(const omnisphere::dtos::AppendUpload& input) const
+{
+    try
+    {
+        const std::vector<unsigned char> chunk = omnisphere::codecs::Base64::Decode(input.Data);
+        return omnisphere::repositories::UploadSessions::Instance().Append(input.UploadId, input.Offset, chunk.data(), chunk.size());
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::AppendUpload] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// GetUpload
+// ---------------------------------------------------------------------------
 
-        auto bytes = Base64Decode(rawContent);
-        pimpl->repo.WriteBytes(fullPath, bytes);
+omnisphere::models::UploadSession File::GetUpload(const std::string& uploadId) const
+{
+    try
+    {
+        return omnisphere::repositories::UploadSessions::Instance().Get(uploadId);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::GetUpload] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// CommitUpload
+// ---------------------------------------------------------------------------
+
+omnisphere::models::FileContent File::CommitUpload(const std::string& uploadId) const
+{
+    try
+    {
+        auto& uploads = omnisphere::repositories::UploadSessions::Instance();
+        const omnisphere::models::UploadSession session = uploads.Get(uploadId);
 
         omnisphere::models::FileContent result;
-        result.FileName = input.FileName;
-        result.FullPath = fullPath;
+        result.FileName    = session.FileName;
+        result.FullPath    = session.FullPath;
+        result.Size        = session.Size;
+        result.ContentHash = uploads.Commit(uploadId);
+        // The cached copy of the file it replaced is stale now
+        omnisphere::repositories::ContentCache::Instance().Invalidate(session.FullPath);
         return result;
     }
     catch (const std::exception& e)
     {
-        throw std::runtime_error(std::string("[File::SaveFile] ") + e.what());
+        throw std::runtime_error(std::string("[File::CommitUpload] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// AbortUpload
+// ---------------------------------------------------------------------------
+
+void File::AbortUpload(const std::string& uploadId) const
+{
+    try
+    {
+        omnisphere::repositories::UploadSessions::Instance().Abort(uploadId);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::AbortUpload] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Watch
+// ---------------------------------------------------------------------------
+
+uint64_t File::Watch(const std::string& path, bool recursive,
+                     const std::function<void(const std::vector<omnisphere::models::FileChangeEvent>&)>& callback) const
+{
+    try
+    {
+        omnisphere::repositories::FileWatchOptions options;
+        options.Recursive = recursive;
+        return omnisphere::repositories::FileWatcher::Instance().Watch(ResolvePath(path), options, callback);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::Watch] ") + e.what());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Unwatch
+// ---------------------------------------------------------------------------
+
+void File::Unwatch(uint64_t watchId) const
+{
+    try
+    {
+        omnisphere::repositories::FileWatcher::Instance().Unwatch(watchId);
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(std::string("[File::Unwatch] ") + e.what());
     }
 }
 
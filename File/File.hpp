@@ -1,13 +1,38 @@
 #pragma once
+#include "File/DTOs/AppendUpload.hpp"
+#include "File/DTOs/BeginUpload.hpp"
 #include "File/DTOs/ListDirectory.hpp"
+#include "File/DTOs/ListDirectoryPage.hpp"
+#include "File/DTOs/ListTree.hpp"
 #include "File/DTOs/ValidateDirectoryPermissions.hpp"
 #include "File/DTOs/ConnectNetworkShare.hpp"
+#include "File/DTOs/ConfigureContentCache.hpp"
+#include "File/DTOs/ConfigureContentStore.hpp"
+#include "File/DTOs/ConfigureStorageRoots.hpp"
 #include "File/DTOs/CreateDirectory.hpp"
+#include "File/DTOs/FindFiles.hpp"
 #include "File/DTOs/ReadFile.hpp"
+#include "File/DTOs/ReadFileChunked.hpp"
+#include "File/DTOs/ReadFiles.hpp"
 #include "File/DTOs/SaveFile.hpp"
+#include "File/DTOs/SaveFiles.hpp"
+#include "File/Models/ContentCacheStats.hpp"
 #include "File/Models/DirectoryItem.hpp"
+#include "File/Models/FileChangeEvent.hpp"
+#include "File/Models/DirectoryPage.hpp"
+#include "File/Models/FileChunk.hpp"
 #include "File/Models/FileContent.hpp"
+#include "File/Models/FilenameIndexStatus.hpp"
+#include "File/Models/FileResult.hpp"
+#include "File/Models/IndexedFile.hpp"
+#include "File/Models/TreeDirectory.hpp"
+#include "File/Models/TreeSummary.hpp"
 #include "File/Models/DirectoryPermissions.hpp"
+#include "File/Models/StorageRootStatus.hpp"
+#include "File/Models/UploadSession.hpp"
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <string>
 #include <vector>
 #include <memory>
@@ -24,12 +49,55 @@ namespace omnisphere::services
         // List directory contents (local or network SMB/NFS)
         std::vector<omnisphere::models::DirectoryItem> ListDirectory(const omnisphere::dtos::ListDirectory& input) const;
 
-        // Validate read/write access by creating and deleting a 0B probe file
+        // Non-blocking ListDirectory: returns at once and completes on the shared pool. When the share
+        // still has to be mounted the listing starts after the mount, which is shared with any other
+        // request for the same share. Errors are delivered through the future.
+        std::future<std::vector<omnisphere::models::DirectoryItem>> ListDirectoryAsync(const omnisphere::dtos::ListDirectory& input) const;
+
+        // List one page of a directory; pass the returned ContinuationToken back for the next page
+        omnisphere::models::DirectoryPage ListDirectoryPage(const omnisphere::dtos::ListDirectoryPage& input) const;
+
+        // List every directory under Path down to MaxDepth, streaming each one to the callback as it is
+        // read (from pool threads, one call at a time). Return false from the callback to stop early.
+        omnisphere::models::TreeSummary ListTree(const omnisphere::dtos::ListTree& input,
+                                                 const std::function<bool(omnisphere::models::TreeDirectory&&)>& callback) const;
+
+        // Validate read/write access: faccessat on local disks, a probe file on network mounts.
+        // Results are cached for 30 s; set ForceRefresh to check again.
         omnisphere::models::DirectoryPermissions ValidateDirectoryPermissions(const omnisphere::dtos::ValidateDirectoryPermissions& input) const;
 
+        // Validate many directories at once, probing them in parallel; results in input order
+        std::vector<omnisphere::models::DirectoryPermissions> ValidateDirectoryPermissions(const std::vector<std::string>& paths,
+                                                                                           bool forceRefresh = false) const;
+
         // Connect to an SMB or NFS network share
         std::string ConnectNetworkShare(const omnisphere::dtos::ConnectNetworkShare& input) const;
 
+        // Set the storage roots to keep resolved, mounted and health-probed in the background
+        void ConfigureStorageRoots(const omnisphere::dtos::ConfigureStorageRoots& input) const;
+
+        // Liveness and probe latency of each configured storage root
+        std::vector<omnisphere::models::StorageRootStatus> GetStorageRoots() const;
+
+        // Find files and directories by name prefix or substring in the index of the storage
+        // roots, sorted by name. Roots still being indexed for the first time are left out.
+        std::vector<omnisphere::models::IndexedFile> FindFiles(const omnisphere::dtos::FindFiles& input) const;
+
+        // Size, freshness and mode (inotify or rescans) of the filename index of each storage root
+        std::vector<omnisphere::models::FilenameIndexStatus> GetFilenameIndex() const;
+
+        // Enable, resize or disable the local disk cache for files read from network mounts
+        void ConfigureContentCache(const omnisphere::dtos::ConfigureContentCache& input) const;
+
+        // Hit rate and bytes saved by the content cache
+        omnisphere::models::ContentCacheStats GetContentCacheStats() const;
+
+        // Set where deduplicating saves keep their content, one directory per filesystem
+        void ConfigureContentStore(const omnisphere::dtos::ConfigureContentStore& input) const;
+
+        // Remove stored content no saved file links to any more; returns how many blobs went
+        size_t CollectContentStore() const;
+
         // Get active OS mounted SMB/NFS network shares
         std::vector<std::string> GetMountedShares() const;
 
@@ -39,9 +107,49 @@ namespace omnisphere::services
         // Read a file and return it as a Base64 Data URL
         omnisphere::models::FileContent ReadFile(const omnisphere::dtos::ReadFile& input) const;
 
-        // Save a file from a Base64 encoded content string
+        // Non-blocking ReadFile, mounting the share first if needed (see ListDirectoryAsync)
+        std::future<omnisphere::models::FileContent> ReadFileAsync(const omnisphere::dtos::ReadFile& input) const;
+
+        // Read a file as raw bytes (shared, zero-copy for large local files) with mime type and size.
+        // The data URL is only built if the caller asks for it through FileContent::EnsureDataUrl.
+        omnisphere::models::FileContent ReadFileBinary(const omnisphere::dtos::ReadFile& input) const;
+
+        // Read many files of one directory in parallel. Results come back in request order;
+        // a file that fails carries its error instead of failing the batch.
+        std::vector<omnisphere::models::FileResult> ReadFiles(const omnisphere::dtos::ReadFiles& input) const;
+
+        // Stream a file (or an Offset/Length range of it) to the sink in bounded chunks, raw or Base64.
+        // Memory use stays at one chunk regardless of file size; the sink returns false to stop early.
+        void ReadFileChunked(const omnisphere::dtos::ReadFileChunked& input,
+                             const std::function<bool(const omnisphere::models::FileChunk&)>& sink) const;
+
+        // Save a file from a Base64 encoded content string. The result carries the BLAKE2b hash
+        // of the content; with Deduplicate, identical content is stored once and hard-linked.
         omnisphere::models::FileContent SaveFile(const omnisphere::dtos::SaveFile& input) const;
 
+        // Save many files into one directory: written in parallel, flushed together, then
+        // renamed into place. Per-file results in request order, like ReadFiles.
+        std::vector<omnisphere::models::FileResult> SaveFiles(const omnisphere::dtos::SaveFiles& input) const;
+
+        // Resumable upload of a large file in chunks. Begin returns the session (or the open one
+        // for the same target, size and hash); Append writes one chunk at its offset; after an
+        // interruption the client continues from Acknowledged; Commit renames the complete,
+        // verified file into place. Sessions survive a restart of the process.
+        omnisphere::models::UploadSession BeginUpload(const omnisphere::dtos::BeginUpload& input) const;
+        omnisphere::models::UploadSession AppendUpload(const omnisphere::dtos::AppendUpload& input) const;
+        omnisphere::models::UploadSession GetUpload(const std::string& uploadId) const;
+        omnisphere::models::FileContent CommitUpload(const std::string& uploadId) const;
+        void AbortUpload(const std::string& uploadId) const;
+
+        // Subscribe to changes under a directory (inotify locally, polling on network mounts).
+        // Changes arrive in debounced batches from a pool thread; a Rescan event means changes
+        // were dropped and the subscriber should re-list the directory. Returns the watch id.
+        uint64_t Watch(const std::string& path, bool recursive,
+                       const std::function<void(const std::vector<omnisphere::models::FileChangeEvent>&)>& callback) const;
+
+        // Stop a subscription; once this returns its callback is no longer running
+        void Unwatch(uint64_t watchId) const;
+
         // Resolve raw path (local or network URI) to an accessible filesystem path
         static std::string ResolvePath(const std::string& rawPath);
 
@@ -49,8 +157,10 @@ namespace omnisphere::services
         struct Impl;
         std::unique_ptr<Impl> pimpl;
 
+        static std::string BuildFullPath(const std::optional<std::string>& path, const std::string& fileName);
         static std::string DetectMimeType(const std::string& fileName);
         static std::string Base64Encode(const std::vector<unsigned char>& data);
+        static void Base64Encode(const unsigned char* data, size_t size, std::string& out);
         static std::vector<unsigned char> Base64Decode(const std::string& in);
     };
 } // namespace omnisphere::services
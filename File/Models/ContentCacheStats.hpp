@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+
+namespace omnisphere::models
+{
+    struct ContentCacheStats
+    {
+        uint64_t Hits = 0;
+        uint64_t Misses = 0;            // Cacheable reads that went to the network
+        uint64_t Revalidations = 0;     // Hits that needed a stat of the source first
+        uint64_t Invalidations = 0;     // Entries dropped because the source changed or vanished
+        uint64_t Stores = 0;
+        uint64_t WriteThroughs = 0;     // Entries filled by SaveFile
+        uint64_t Evictions = 0;
+        uint64_t BytesSaved = 0;        // Bytes served from disk instead of the network
+        uint64_t Bytes = 0;             // Current size of the cached content
+        uint64_t Entries = 0;
+        double HitRate = 0;             // Hits / (Hits + Misses)
+    };
+} // namespace omnisphere::models
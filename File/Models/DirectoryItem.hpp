@@ -1,5 +1,8 @@
 #pragma once
+#include "File/Enums/FileType.hpp"
+#include <cstdint>
 #include <string>
+#include <optional>
 
 namespace omnisphere::models
 {
@@ -8,5 +11,8 @@ namespace omnisphere::models
         std::string Name;
         std::string Path;
         bool IsDirectory;
+        std::optional<omnisphere::enums::FileType> Type;
+        std::optional<uint64_t> Size;           // Bytes, only with ListDirectory.IncludeMetadata
+        std::optional<int64_t> ModifiedAt;      // Unix time in milliseconds, only with IncludeMetadata
     };
 } // namespace omnisphere::models
@@ -0,0 +1,15 @@
+#pragma once
+#include "File/Models/DirectoryItem.hpp"
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace omnisphere::models
+{
+    struct DirectoryPage
+    {
+        std::vector<DirectoryItem> Items;
+        std::optional<std::string> ContinuationToken;   // Set when HasMore
+        bool HasMore = false;
+    };
+} // namespace omnisphere::models
@@ -8,5 +8,7 @@ namespace omnisphere::models
         std::string Path;
         bool HasReadAccess;
         bool HasWriteAccess;
+        std::string Method;     // "access" (faccessat), "probe" (probe file) or "none" (not a directory)
+        bool Cached = false;    // Served from the permission cache
     };
 } // namespace omnisphere::models
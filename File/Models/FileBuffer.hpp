@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace omnisphere::models
+{
+    // Read-only file bytes shared between callers without copying. Data keeps the
+    // backing storage (a private mapping or a heap block) alive for as long as any
+    // copy of the buffer exists.
+    struct FileBuffer
+    {
+        std::shared_ptr<const unsigned char> Data;
+        size_t Size = 0;
+        bool Mapped = false;    // True when backed by mmap rather than a heap copy
+
+        const unsigned char* begin() const { return Data.get(); }
+        const unsigned char* end() const { return Data.get() + Size; }
+        std::string_view View() const { return std::string_view(reinterpret_cast<const char*>(Data.get()), Size); }
+    };
+} // namespace omnisphere::models
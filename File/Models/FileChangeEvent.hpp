@@ -0,0 +1,14 @@
+#pragma once
+#include "File/Enums/FileChangeKind.hpp"
+#include <string>
+
+namespace omnisphere::models
+{
+    struct FileChangeEvent
+    {
+        omnisphere::enums::FileChangeKind Kind = omnisphere::enums::FileChangeKind::Modified;
+        std::string Path;           // Full path; the watched directory itself for Rescan
+        std::string RelativePath;   // Below the watched directory, '/' separated; empty for the directory itself
+        bool IsDirectory = false;
+    };
+} // namespace omnisphere::models
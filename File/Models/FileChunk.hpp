@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace omnisphere::models
+{
+    struct FileChunk
+    {
+        uint64_t Offset;        // File offset of the first raw byte in this chunk
+        uint64_t Length;        // Raw bytes covered by this chunk
+        uint64_t FileSize;
+        bool IsLast;
+        std::string_view Data;  // Raw bytes or Base64 text, valid only inside the sink
+    };
+} // namespace omnisphere::models
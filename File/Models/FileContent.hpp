@@ -1,4 +1,8 @@
 #pragma once
+#include "File/Codecs/Base64.hpp"
+#include "File/Models/FileBuffer.hpp"
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <optional>
 
@@ -10,5 +14,24 @@ namespace omnisphere::models
         std::string FullPath;
         std::optional<std::string> DataUrl;
         std::optional<std::string> MimeType;
+        std::optional<FileBuffer> Bytes;   // Raw content, set by binary reads
+        std::optional<uint64_t> Size;
+        std::optional<std::string> ContentHash;   // BLAKE2b-256 hex, set by SaveFile
+
+        // Returns DataUrl, encoding it from Bytes on first use
+        const std::string& EnsureDataUrl()
+        {
+            if (DataUrl)
+                return *DataUrl;
+            if (!Bytes)
+                throw std::logic_error("FileContent has neither bytes nor a data URL");
+
+            std::string url = "data:" + MimeType.value_or("application/octet-stream") + ";base64,";
+            const size_t prefix = url.size();
+            url.resize(prefix + omnisphere::codecs::Base64::EncodedLength(Bytes->Size));
+            omnisphere::codecs::Base64::Encode(Bytes->begin(), Bytes->Size, url.data() + prefix);
+            DataUrl = std::move(url);
+            return *DataUrl;
+        }
     };
 } // namespace omnisphere::models
@@ -0,0 +1,15 @@
+#pragma once
+#include "File/Models/FileContent.hpp"
+#include <string>
+#include <optional>
+
+namespace omnisphere::models
+{
+    // Outcome of one file of a batch; exactly one of Content and Error is set
+    struct FileResult
+    {
+        std::string FileName;
+        std::optional<FileContent> Content;
+        std::optional<std::string> Error;
+    };
+} // namespace omnisphere::models
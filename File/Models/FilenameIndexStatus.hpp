@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <optional>
+
+namespace omnisphere::models
+{
+    struct FilenameIndexStatus
+    {
+        std::string Root;                       // "ImagePath", "PDFPath" or "XMLPath"
+        std::string Path;                       // As configured
+        bool Ready = false;                     // Queries see this root
+        bool Live = false;                      // Followed through inotify rather than periodic rescans
+        bool Loaded = false;                    // Started from the persisted index instead of a scan
+        uint64_t Entries = 0;
+        uint64_t PendingChanges = 0;            // Held in memory until the next compaction
+        std::optional<int64_t> LastBuiltAt;     // Unix time in milliseconds of the last scan or compaction
+        double LastBuildMs = 0;
+        std::optional<int64_t> LastRescanAt;
+        std::optional<std::string> LastError;
+    };
+} // namespace omnisphere::models
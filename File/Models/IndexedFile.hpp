@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+namespace omnisphere::models
+{
+    struct IndexedFile
+    {
+        std::string Root;           // Storage root it was found under
+        std::string Name;
+        std::string Path;           // Root path as configured + RelativePath
+        std::string RelativePath;   // '/' separated
+        bool IsDirectory = false;
+    };
+} // namespace omnisphere::models
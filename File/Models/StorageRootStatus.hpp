@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <optional>
+
+namespace omnisphere::models
+{
+    struct StorageRootStatus
+    {
+        std::string Name;                       // "ImagePath", "PDFPath" or "XMLPath"
+        std::string Path;                       // As configured
+        std::string ResolvedPath;               // Local path it was last resolved to
+        bool Alive = false;
+        std::optional<int64_t> LastProbeAt;     // Unix time in milliseconds
+        std::optional<int64_t> LastAliveAt;
+        double LastLatencyMs = 0;               // Resolve + open + first read of the last probe
+        double AvgLatencyMs = 0;                // Exponentially weighted, successful probes only
+        double MaxLatencyMs = 0;
+        uint64_t Probes = 0;
+        uint64_t Failures = 0;
+        uint64_t Remounts = 0;
+        std::optional<std::string> LastError;
+    };
+} // namespace omnisphere::models
@@ -0,0 +1,20 @@
+#pragma once
+#include "File/Models/DirectoryItem.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <optional>
+
+namespace omnisphere::models
+{
+    struct TreeDirectory
+    {
+        std::string Path;
+        std::string RelativePath;               // "" for the root, '/' separated
+        int Depth = 0;
+        bool Readable = true;
+        std::vector<DirectoryItem> Items;
+        std::optional<uint64_t> FileCount;      // Files directly inside, only with IncludeAggregates
+        std::optional<uint64_t> TotalBytes;
+    };
+} // namespace omnisphere::models
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+namespace omnisphere::models
+{
+    struct TreeSummary
+    {
+        uint64_t Directories = 0;
+        uint64_t Unreadable = 0;
+        uint64_t Files = 0;         // Only counted with IncludeAggregates
+        uint64_t Bytes = 0;
+        bool Cancelled = false;     // The callback stopped the walk
+    };
+} // namespace omnisphere::models
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <optional>
+
+namespace omnisphere::models
+{
+    struct UploadSession
+    {
+        std::string UploadId;
+        std::string FileName;
+        std::string FullPath;
+        uint64_t Size = 0;
+        uint64_t Acknowledged = 0;              // Everything before this offset is on disk; resume here
+        uint64_t Received = 0;                  // Bytes on disk in total, including chunks past a gap
+        std::optional<std::string> ContentHash;
+        int64_t CreatedAt = 0;                  // Unix time in milliseconds
+    };
+} // namespace omnisphere::models
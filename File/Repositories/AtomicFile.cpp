@@ -0,0 +1,184 @@
+#include "File/Repositories/AtomicFile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <random>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+std::string ErrnoMessage(const std::string& what, const std::string& path)
+{
+    return what + ": " + path + " (" + std::strerror(errno) + ")";
+}
+
+} // namespace
+
+AtomicFile::AtomicFile(const std::string& targetPath) : targetPath(targetPath)
+{
+    fs::path target(targetPath);
+    fs::path dir = target.has_parent_path() ? target.parent_path() : fs::path(".");
+    std::string pattern = (dir / ("." + target.filename().string() + ".tmp-")).string();
+
+#ifdef _WIN32
+    std::random_device rd;
+    for (int attempt = 0; attempt < 16 && fd < 0; ++attempt)
+    {
+        tempPath = pattern + std::to_string(rd()) + std::to_string(rd());
+        fd = ::_open(tempPath.c_str(), _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+#else
+    std::vector<char> name(pattern.begin(), pattern.end());
+    const char suffix[] = "XXXXXX";
+    name.insert(name.end(), suffix, suffix + sizeof(suffix));
+    // Close-on-exec: a child started meanwhile must not keep the temp file open
+    fd = ::mkostemp(name.data(), O_CLOEXEC);
+    tempPath.assign(name.data());
+    // mkostemp creates 0600; keep the mode of the file being replaced, or what a
+    // plain open() would have produced for a new one
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (::stat(targetPath.c_str(), &st) == 0)
+        {
+            ::fchmod(fd, st.st_mode & 07777);
+        }
+        else
+        {
+            mode_t mask = ::umask(0);
+            ::umask(mask);
+            ::fchmod(fd, 0666 & ~mask);
+        }
+    }
+#endif
+    if (fd < 0)
+        throw std::runtime_error(ErrnoMessage("Cannot create temporary file", pattern));
+}
+
+AtomicFile::~AtomicFile()
+{
+    Close();
+    if (!committed && !tempPath.empty())
+    {
+        std::error_code ec;
+        fs::remove(tempPath, ec);
+    }
+}
+
+void AtomicFile::Close()
+{
+    if (fd < 0)
+        return;
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+    fd = -1;
+}
+
+void AtomicFile::Write(const unsigned char* data, size_t size)
+{
+    if (fd < 0)
+        throw std::logic_error("AtomicFile is already closed");
+
+    while (size > 0)
+    {
+#ifdef _WIN32
+        const unsigned int step = static_cast<unsigned int>(std::min<size_t>(size, 1u << 30));
+        const int n = ::_write(fd, data, step);
+#else
+        const ssize_t n = ::write(fd, data, size);
+#endif
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(ErrnoMessage("Cannot write temporary file", tempPath));
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+void AtomicFile::Commit(omnisphere::enums::FsyncPolicy policy)
+{
+    if (committed)
+        return;
+
+    if (policy != omnisphere::enums::FsyncPolicy::None)
+        Sync();
+    Close();
+
+#ifdef _WIN32
+    if (!::MoveFileExA(tempPath.c_str(), targetPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+        throw std::runtime_error("Cannot replace file: " + targetPath + " (error " + std::to_string(::GetLastError()) + ")");
+#else
+    if (::rename(tempPath.c_str(), targetPath.c_str()) != 0)
+        throw std::runtime_error(ErrnoMessage("Cannot replace file", targetPath));
+#endif
+    committed = true;
+
+    if (policy == omnisphere::enums::FsyncPolicy::FileAndDirectory)
+    {
+        fs::path target(targetPath);
+        SyncDirectory(target.has_parent_path() ? target.parent_path().string() : ".");
+    }
+}
+
+void AtomicFile::Sync()
+{
+    if (fd < 0)
+        throw std::logic_error("AtomicFile is already closed");
+#ifdef _WIN32
+    const int rc = ::_commit(fd);
+#else
+    const int rc = ::fsync(fd);
+#endif
+    if (rc != 0)
+        throw std::runtime_error(ErrnoMessage("Cannot flush temporary file", tempPath));
+}
+
+void AtomicFile::SyncDirectory(const std::string& directory)
+{
+#ifndef _WIN32
+    const int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0)
+        throw std::runtime_error(ErrnoMessage("Cannot open directory for sync", directory));
+
+    const int rc = ::fsync(dirFd);
+    const int err = errno;
+    ::close(dirFd);
+    // FUSE (gvfs) and some network filesystems refuse fsync on directories
+    if (rc != 0 && err != EINVAL && err != ENOTSUP && err != EROFS)
+    {
+        errno = err;
+        throw std::runtime_error(ErrnoMessage("Cannot sync directory", directory));
+    }
+#else
+    // MoveFileEx with MOVEFILE_WRITE_THROUGH already waits for the rename to be flushed
+    (void)directory;
+#endif
+}
+
+} // namespace omnisphere::repositories
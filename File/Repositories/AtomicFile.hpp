@@ -0,0 +1,46 @@
+#pragma once
+#include "File/Enums/FsyncPolicy.hpp"
+#include <cstddef>
+#include <string>
+
+namespace omnisphere::repositories
+{
+    // Writes a file through a uniquely named temp file in the target's directory and
+    // renames it over the target on Commit, so readers only ever see the old or the
+    // complete new content. The temp file is removed if Commit is never reached.
+    class AtomicFile
+    {
+    public:
+        explicit AtomicFile(const std::string& targetPath);
+        ~AtomicFile();
+
+        AtomicFile(const AtomicFile&) = delete;
+        AtomicFile& operator=(const AtomicFile&) = delete;
+
+        void Write(const unsigned char* data, size_t size);
+
+        // Flushes according to the policy and atomically replaces the target
+        void Commit(omnisphere::enums::FsyncPolicy policy);
+
+        // Flush the content now, ahead of a Commit(FsyncPolicy::None). Lets a batch of files
+        // be written first and flushed together before any of them is renamed into place.
+        void Sync();
+
+        const std::string& TempPath() const { return tempPath; }
+
+        // Change where Commit renames to, for content named only once it is fully written.
+        // The new target must be on the same filesystem as the original one.
+        void SetTarget(const std::string& path) { targetPath = path; }
+
+        // Uniform fsync of a directory entry, ignored where the filesystem does not support it
+        static void SyncDirectory(const std::string& directory);
+
+    private:
+        std::string targetPath;
+        std::string tempPath;
+        int fd = -1;
+        bool committed = false;
+
+        void Close();
+    };
+} // namespace omnisphere::repositories
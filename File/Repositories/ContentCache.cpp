@@ -0,0 +1,543 @@
+#include "File/Repositories/ContentCache.hpp"
+#include "File/Repositories/File.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+constexpr const char* indexName    = "index.tsv";
+constexpr const char* incomingName = "incoming";
+// Written into a directory the cache created or found empty; only then does Configure
+// delete files there that the index does not know
+constexpr const char* markerName   = ".omnisphere-content-cache";
+
+bool IsShardName(const std::string& name)
+{
+    return name.size() == 2 && std::isxdigit(static_cast<unsigned char>(name[0])) &&
+           std::isxdigit(static_cast<unsigned char>(name[1]));
+}
+
+// Temp file left by an AtomicFile that never committed
+bool IsTempName(const std::string& name)
+{
+    return !name.empty() && name[0] == '.' && name.find(".tmp-") != std::string::npos;
+}
+
+std::string DefaultDirectory()
+{
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    return base ? std::string(base) + "\\OmniSphere\\content" : "OmniSphere\\content";
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/omnisphere/content";
+    const char* home = std::getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.cache/omnisphere/content";
+#endif
+}
+
+// Size and mtime of the source, the two things a hit is validated against
+bool StatSource(const std::string& path, uint64_t& size, int64_t& mtimeNs)
+{
+#ifndef _WIN32
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+    size    = static_cast<uint64_t>(st.st_size);
+    mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+#else
+    std::error_code ec;
+    size = fs::file_size(path, ec);
+    if (ec) return false;
+    mtimeNs = fs::last_write_time(path, ec).time_since_epoch().count();
+    return !ec;
+#endif
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+ContentCache::Writer::Writer(ContentCache& cache, std::string sourcePath)
+    : cache(cache), sourcePath(std::move(sourcePath)), temp((fs::path(cache.options.Directory) / incomingName / incomingName).string()),
+      maxSize(cache.options.MaxBytes / 8)
+{
+}
+
+void ContentCache::Writer::Write(const unsigned char* data, size_t n)
+{
+    if (skipped)
+        return;
+    size += n;
+    if (size > maxSize)
+    {
+        skipped = true;     // Too large to be worth caching; the temp file goes with the writer
+        return;
+    }
+    try
+    {
+        temp.Write(data, n);
+    }
+    catch (const std::exception&)
+    {
+        skipped = true;     // The cache disk failing must not fail the save itself
+    }
+}
+
+void ContentCache::Writer::Commit(const std::string& hex)
+{
+    // Whatever was cached for the path is the content just replaced
+    if (!Install(hex))
+        cache.Invalidate(sourcePath);
+}
+
+bool ContentCache::Writer::Install(const std::string& hex)
+{
+    if (skipped)
+        return false;
+
+    uint64_t sourceSize = 0;
+    int64_t mtimeNs = 0;
+    if (!StatSource(sourcePath, sourceSize, mtimeNs) || sourceSize != size)
+        return false;
+
+    std::string blobPath;
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        if (!cache.enabled)
+            return false;
+        blobPath = cache.BlobPath(hex);
+        known    = cache.blobs.count(hex) != 0;
+    }
+
+    try
+    {
+        if (!known)
+        {
+            fs::create_directories(fs::path(blobPath).parent_path());
+            temp.SetTarget(blobPath);
+            temp.Commit(omnisphere::enums::FsyncPolicy::None);
+        }
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (!cache.enabled)
+        return false;
+    cache.LinkLocked(sourcePath, hex, size, mtimeNs);
+    ++cache.stats.WriteThroughs;
+    cache.TrimLocked();
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// ContentCache
+// ---------------------------------------------------------------------------
+
+ContentCache::~ContentCache()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (enabled)
+        SaveLocked();
+}
+
+ContentCache& ContentCache::Instance()
+{
+    static ContentCache cache;
+    return cache;
+}
+
+void ContentCache::Configure(const ContentCacheOptions& requested)
+{
+    ContentCacheOptions next = requested;
+    if (next.Directory.empty())
+        next.Directory = DefaultDirectory();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (enabled && next.Directory == options.Directory)
+    {
+        options = next;
+        TrimLocked();
+        return;
+    }
+
+    if (enabled)
+        SaveLocked();
+    journal.close();
+    entries.clear();
+    blobs.clear();
+    lru.clear();
+    totalBytes = 0;
+
+    fs::create_directories(next.Directory);
+    std::error_code ec;
+    if (fs::is_empty(next.Directory, ec) && !ec)
+        std::ofstream(fs::path(next.Directory) / markerName);
+    fs::create_directories(fs::path(next.Directory) / incomingName);
+    options = next;
+    LoadLocked();
+    SaveLocked();
+    enabled = true;
+}
+
+void ContentCache::Disable()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled)
+        return;
+    SaveLocked();
+    journal.close();
+    enabled = false;
+    entries.clear();
+    blobs.clear();
+    lru.clear();
+    totalBytes = 0;
+}
+
+bool ContentCache::Enabled() const
+{
+    return enabled;
+}
+
+bool ContentCache::Caches(const std::string& sourcePath, bool sourceIsLocal) const
+{
+    if (!enabled)
+        return false;
+    if (!sourceIsLocal)
+        return true;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& prefix : options.RemotePrefixes)
+        if (!prefix.empty() && sourcePath.rfind(prefix, 0) == 0)
+            return true;
+    return false;
+}
+
+std::string ContentCache::BlobPath(const std::string& hash) const
+{
+    return (fs::path(options.Directory) / hash.substr(0, 2) / hash).string();
+}
+
+std::optional<std::string> ContentCache::Lookup(const std::string& sourcePath)
+{
+    if (!enabled)
+        return std::nullopt;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(sourcePath);
+    if (it == entries.end())
+        return std::nullopt;
+
+    if (Clock::now() - it->second.ValidatedAt >= options.RevalidateInterval)
+    {
+        const uint64_t expectedSize = it->second.Size;
+        const int64_t expectedMtime = it->second.MtimeNs;
+        lock.unlock();
+
+        // One stat across the network instead of the whole file
+        uint64_t size = 0;
+        int64_t mtimeNs = 0;
+        const bool same = StatSource(sourcePath, size, mtimeNs) && size == expectedSize && mtimeNs == expectedMtime;
+
+        lock.lock();
+        it = entries.find(sourcePath);
+        if (it == entries.end())
+            return std::nullopt;
+        if (!same)
+        {
+            ++stats.Invalidations;
+            EraseLocked(it);
+            return std::nullopt;
+        }
+        it->second.ValidatedAt = Clock::now();
+        ++stats.Revalidations;
+    }
+
+    lru.splice(lru.begin(), lru, it->second.LruIt);
+    ++stats.Hits;
+    stats.BytesSaved += it->second.Size;
+    return BlobPath(it->second.Hash);
+}
+
+void ContentCache::Store(const std::string& sourcePath, int64_t mtimeNs, const unsigned char* data, size_t size)
+{
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!enabled)
+            return;
+        ++stats.Misses;
+        if (size > options.MaxBytes / 8)
+            return;
+        directory = options.Directory;
+    }
+
+    const std::string hex = ContentHasher::Of(data, size);
+
+    std::string blobPath;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!enabled || options.Directory != directory)
+            return;
+        if (blobs.count(hex))
+        {
+            LinkLocked(sourcePath, hex, size, mtimeNs);
+            ++stats.Stores;
+            return;
+        }
+        blobPath = BlobPath(hex);
+    }
+
+    try
+    {
+        fs::create_directories(fs::path(blobPath).parent_path());
+        AtomicFile blob(blobPath);
+        blob.Write(data, size);
+        blob.Commit(omnisphere::enums::FsyncPolicy::None);
+    }
+    catch (const std::exception&)
+    {
+        return;     // A full or unwritable cache disk only costs the caching
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled || options.Directory != directory)
+        return;
+    LinkLocked(sourcePath, hex, size, mtimeNs);
+    ++stats.Stores;
+    TrimLocked();
+}
+
+std::unique_ptr<ContentCache::Writer> ContentCache::BeginWrite(const std::string& sourcePath)
+{
+    if (!enabled)
+        return nullptr;
+
+    const fs::path parent = fs::path(sourcePath).parent_path();
+    if (!Caches(sourcePath, File::IsLocalFileSystem(parent.empty() ? "." : parent.string())))
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!enabled)
+        return nullptr;
+    try
+    {
+        return std::unique_ptr<Writer>(new Writer(*this, sourcePath));
+    }
+    catch (const std::exception&)
+    {
+        return nullptr;
+    }
+}
+
+void ContentCache::Invalidate(const std::string& sourcePath)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(sourcePath);
+    if (it != entries.end())
+        EraseLocked(it);
+}
+
+omnisphere::models::ContentCacheStats ContentCache::Stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    omnisphere::models::ContentCacheStats result = stats;
+    result.Bytes   = totalBytes;
+    result.Entries = entries.size();
+    const uint64_t lookups = result.Hits + result.Misses;
+    result.HitRate = lookups ? static_cast<double>(result.Hits) / static_cast<double>(lookups) : 0;
+    return result;
+}
+
+void ContentCache::LinkLocked(const std::string& sourcePath, const std::string& hash, uint64_t size, int64_t mtimeNs)
+{
+    // Reference the new blob before dropping the old entry, which may point at the same one
+    Blob& blob = blobs[hash];
+    if (blob.Refs++ == 0)
+    {
+        blob.Size = size;
+        totalBytes += size;
+    }
+
+    auto old = entries.find(sourcePath);
+    if (old != entries.end())
+        EraseLocked(old);
+
+    lru.push_front(sourcePath);
+    Entry& entry      = entries[sourcePath];
+    entry.Hash        = hash;
+    entry.Size        = size;
+    entry.MtimeNs     = mtimeNs;
+    entry.ValidatedAt = Clock::now();
+    entry.LruIt       = lru.begin();
+
+    if (sourcePath.find_first_of("\t\n") == std::string::npos)
+        AppendLocked(hash + "\t" + std::to_string(size) + "\t" + std::to_string(mtimeNs) + "\t" + sourcePath + "\n");
+}
+
+void ContentCache::EraseLocked(std::unordered_map<std::string, Entry>::iterator it)
+{
+    auto blob = blobs.find(it->second.Hash);
+    if (blob != blobs.end() && --blob->second.Refs == 0)
+    {
+        std::error_code ec;
+        fs::remove(BlobPath(blob->first), ec);
+        totalBytes -= blob->second.Size;
+        blobs.erase(blob);
+    }
+    if (it->first.find_first_of("\t\n") == std::string::npos)
+        AppendLocked("-\t" + it->first + "\n");
+    lru.erase(it->second.LruIt);
+    entries.erase(it);
+}
+
+void ContentCache::AppendLocked(const std::string& line)
+{
+    if (!journal.is_open())
+        return;
+    journal << line;
+    journal.flush();    // Reaches the kernel right away, so a crash of the process loses nothing
+    if (++journalLines > 2 * entries.size() + 1024)
+        SaveLocked();
+}
+
+void ContentCache::TrimLocked()
+{
+    while (totalBytes > options.MaxBytes && !lru.empty())
+    {
+        EraseLocked(entries.find(lru.back()));
+        ++stats.Evictions;
+    }
+}
+
+void ContentCache::LoadLocked()
+{
+    struct Record
+    {
+        size_t Line = 0;
+        std::string Hash;
+        uint64_t Size = 0;
+        int64_t MtimeNs = 0;
+    };
+
+    // hash \t size \t mtimeNs \t path links a path, "-" \t path drops it; later lines win.
+    // A line cut short by a crash fails the field or blob checks and is skipped.
+    const fs::path root(options.Directory);
+    std::ifstream index(root / indexName);
+    std::unordered_map<std::string, Record> records;
+    std::string line;
+    for (size_t number = 0; std::getline(index, line); ++number)
+    {
+        if (line.rfind("-\t", 0) == 0)
+        {
+            records.erase(line.substr(2));
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string hash, size, mtime, path;
+        if (!std::getline(fields, hash, '\t') || !std::getline(fields, size, '\t') ||
+            !std::getline(fields, mtime, '\t') || !std::getline(fields, path) || !ContentHasher::IsValid(hash))
+            continue;
+        records[path] = Record{number, hash, std::strtoull(size.c_str(), nullptr, 10), std::strtoll(mtime.c_str(), nullptr, 10)};
+    }
+
+    std::vector<std::pair<const std::string*, const Record*>> ordered;
+    ordered.reserve(records.size());
+    for (const auto& [path, record] : records)
+        ordered.emplace_back(&path, &record);
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.second->Line < b.second->Line; });
+
+    for (const auto& [path, record] : ordered)
+    {
+        std::error_code ec;
+        if (fs::file_size(BlobPath(record->Hash), ec) != record->Size || ec)
+            continue;
+        LinkLocked(*path, record->Hash, record->Size, record->MtimeNs);
+        // Nothing was validated yet in this process
+        entries[*path].ValidatedAt = Clock::time_point{};
+    }
+
+    // Blobs no entry points to and temp files left by a crash. Only the cache's own layout is
+    // looked at (shard directories, incoming/, index temp files), and only in a directory
+    // carrying the marker, so pointing Directory at a folder with other files never deletes them.
+    std::error_code ec;
+    if (!fs::exists(root / markerName, ec))
+    {
+        TrimLocked();
+        return;
+    }
+
+    for (const auto& top : fs::directory_iterator(root, ec))
+    {
+        const std::string name = top.path().filename().string();
+        if (top.is_regular_file(ec) && IsTempName(name))
+        {
+            fs::remove(top.path(), ec);
+        }
+        else if (top.is_directory(ec) && (IsShardName(name) || name == incomingName))
+        {
+            for (const auto& file : fs::directory_iterator(top.path(), ec))
+            {
+                const std::string fileName = file.path().filename().string();
+                if (!file.is_regular_file(ec))
+                    continue;
+                if (name == incomingName || IsTempName(fileName) ||
+                    (ContentHasher::IsValid(fileName) && !blobs.count(fileName)))
+                    fs::remove(file.path(), ec);
+            }
+        }
+    }
+
+    TrimLocked();
+}
+
+// Rewrites the index as one line per live entry, oldest first, and appends to it from then on
+void ContentCache::SaveLocked()
+{
+    const fs::path path = fs::path(options.Directory) / indexName;
+    journal.close();
+    try
+    {
+        AtomicFile out(path.string());
+        std::string text;
+        for (auto it = lru.rbegin(); it != lru.rend(); ++it)
+        {
+            if (it->find_first_of("\t\n") != std::string::npos)
+                continue;
+            const Entry& entry = entries.at(*it);
+            text += entry.Hash + "\t" + std::to_string(entry.Size) + "\t" + std::to_string(entry.MtimeNs) + "\t" + *it + "\n";
+        }
+        out.Write(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+        out.Commit(omnisphere::enums::FsyncPolicy::File);
+    }
+    catch (const std::exception&)
+    {
+        // Keep appending to the old index; losing it only costs a cold cache on the next start
+    }
+    journal.open(path, std::ios::app | std::ios::binary);
+    journalLines = 0;
+}
+
+} // namespace omnisphere::repositories
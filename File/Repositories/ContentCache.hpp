@@ -0,0 +1,130 @@
+#pragma once
+#include "File/Models/ContentCacheStats.hpp"
+#include "File/Repositories/AtomicFile.hpp"
+#include "File/Repositories/ContentHash.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    struct ContentCacheOptions
+    {
+        std::string Directory;                          // Empty: ~/.cache/omnisphere/content
+        uint64_t MaxBytes = 2ull << 30;
+        std::chrono::seconds RevalidateInterval{30};
+        std::vector<std::string> RemotePrefixes;        // Paths cached as if they were on a network mount
+    };
+
+    // Read-through cache on local disk for files that live on network mounts. Each cached
+    // source path points at a blob named by the BLAKE2b hash of its content, so identical
+    // files are stored once. A hit younger than RevalidateInterval is served without touching
+    // the network; an older one costs a single stat of the source and is dropped when its
+    // mtime or size changed. Blobs are evicted least recently used first down to MaxBytes.
+    // The path index next to the blobs is appended to as entries come and go, so a crash
+    // loses at most a partial line, and is rewritten compactly on Configure, on shutdown and
+    // once it has grown to twice the live entries.
+    class ContentCache
+    {
+    public:
+        // Streams the content of a file being saved into the cache (write-through)
+        class Writer
+        {
+        public:
+            ~Writer() = default;
+
+            void Write(const unsigned char* data, size_t size);
+
+            // Call after the source file itself was committed; picks up its mtime and size.
+            // The caller hashes the content anyway, so it passes the hash in. When the new
+            // content cannot be cached, the entry for the old one is dropped.
+            void Commit(const std::string& hash);
+
+        private:
+            friend class ContentCache;
+            Writer(ContentCache& cache, std::string sourcePath);
+            bool Install(const std::string& hash);
+
+            ContentCache& cache;
+            std::string sourcePath;
+            AtomicFile temp;
+            uint64_t size = 0;
+            uint64_t maxSize = 0;
+            bool skipped = false;
+        };
+
+        ContentCache() = default;
+        ~ContentCache();
+
+        ContentCache(const ContentCache&) = delete;
+        ContentCache& operator=(const ContentCache&) = delete;
+
+        static ContentCache& Instance();
+
+        // Enable (or re-point) the cache
+        void Configure(const ContentCacheOptions& options);
+        void Disable();
+        bool Enabled() const;
+
+        // Whether a file with this path, on a local or remote filesystem, should be cached
+        bool Caches(const std::string& sourcePath, bool sourceIsLocal) const;
+
+        // Local path of the cached copy of sourcePath, revalidated against the source when due
+        std::optional<std::string> Lookup(const std::string& sourcePath);
+
+        // Remember a freshly read file; mtimeNs comes from the fstat of the read
+        void Store(const std::string& sourcePath, int64_t mtimeNs, const unsigned char* data, size_t size);
+
+        // Null when disabled or when sourcePath is on a local disk
+        std::unique_ptr<Writer> BeginWrite(const std::string& sourcePath);
+
+        void Invalidate(const std::string& sourcePath);
+
+        omnisphere::models::ContentCacheStats Stats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            std::string Hash;
+            uint64_t Size = 0;
+            int64_t MtimeNs = 0;
+            Clock::time_point ValidatedAt;
+            std::list<std::string>::iterator LruIt;
+        };
+
+        struct Blob
+        {
+            uint64_t Size = 0;
+            size_t Refs = 0;
+        };
+
+        mutable std::mutex mutex;
+        std::atomic<bool> enabled{false};
+        ContentCacheOptions options;
+        std::unordered_map<std::string, Entry> entries;
+        std::unordered_map<std::string, Blob> blobs;
+        std::list<std::string> lru;                     // Source paths, most recent first
+        uint64_t totalBytes = 0;
+        omnisphere::models::ContentCacheStats stats;
+        std::ofstream journal;                          // index.tsv opened for appending
+        size_t journalLines = 0;                        // Lines appended since the last rewrite
+
+        std::string BlobPath(const std::string& hash) const;
+        void LinkLocked(const std::string& sourcePath, const std::string& hash, uint64_t size, int64_t mtimeNs);
+        void EraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+        void TrimLocked();
+        void AppendLocked(const std::string& line);
+        void LoadLocked();
+        void SaveLocked();
+    };
+} // namespace omnisphere::repositories
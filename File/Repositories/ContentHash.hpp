@@ -0,0 +1,80 @@
+#pragma once
+#include <sodium.h>
+#include <cstddef>
+#include <string>
+
+namespace omnisphere::repositories
+{
+    // Streaming BLAKE2b-256 of file content, rendered as 64 lowercase hex digits. This is
+    // the name under which content is cached and deduplicated, and what SaveFile returns.
+    class ContentHasher
+    {
+    public:
+        static constexpr size_t Bytes = crypto_generichash_BYTES;
+
+        ContentHasher()
+        {
+            static const bool ready = sodium_init() >= 0;
+            (void)ready;    // Without it libsodium falls back to its portable BLAKE2b, same result
+            crypto_generichash_init(&state, nullptr, 0, Bytes);
+        }
+
+        void Update(const unsigned char* data, size_t size)
+        {
+            crypto_generichash_update(&state, data, size);
+        }
+
+        // Only valid once per hasher
+        std::string Final()
+        {
+            unsigned char digest[Bytes];
+            crypto_generichash_final(&state, digest, sizeof(digest));
+            char hex[Bytes * 2 + 1];
+            sodium_bin2hex(hex, sizeof(hex), digest, sizeof(digest));
+            return std::string(hex);
+        }
+
+        // The running state as hex, to carry a hash across a process restart. Restore
+        // refuses a snapshot taken by a different libsodium build.
+        std::string Snapshot() const
+        {
+            std::string hex(sodium_version_string());
+            hex += ':';
+            std::string bytes(sizeof(state) * 2 + 1, '\0');
+            sodium_bin2hex(bytes.data(), bytes.size(), reinterpret_cast<const unsigned char*>(&state), sizeof(state));
+            bytes.pop_back();
+            return hex + bytes;
+        }
+
+        bool Restore(const std::string& snapshot)
+        {
+            const std::string version = std::string(sodium_version_string()) + ':';
+            if (snapshot.size() != version.size() + sizeof(state) * 2 || snapshot.compare(0, version.size(), version) != 0)
+                return false;
+            size_t length = 0;
+            return sodium_hex2bin(reinterpret_cast<unsigned char*>(&state), sizeof(state), snapshot.data() + version.size(),
+                                  sizeof(state) * 2, nullptr, &length, nullptr) == 0 && length == sizeof(state);
+        }
+
+        static std::string Of(const unsigned char* data, size_t size)
+        {
+            ContentHasher hasher;
+            hasher.Update(data, size);
+            return hasher.Final();
+        }
+
+        // Also guards paths built from a client-supplied hash
+        static bool IsValid(const std::string& hex)
+        {
+            if (hex.size() != Bytes * 2)
+                return false;
+            for (char c : hex)
+                if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+                    return false;
+            return true;
+        }
+
+    private:
+        crypto_generichash_state state;
+    };
+} // namespace omnisphere::repositories
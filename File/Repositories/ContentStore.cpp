@@ -0,0 +1,417 @@
+#include "File/Repositories/ContentStore.hpp"
+#include "File/Repositories/ContentHash.hpp"
+#include "File/Repositories/File.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+constexpr const char* defaultStoreName = ".omnisphere-store";
+
+std::string DefaultRegistry()
+{
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    return base ? std::string(base) + "\\OmniSphere\\content-stores" : "OmniSphere\\content-stores";
+#else
+    if (const char* xdg = std::getenv("XDG_STATE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/omnisphere/content-stores";
+    const char* home = std::getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.local/state/omnisphere/content-stores";
+#endif
+}
+
+std::string ErrnoMessage(const std::string& what, const std::string& path)
+{
+    return what + ": " + path + " (" + std::strerror(errno) + ")";
+}
+
+std::string ParentOf(const std::string& path)
+{
+    const fs::path parent = fs::path(path).parent_path();
+    return parent.empty() ? "." : parent.string();
+}
+
+#ifndef _WIN32
+// Mode a plain save would leave the target with: that of the file it replaces, or what
+// open() gives a new file
+mode_t TargetMode(const std::string& targetPath)
+{
+    struct stat st;
+    if (::stat(targetPath.c_str(), &st) == 0)
+        return st.st_mode & 07777;
+    const mode_t mask = ::umask(0);
+    ::umask(mask);
+    return 0666 & ~mask;
+}
+#endif
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+ContentStore::Writer::Writer(ContentStore& owner, std::string store, std::string targetPath)
+    : owner(owner), store(store), targetPath(std::move(targetPath)), temp((fs::path(store) / "incoming").string())
+{
+}
+
+void ContentStore::Writer::Write(const unsigned char* data, size_t n)
+{
+    temp.Write(data, n);
+    size += n;
+}
+
+bool ContentStore::Writer::Commit(const std::string& hash, omnisphere::enums::FsyncPolicy policy)
+{
+#ifndef _WIN32
+    std::shared_lock<std::shared_mutex> lock(owner.mutex);
+    const std::string blobPath = BlobPath(store, hash);
+
+    struct stat st;
+    const bool stored = ::stat(blobPath.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_size) == size;
+    if (!stored)
+    {
+        fs::create_directories(fs::path(blobPath).parent_path());
+        temp.SetTarget(blobPath);
+        temp.Commit(policy);
+        // A new blob takes the mode of the first file saved with it
+        ::chmod(blobPath.c_str(), TargetMode(targetPath));
+    }
+    // Otherwise the temp file is dropped with the writer
+
+    Link(blobPath, targetPath, policy);
+    return !stored;
+#else
+    (void)hash;
+    (void)policy;
+    throw std::logic_error("The content store is not available on Windows");
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// ContentStore
+// ---------------------------------------------------------------------------
+
+ContentStore::ContentStore(std::string registryPath)
+    : registryPath(registryPath.empty() ? DefaultRegistry() : std::move(registryPath))
+{
+}
+
+ContentStore& ContentStore::Instance()
+{
+    static ContentStore store;
+    return store;
+}
+
+void ContentStore::Configure(const std::vector<std::string>& directories)
+{
+#ifndef _WIN32
+    std::unordered_map<uint64_t, std::string> next;
+    for (const auto& directory : directories)
+    {
+        fs::create_directories(directory);
+        struct stat st;
+        if (::stat(directory.c_str(), &st) != 0)
+            throw std::runtime_error(ErrnoMessage("Cannot open content store", directory));
+        if (!next.emplace(static_cast<uint64_t>(st.st_dev), directory).second)
+            throw std::runtime_error("Two content stores on the same filesystem: " + next[st.st_dev] + ", " + directory);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    configured.swap(next);
+    byDevice.clear();
+    for (const auto& [device, directory] : configured)
+    {
+        byDevice[device] = directory;
+        RegisterLocked(directory);
+    }
+#else
+    (void)directories;
+#endif
+}
+
+std::string ContentStore::StoreFor(const std::string& targetPath)
+{
+#ifndef _WIN32
+    const std::string directory = ParentOf(targetPath);
+    struct stat st;
+    if (::stat(directory.c_str(), &st) != 0 || !File::IsLocalFileSystem(directory))
+        return "";      // GVFS and CIFS refuse hard links, NFS may be shared with other hosts
+    const uint64_t device = static_cast<uint64_t>(st.st_dev);
+
+    std::string store;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto known = byDevice.find(device);
+        if (known != byDevice.end())
+            return known->second;
+        auto it = configured.find(device);
+        store = it != configured.end() ? it->second : DefaultStore(directory, device);
+    }
+
+    std::error_code ec;
+    fs::create_directories(store, ec);
+    if (ec)
+        store.clear();
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto [it, added] = byDevice.emplace(device, store);
+    if (added && !store.empty())
+        RegisterLocked(store);
+    return it->second;
+#else
+    (void)targetPath;
+    return "";
+#endif
+}
+
+std::string ContentStore::DefaultStore(const std::string& directory, uint64_t device)
+{
+#ifndef _WIN32
+    // Climb to the mount root, remembering the topmost directory that can hold the store
+    std::error_code ec;
+    fs::path current = fs::absolute(directory, ec).lexically_normal();
+    fs::path writable;
+    for (;;)
+    {
+        struct stat st;
+        if (::stat(current.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_dev) != device)
+            break;
+        if (::access(current.c_str(), W_OK | X_OK) == 0 || fs::is_directory(current / defaultStoreName, ec))
+            writable = current;
+        if (!current.has_relative_path())
+            break;
+        current = current.parent_path();
+    }
+    return writable.empty() ? "" : (writable / defaultStoreName).string();
+#else
+    (void)directory;
+    (void)device;
+    return "";
+#endif
+}
+
+void ContentStore::LoadRegistryLocked()
+{
+    if (registryLoaded)
+        return;
+    registryLoaded = true;
+    std::ifstream in(registryPath);
+    std::string line;
+    while (std::getline(in, line))
+        if (!line.empty())
+            registered.insert(line);
+}
+
+void ContentStore::RegisterLocked(const std::string& store)
+{
+    LoadRegistryLocked();
+    if (store.find('\n') != std::string::npos || !registered.insert(store).second)
+        return;
+    try
+    {
+        fs::create_directories(fs::path(registryPath).parent_path());
+        std::ofstream(registryPath, std::ios::app) << store << "\n";
+    }
+    catch (const std::exception&)
+    {
+        // Still collected in this process; only a later run would miss it
+    }
+}
+
+std::unique_ptr<ContentStore::Writer> ContentStore::BeginWrite(const std::string& targetPath)
+{
+    const std::string store = StoreFor(targetPath);
+    if (store.empty())
+        return nullptr;
+    return std::unique_ptr<Writer>(new Writer(*this, store, targetPath));
+}
+
+bool ContentStore::LinkExisting(const std::string& hash, const std::string& sourcePath, const std::string& targetPath,
+                                omnisphere::enums::FsyncPolicy policy)
+{
+#ifndef _WIN32
+    const std::string store = StoreFor(targetPath);
+    if (store.empty() || sourcePath.empty())
+        return false;
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    const std::string blobPath = BlobPath(store, hash);
+    struct stat blob;
+    if (::stat(blobPath.c_str(), &blob) != 0 || !S_ISREG(blob.st_mode))
+        return false;
+
+    // Proof of possession: an open file the caller could read anyway, linked to this blob
+    const int fd = ::open(sourcePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat source;
+    const bool same = ::fstat(fd, &source) == 0 && source.st_dev == blob.st_dev && source.st_ino == blob.st_ino;
+    ::close(fd);
+    if (!same)
+        return false;
+
+    Link(blobPath, targetPath, policy);
+    return true;
+#else
+    (void)hash;
+    (void)sourcePath;
+    (void)targetPath;
+    (void)policy;
+    return false;
+#endif
+}
+
+size_t ContentStore::Collect()
+{
+    size_t removed = 0;
+#ifndef _WIN32
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    LoadRegistryLocked();
+
+    std::set<std::string> stores = registered;
+    for (const auto& [device, store] : byDevice)
+        if (!store.empty())
+            stores.insert(store);
+
+    bool pruned = false;
+    for (const auto& store : stores)
+    {
+        std::error_code ec;
+        if (!fs::is_directory(store, ec))
+        {
+            pruned |= registered.erase(store) > 0;
+            continue;
+        }
+        for (fs::recursive_directory_iterator it(store, ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (it.depth() != 1)
+                continue;
+            struct stat st;
+            const std::string path = it->path().string();
+            if (::lstat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_nlink == 1 && ::unlink(path.c_str()) == 0)
+                ++removed;
+        }
+    }
+
+    // Stores that are gone (unmounted disk, deleted folder) leave the registry
+    if (pruned)
+    {
+        try
+        {
+            std::string text;
+            for (const auto& store : registered)
+                text += store + "\n";
+            AtomicFile out(registryPath);
+            out.Write(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+            out.Commit(omnisphere::enums::FsyncPolicy::None);
+        }
+        catch (const std::exception&)
+        {
+            // Pruned again on the next Collect
+        }
+    }
+#endif
+    return removed;
+}
+
+std::string ContentStore::BlobPath(const std::string& store, const std::string& hash)
+{
+    if (!ContentHasher::IsValid(hash))
+        throw std::invalid_argument("Not a content hash: " + hash);
+    return (fs::path(store) / hash.substr(0, 2) / hash).string();
+}
+
+void ContentStore::Link(const std::string& blobPath, const std::string& targetPath, omnisphere::enums::FsyncPolicy policy)
+{
+#ifndef _WIN32
+    struct stat blob, existing;
+    if (::stat(blobPath.c_str(), &blob) != 0)
+        throw std::runtime_error(ErrnoMessage("Cannot open stored content", blobPath));
+    if (::stat(targetPath.c_str(), &existing) == 0 && existing.st_dev == blob.st_dev && existing.st_ino == blob.st_ino)
+        return;
+    // Names of one blob share its mode; a target that would get another one gets a copy
+    if ((blob.st_mode & 07777) != TargetMode(targetPath))
+    {
+        CopyInto(blobPath, targetPath, policy);
+        return;
+    }
+
+    // Link under a temporary name and rename it over the target, so the target is
+    // replaced atomically just as AtomicFile would
+    static std::atomic<unsigned> counter{0};
+    const fs::path target(targetPath);
+    const std::string prefix = (target.parent_path() / ("." + target.filename().string() + ".link-")).string() +
+                               std::to_string(::getpid()) + "-";
+    std::string tempPath;
+    for (;;)
+    {
+        tempPath = prefix + std::to_string(counter++);
+        if (::link(blobPath.c_str(), tempPath.c_str()) == 0)
+            break;
+        if (errno == EEXIST)
+            continue;
+        if (errno == EXDEV || errno == EPERM || errno == EMLINK || errno == ENOTSUP || errno == EOPNOTSUPP)
+        {
+            // No hard links here after all, or the blob ran out of them
+            CopyInto(blobPath, targetPath, policy);
+            return;
+        }
+        throw std::runtime_error(ErrnoMessage("Cannot link stored content", targetPath));
+    }
+
+    if (::rename(tempPath.c_str(), targetPath.c_str()) != 0)
+    {
+        const int err = errno;
+        ::unlink(tempPath.c_str());
+        errno = err;
+        throw std::runtime_error(ErrnoMessage("Cannot replace file", targetPath));
+    }
+
+    if (policy == omnisphere::enums::FsyncPolicy::FileAndDirectory)
+        AtomicFile::SyncDirectory(ParentOf(targetPath));
+#else
+    CopyInto(blobPath, targetPath, policy);
+#endif
+}
+
+void ContentStore::CopyInto(const std::string& blobPath, const std::string& targetPath, omnisphere::enums::FsyncPolicy policy)
+{
+    std::ifstream in(blobPath, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open stored content: " + blobPath);
+
+    AtomicFile out(targetPath);
+    std::vector<char> buffer(1 << 20);
+    while (in)
+    {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        out.Write(reinterpret_cast<const unsigned char*>(buffer.data()), static_cast<size_t>(in.gcount()));
+    }
+    if (in.bad())
+        throw std::runtime_error("Cannot read stored content: " + blobPath);
+    out.Commit(policy);
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,97 @@
+#pragma once
+#include "File/Enums/FsyncPolicy.hpp"
+#include "File/Repositories/AtomicFile.hpp"
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    // Content-addressed storage for deduplicating saves. Content is stored once per
+    // filesystem as <store>/<hh>/<hash> and every file saved with it becomes a hard link
+    // to that blob, so a logo saved under a hundred names takes the space of one. Files keep
+    // the mode a plain save gives them; a target whose mode differs from the blob's gets a
+    // copy instead of a link. Saves replace a file, which unlinks it from the blob and
+    // leaves the other names alone, but a program writing into one of the names in place
+    // changes all of them. A blob nothing links to any more has a link count of one and is
+    // removed by Collect.
+    //
+    // A target uses the configured store on its own filesystem, or else a .omnisphere-store
+    // directory in the topmost directory of that filesystem it can write to (the mount root
+    // when writable), so there is one store per filesystem. Every store used is recorded in
+    // a registry file, so Collect also reaches stores used by earlier runs. Network mounts
+    // and Windows get no store; files there are written in full.
+    class ContentStore
+    {
+    public:
+        // Streams the content of a file being saved into the store
+        class Writer
+        {
+        public:
+            ~Writer() = default;
+
+            void Write(const unsigned char* data, size_t size);
+
+            // Keep the content under its hash, unless it is already stored, and point the
+            // target at it. Returns false when identical content was already there.
+            bool Commit(const std::string& hash, omnisphere::enums::FsyncPolicy policy);
+
+        private:
+            friend class ContentStore;
+            Writer(ContentStore& owner, std::string store, std::string targetPath);
+
+            ContentStore& owner;
+            std::string store;
+            std::string targetPath;
+            AtomicFile temp;
+            uint64_t size = 0;
+        };
+
+        // registryPath: empty for ~/.local/state/omnisphere/content-stores
+        explicit ContentStore(std::string registryPath = "");
+
+        ContentStore(const ContentStore&) = delete;
+        ContentStore& operator=(const ContentStore&) = delete;
+
+        static ContentStore& Instance();
+
+        // Store directories, at most one per filesystem, created when missing
+        void Configure(const std::vector<std::string>& directories);
+
+        // Null when the target's filesystem cannot hold the store
+        std::unique_ptr<Writer> BeginWrite(const std::string& targetPath);
+
+        // Point targetPath at content already stored under this hash. Knowing the hash is not
+        // enough: sourcePath must be a file the caller can read that already links to the
+        // stored content. False when it does not, or the store for the target does not have
+        // the content, so the caller has to upload it.
+        bool LinkExisting(const std::string& hash, const std::string& sourcePath, const std::string& targetPath,
+                          omnisphere::enums::FsyncPolicy policy);
+
+        // Remove the blobs no file links to any more, in every store in the registry.
+        // Returns how many were removed.
+        size_t Collect();
+
+    private:
+        std::string registryPath;
+
+        // Held shared while linking so Collect cannot remove a blob in between
+        mutable std::shared_mutex mutex;
+        std::unordered_map<uint64_t, std::string> configured;   // Device id -> store
+        std::unordered_map<uint64_t, std::string> byDevice;     // Store in use per device, "" for none
+        std::set<std::string> registered;
+        bool registryLoaded = false;
+
+        std::string StoreFor(const std::string& targetPath);
+        void RegisterLocked(const std::string& store);
+        void LoadRegistryLocked();
+        static std::string DefaultStore(const std::string& directory, uint64_t device);
+        static std::string BlobPath(const std::string& store, const std::string& hash);
+        static void Link(const std::string& blobPath, const std::string& targetPath, omnisphere::enums::FsyncPolicy policy);
+        static void CopyInto(const std::string& blobPath, const std::string& targetPath, omnisphere::enums::FsyncPolicy policy);
+    };
+} // namespace omnisphere::repositories
@@ -0,0 +1,373 @@
+#include "File/Repositories/DirectoryCache.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+#ifdef __linux__
+// IN_MODIFY and IN_CLOSE_WRITE keep the sizes and times of IncludeMetadata listings current
+constexpr uint32_t watchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_CLOSE_WRITE |
+                               IN_DELETE_SELF | IN_MOVE_SELF | IN_ATTRIB | IN_ONLYDIR;
+#endif
+
+} // namespace
+
+DirectoryCache::DirectoryCache(size_t maxEntryBytes, size_t maxTotalBytes,
+                               std::chrono::seconds networkTtl, std::chrono::seconds networkStaleMax)
+    : maxEntryBytes(maxEntryBytes), maxTotalBytes(maxTotalBytes),
+      networkTtl(networkTtl), networkStaleMax(networkStaleMax)
+{
+#ifdef __linux__
+    inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd    = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (inotifyFd >= 0 && stopFd >= 0)
+        watcher = std::thread([this] { Watch(); });
+#endif
+    refresher = std::thread([this] { Refresh(); });
+}
+
+DirectoryCache::~DirectoryCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    refreshCv.notify_all();
+    if (refresher.joinable())
+        refresher.join();
+
+#ifdef __linux__
+    if (stopFd >= 0)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(stopFd, &one, sizeof(one));
+    }
+    if (watcher.joinable())
+        watcher.join();
+    if (stopFd >= 0)
+        ::close(stopFd);
+    if (inotifyFd >= 0)
+        ::close(inotifyFd);
+#endif
+}
+
+DirectoryCache& DirectoryCache::Instance()
+{
+    static DirectoryCache cache;
+    return cache;
+}
+
+size_t DirectoryCache::EstimateBytes(const Items& items)
+{
+    size_t bytes = sizeof(Items) + items.capacity() * sizeof(omnisphere::models::DirectoryItem);
+    for (const auto& item : items)
+        bytes += item.Name.capacity() + item.Path.capacity();
+    return bytes;
+}
+
+DirectoryCache::Items DirectoryCache::Get(const std::string& key, const std::string& watchPath, bool network,
+                                          bool forceRefresh, const Loader& loader)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto it = entries.find(key);
+    if (it != entries.end() && forceRefresh)
+    {
+        EraseLocked(it);
+        it = entries.end();
+    }
+
+    if (it != entries.end())
+    {
+        Entry& entry = it->second;
+        const auto age = Clock::now() - entry.StoredAt;
+        if (!entry.Network || age < networkTtl)
+        {
+            ++stats.Hits;
+            lru.splice(lru.begin(), lru, entry.LruIt);
+            return *entry.Listing;
+        }
+        if (age < networkStaleMax)
+        {
+            ++stats.StaleHits;
+            lru.splice(lru.begin(), lru, entry.LruIt);
+            if (!entry.Refreshing)
+            {
+                entry.Refreshing = true;
+                refreshQueue.emplace_back(key, loader);
+                refreshCv.notify_one();
+            }
+            return *entry.Listing;
+        }
+        EraseLocked(it);
+    }
+
+    ++stats.Misses;
+
+    // Arm the watch before listing so a change that races the load is not lost
+    int wd = -1;
+    uint64_t startSeq = eventSeq;
+#ifdef __linux__
+    if (!network && inotifyFd >= 0 && !watchPath.empty())
+    {
+        wd = ::inotify_add_watch(inotifyFd, watchPath.c_str(), watchMask);
+        if (wd >= 0)
+            ++watches[wd].Pending;
+    }
+#endif
+    lock.unlock();
+
+    Items items;
+    try
+    {
+        items = loader();
+    }
+    catch (...)
+    {
+        lock.lock();
+        ReleaseWatchLocked(wd);
+        throw;
+    }
+
+    auto listing = std::make_shared<const Items>(items);
+    const size_t bytes = EstimateBytes(*listing);
+
+    lock.lock();
+    bool cacheable = bytes <= maxEntryBytes;
+    bool ttlOnly   = network;
+    if (!network && wd < 0)
+    {
+        ttlOnly = true;         // No watch available: fall back to the network policy
+    }
+    else if (!network)
+    {
+        auto ws = watches.find(wd);
+        if (ws == watches.end() || ws->second.LastEvent > startSeq)
+            cacheable = false;  // Changed or removed while we were listing
+    }
+
+    if (cacheable)
+        StoreLocked(key, ttlOnly ? -1 : wd, ttlOnly, std::move(listing), bytes);
+    ReleaseWatchLocked(wd);
+    return items;
+}
+
+void DirectoryCache::StoreLocked(const std::string& key, int wd, bool network, std::shared_ptr<const Items> listing, size_t bytes)
+{
+    auto it = entries.find(key);
+    if (it != entries.end())
+        EraseLocked(it);
+
+    lru.push_front(key);
+    Entry& entry   = entries[key];
+    entry.Listing  = std::move(listing);
+    entry.Bytes    = bytes;
+    entry.Network  = network;
+    entry.Wd       = wd;
+    entry.StoredAt = Clock::now();
+    entry.LruIt    = lru.begin();
+    totalBytes += bytes;
+    if (wd >= 0)
+        watches[wd].Keys.insert(key);
+
+    while (totalBytes > maxTotalBytes && lru.size() > 1)
+        EraseLocked(entries.find(lru.back()));
+}
+
+void DirectoryCache::EraseLocked(std::unordered_map<std::string, Entry>::iterator it)
+{
+    Entry& entry = it->second;
+    totalBytes -= entry.Bytes;
+    lru.erase(entry.LruIt);
+    const int wd = entry.Wd;
+    if (wd >= 0)
+    {
+        auto ws = watches.find(wd);
+        if (ws != watches.end())
+            ws->second.Keys.erase(it->first);
+    }
+    entries.erase(it);
+    if (wd >= 0)
+    {
+        auto ws = watches.find(wd);
+        if (ws != watches.end() && ws->second.Keys.empty() && ws->second.Pending == 0)
+        {
+#ifdef __linux__
+            ::inotify_rm_watch(inotifyFd, wd);
+#endif
+            watches.erase(ws);
+        }
+    }
+}
+
+void DirectoryCache::ReleaseWatchLocked(int wd)
+{
+    if (wd < 0)
+        return;
+    auto ws = watches.find(wd);
+    if (ws == watches.end())
+        return;
+    --ws->second.Pending;
+    if (ws->second.Keys.empty() && ws->second.Pending == 0)
+    {
+#ifdef __linux__
+        ::inotify_rm_watch(inotifyFd, wd);
+#endif
+        watches.erase(ws);
+    }
+}
+
+void DirectoryCache::InvalidateWatchLocked(int wd, bool watchGone)
+{
+    auto ws = watches.find(wd);
+    if (ws == watches.end())
+        return;
+
+    ws->second.LastEvent = ++eventSeq;
+    const std::vector<std::string> keys(ws->second.Keys.begin(), ws->second.Keys.end());
+    // Keep the state alive while we erase so EraseLocked does not drop the watch mid-loop
+    ++ws->second.Pending;
+    for (const auto& key : keys)
+    {
+        auto it = entries.find(key);
+        if (it != entries.end())
+            EraseLocked(it);
+    }
+
+    ws = watches.find(wd);
+    --ws->second.Pending;
+    if (watchGone)
+    {
+        // Loads still holding this wd see the missing state and skip caching
+        watches.erase(ws);
+    }
+    else if (ws->second.Keys.empty() && ws->second.Pending == 0)
+    {
+#ifdef __linux__
+        ::inotify_rm_watch(inotifyFd, wd);
+#endif
+        watches.erase(ws);
+    }
+}
+
+void DirectoryCache::Invalidate(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it != entries.end())
+        EraseLocked(it);
+}
+
+void DirectoryCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!entries.empty())
+        EraseLocked(entries.begin());
+    ++eventSeq;
+    for (auto& [wd, state] : watches)
+        state.LastEvent = eventSeq;
+}
+
+DirectoryCacheStats DirectoryCache::Stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    DirectoryCacheStats result = stats;
+    result.Entries = entries.size();
+    result.Bytes   = totalBytes;
+    return result;
+}
+
+void DirectoryCache::Watch()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[8192];
+    for (;;)
+    {
+        pollfd fds[2] = {{stopFd, POLLIN, 0}, {inotifyFd, POLLIN, 0}};
+        const int rc = ::poll(fds, 2, -1);
+        if (rc < 0 && errno != EINTR)
+            return;
+        if (fds[0].revents)
+            return;
+        if (!(fds[1].revents & POLLIN))
+            continue;
+
+        ssize_t n;
+        while ((n = ::read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (ssize_t off = 0; off < n;)
+            {
+                const auto* ev = reinterpret_cast<const inotify_event*>(buffer + off);
+                off += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+
+                if (ev->mask & IN_Q_OVERFLOW)
+                {
+                    // Events were lost: nothing local can be trusted any more
+                    std::vector<int> wds;
+                    for (const auto& [wd, state] : watches)
+                        wds.push_back(wd);
+                    for (int wd : wds)
+                        InvalidateWatchLocked(wd, false);
+                    continue;
+                }
+                InvalidateWatchLocked(ev->wd, (ev->mask & IN_IGNORED) != 0);
+            }
+        }
+    }
+#endif
+}
+
+void DirectoryCache::Refresh()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        refreshCv.wait(lock, [this] { return stopping || !refreshQueue.empty(); });
+        if (stopping)
+            return;
+
+        auto [key, loader] = std::move(refreshQueue.front());
+        refreshQueue.pop_front();
+        lock.unlock();
+
+        std::shared_ptr<const Items> listing;
+        try
+        {
+            listing = std::make_shared<const Items>(loader());
+        }
+        catch (...)
+        {
+            // Keep serving the stale listing; the next stale hit retries
+        }
+
+        lock.lock();
+        auto it = entries.find(key);
+        if (it == entries.end() || !it->second.Network)
+            continue;
+        if (!listing)
+        {
+            it->second.Refreshing = false;
+            continue;
+        }
+
+        ++stats.Refreshes;
+        const size_t bytes = EstimateBytes(*listing);
+        if (bytes > maxEntryBytes)
+            EraseLocked(it);
+        else
+            StoreLocked(key, -1, true, std::move(listing), bytes);
+    }
+}
+
+} // namespace omnisphere::repositories
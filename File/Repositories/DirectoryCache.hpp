@@ -0,0 +1,114 @@
+#pragma once
+#include "File/Models/DirectoryItem.hpp"
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    struct DirectoryCacheStats
+    {
+        size_t Entries = 0;
+        size_t Bytes = 0;
+        size_t Hits = 0;
+        size_t Misses = 0;
+        size_t StaleHits = 0;
+        size_t Refreshes = 0;
+    };
+
+    // Listing cache keyed by resolved directory. Local directories stay cached until
+    // inotify reports a change in them; network directories (GVFS, NFS, SMB) are fresh
+    // for networkTtl and then served stale for up to networkStaleMax while one
+    // background refresh runs. Listings above maxEntryBytes are never cached and the
+    // whole cache is trimmed LRU-first to maxTotalBytes.
+    class DirectoryCache
+    {
+    public:
+        using Items  = std::vector<omnisphere::models::DirectoryItem>;
+        using Loader = std::function<Items()>;
+
+        DirectoryCache(size_t maxEntryBytes = 4 << 20, size_t maxTotalBytes = 64 << 20,
+                       std::chrono::seconds networkTtl = std::chrono::seconds(5),
+                       std::chrono::seconds networkStaleMax = std::chrono::seconds(60));
+        ~DirectoryCache();
+
+        DirectoryCache(const DirectoryCache&) = delete;
+        DirectoryCache& operator=(const DirectoryCache&) = delete;
+
+        static DirectoryCache& Instance();
+
+        // Returns the cached listing for `key` or runs `loader` and caches its result.
+        // `watchPath` is the local directory inotify should watch; ignored for network entries.
+        Items Get(const std::string& key, const std::string& watchPath, bool network, bool forceRefresh, const Loader& loader);
+
+        void Invalidate(const std::string& key);
+        void Clear();
+
+        DirectoryCacheStats Stats() const;
+
+        // Rough heap footprint of a listing, used for the budgets
+        static size_t EstimateBytes(const Items& items);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            std::shared_ptr<const Items> Listing;
+            size_t Bytes = 0;
+            bool Network = false;
+            bool Refreshing = false;
+            int Wd = -1;
+            Clock::time_point StoredAt;
+            std::list<std::string>::iterator LruIt;
+        };
+
+        size_t maxEntryBytes;
+        size_t maxTotalBytes;
+        std::chrono::seconds networkTtl;
+        std::chrono::seconds networkStaleMax;
+
+        // One inotify watch can back several keys and in-flight loads; LastEvent tells a
+        // load that started before a change not to cache what it read.
+        struct WatchState
+        {
+            std::unordered_set<std::string> Keys;
+            int Pending = 0;
+            uint64_t LastEvent = 0;
+        };
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::list<std::string> lru;
+        std::unordered_map<int, WatchState> watches;
+        uint64_t eventSeq = 0;
+        size_t totalBytes = 0;
+        DirectoryCacheStats stats;
+
+        int inotifyFd = -1;
+        int stopFd = -1;
+        std::thread watcher;
+
+        std::thread refresher;
+        std::condition_variable refreshCv;
+        std::deque<std::pair<std::string, Loader>> refreshQueue;
+        bool stopping = false;
+
+        void StoreLocked(const std::string& key, int wd, bool network, std::shared_ptr<const Items> listing, size_t bytes);
+        void EraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+        void ReleaseWatchLocked(int wd);
+        void InvalidateWatchLocked(int wd, bool watchGone);
+        void Watch();
+        void Refresh();
+    };
+} // namespace omnisphere::repositories
@@ -0,0 +1,265 @@
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace omnisphere::repositories
+{
+
+using omnisphere::enums::FileType;
+
+#ifdef __linux__
+
+namespace
+{
+
+// Layout of the records returned by getdents64, which glibc does not declare
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+constexpr size_t bufferSize = 64 * 1024;
+
+FileType FromDType(unsigned char type)
+{
+    switch (type)
+    {
+    case DT_DIR: return FileType::Directory;
+    case DT_REG: return FileType::File;
+    case DT_LNK: return FileType::Symlink;
+    case DT_UNKNOWN: return FileType::Unknown;
+    default: return FileType::Other;
+    }
+}
+
+FileType FromMode(unsigned mode)
+{
+    if (S_ISDIR(mode)) return FileType::Directory;
+    if (S_ISREG(mode)) return FileType::File;
+    if (S_ISLNK(mode)) return FileType::Symlink;
+    return FileType::Other;
+}
+
+} // namespace
+
+DirectoryEnumerator::DirectoryEnumerator(const std::string& path, bool withMetadata)
+    : withMetadata(withMetadata)
+{
+    fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0)
+        buffer.resize(bufferSize);
+    else
+        error = errno;
+}
+
+DirectoryEnumerator::~DirectoryEnumerator()
+{
+    if (fd >= 0)
+        ::close(fd);
+}
+
+bool DirectoryEnumerator::IsOpen() const
+{
+    return fd >= 0;
+}
+
+bool DirectoryEnumerator::Fill()
+{
+    if (exhausted || fd < 0)
+        return false;
+
+    const long n = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+    ++counters.GetdentsCalls;
+    if (n <= 0)
+    {
+        if (n < 0)
+            error = errno;
+        exhausted = true;
+        return false;
+    }
+    bufferPos = 0;
+    bufferEnd = static_cast<size_t>(n);
+    return true;
+}
+
+void DirectoryEnumerator::Stat(DirectoryEntry& entry)
+{
+    ++counters.StatCalls;
+#ifdef STATX_TYPE
+    struct statx stx;
+    unsigned mask = STATX_TYPE | (withMetadata ? (STATX_SIZE | STATX_MTIME) : 0);
+    // DONT_SYNC lets network filesystems answer from their attribute cache
+    if (::statx(fd, entry.Name.c_str(), AT_STATX_DONT_SYNC, mask, &stx) == 0)
+    {
+        if (stx.stx_mask & STATX_TYPE)
+            entry.Type = FromMode(stx.stx_mode);
+        if (withMetadata && (stx.stx_mask & STATX_SIZE))
+            entry.Size = stx.stx_size;
+        if (withMetadata && (stx.stx_mask & STATX_MTIME))
+            entry.ModifiedAt = static_cast<int64_t>(stx.stx_mtime.tv_sec) * 1000 + stx.stx_mtime.tv_nsec / 1000000;
+        return;
+    }
+#else
+    struct stat st;
+    if (::fstatat(fd, entry.Name.c_str(), &st, 0) == 0)
+    {
+        entry.Type = FromMode(st.st_mode);
+        if (withMetadata)
+        {
+            entry.Size       = static_cast<uint64_t>(st.st_size);
+            entry.ModifiedAt = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+        }
+        return;
+    }
+#endif
+    // Dangling symlink or entry removed since getdents: keep what d_type said
+}
+
+bool DirectoryEnumerator::Identity(uint64_t& device, uint64_t& inode, int64_t* modifiedNs) const
+{
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0)
+        return false;
+    device = static_cast<uint64_t>(st.st_dev);
+    inode  = static_cast<uint64_t>(st.st_ino);
+    if (modifiedNs)
+        *modifiedNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+void DirectoryEnumerator::Seek(uint64_t pos)
+{
+    if (fd < 0)
+        return;
+    // d_off cookies are only meaningful to lseek on the same directory
+    ::lseek(fd, static_cast<off_t>(pos), SEEK_SET);
+    bufferPos = bufferEnd = 0;
+    exhausted = false;
+    position  = pos;
+}
+
+bool DirectoryEnumerator::Next(DirectoryEntry& entry)
+{
+    for (;;)
+    {
+        if (bufferPos >= bufferEnd && !Fill())
+            return false;
+
+        const auto* d = reinterpret_cast<const LinuxDirent64*>(buffer.data() + bufferPos);
+        bufferPos += d->d_reclen;
+        position = static_cast<uint64_t>(d->d_off);
+
+        const char* name = d->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+
+        entry.Name.assign(name);
+        entry.Type = FromDType(d->d_type);
+        entry.Size.reset();
+        entry.ModifiedAt.reset();
+
+        // Symlinks are reported as what they point to, matching directory_entry::is_directory
+        if (withMetadata || entry.Type == FileType::Unknown || entry.Type == FileType::Symlink)
+            Stat(entry);
+
+        ++counters.Entries;
+        return true;
+    }
+}
+
+#else
+
+DirectoryEnumerator::DirectoryEnumerator(const std::string& path, bool withMetadata)
+    : withMetadata(withMetadata)
+{
+    std::error_code ec;
+    iter = std::filesystem::directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec);
+    open = !ec;
+    if (ec)
+        error = ec.value();
+}
+
+DirectoryEnumerator::~DirectoryEnumerator() = default;
+
+bool DirectoryEnumerator::IsOpen() const
+{
+    return open;
+}
+
+bool DirectoryEnumerator::Next(DirectoryEntry& entry)
+{
+    std::error_code ec;
+    if (!open || iter == std::filesystem::directory_iterator())
+        return false;
+
+    const auto& de = *iter;
+    entry.Name = de.path().filename().string();
+    entry.Size.reset();
+    entry.ModifiedAt.reset();
+
+    ++counters.StatCalls;
+    if (de.is_directory(ec))
+        entry.Type = FileType::Directory;
+    else if (de.is_regular_file(ec))
+        entry.Type = FileType::File;
+    else if (ec)
+        entry.Type = FileType::Unknown;
+    else
+        entry.Type = FileType::Other;
+
+    if (withMetadata)
+    {
+        if (entry.Type == FileType::File)
+        {
+            const auto size = de.file_size(ec);
+            if (!ec) entry.Size = size;
+        }
+        const auto mtime = de.last_write_time(ec);
+        if (!ec)
+        {
+            const auto sys = std::chrono::clock_cast<std::chrono::system_clock>(mtime);
+            entry.ModifiedAt = std::chrono::duration_cast<std::chrono::milliseconds>(sys.time_since_epoch()).count();
+        }
+    }
+
+    iter.increment(ec);
+    if (ec)
+        open = false;
+    ++counters.Entries;
+    ++position;
+    return true;
+}
+
+void DirectoryEnumerator::Seek(uint64_t pos)
+{
+    std::error_code ec;
+    while (position < pos && open && iter != std::filesystem::directory_iterator())
+    {
+        iter.increment(ec);
+        if (ec)
+            open = false;
+        ++position;
+    }
+}
+
+bool DirectoryEnumerator::Identity(uint64_t&, uint64_t&, int64_t*) const
+{
+    return false;
+}
+
+#endif
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,84 @@
+#pragma once
+#include "File/Enums/FileType.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#ifndef __linux__
+#include <filesystem>
+#endif
+
+namespace omnisphere::repositories
+{
+    struct DirectoryEntry
+    {
+        std::string Name;
+        omnisphere::enums::FileType Type = omnisphere::enums::FileType::Unknown;
+        std::optional<uint64_t> Size;
+        std::optional<int64_t> ModifiedAt;      // Unix time in milliseconds
+    };
+
+    struct DirectoryEnumeratorCounters
+    {
+        size_t Entries = 0;
+        size_t GetdentsCalls = 0;
+        size_t StatCalls = 0;
+    };
+
+    // Streams the entries of one directory. On Linux it reads raw getdents64 records into a
+    // reused buffer and takes the type from d_type; statx (relative to the directory fd) is
+    // only issued for DT_UNKNOWN and symlinks, or for every entry when metadata is requested.
+    // "." and ".." are skipped.
+    class DirectoryEnumerator
+    {
+    public:
+        explicit DirectoryEnumerator(const std::string& path, bool withMetadata = false);
+        ~DirectoryEnumerator();
+
+        DirectoryEnumerator(const DirectoryEnumerator&) = delete;
+        DirectoryEnumerator& operator=(const DirectoryEnumerator&) = delete;
+
+        // False when the directory could not be opened
+        bool IsOpen() const;
+
+        // errno of the failed open or read, 0 while nothing failed
+        int Error() const { return error; }
+
+        // Fills `entry` with the next entry; false at the end of the directory
+        bool Next(DirectoryEntry& entry);
+
+        // Opaque resume point just past the last entry returned by Next
+        uint64_t Position() const { return position; }
+
+        // Resume at a value previously returned by Position
+        void Seek(uint64_t pos);
+
+        // Device and inode of the open directory, where the platform exposes them, and
+        // optionally its mtime in nanoseconds
+        bool Identity(uint64_t& device, uint64_t& inode, int64_t* modifiedNs = nullptr) const;
+
+        const DirectoryEnumeratorCounters& Counters() const { return counters; }
+
+    private:
+        bool withMetadata;
+        DirectoryEnumeratorCounters counters;
+        uint64_t position = 0;      // getdents64 d_off on Linux, entry index elsewhere
+        int error = 0;
+
+#ifdef __linux__
+        int fd = -1;
+        std::vector<char> buffer;
+        size_t bufferPos = 0;
+        size_t bufferEnd = 0;
+        bool exhausted = false;
+
+        bool Fill();
+        void Stat(DirectoryEntry& entry);
+#else
+        std::filesystem::directory_iterator iter;
+        bool open = false;
+#endif
+    };
+} // namespace omnisphere::repositories
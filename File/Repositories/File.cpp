@@ -1,4 +1,14 @@
+#include "File/Repositories/DirectoryCache.hpp"
+#include "File/Repositories/ContentCache.hpp"
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include "File/Repositories/LeasedMappings.hpp"
+#include "File/Codecs/Base64.hpp"
 #include "File/Repositories/File.hpp"
+#include "File/Repositories/MountManager.hpp"
+#include "File/Repositories/MountTable.hpp"
+#include "File/Repositories/PermissionProbe.hpp"
+#include "File/Repositories/TreeWalker.hpp"
+#include "File/Repositories/WorkStealingPool.hpp"
 #include <filesystem>
 #include <fstream>
 #include <algorithm>
@@ -6,15 +16,27 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <climits>
+#include <cctype>
+#include <string_view>
+#include <cerrno>
 
 #include <unordered_map>
 #include <mutex>
+#include <chrono>
 
 #ifndef _WIN32
 #include <unistd.h>
 #include <sys/types.h>
 #include <pwd.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+#ifdef __linux__
+#include <sys/vfs.h>
 #endif
 
 namespace fs = std::filesystem;
@@ -151,6 +173,23 @@ std::string File::ResolvePath(const std::string& rawPath)
 {
     if (rawPath.empty()) return "";
 
+    // Only network URIs go through the mount table; local paths are a single stat anyway
+    const bool network = rawPath.rfind("smb:", 0) == 0 || rawPath.rfind("nfs:", 0) == 0 || rawPath.rfind("\\\\", 0) == 0;
+    if (!network)
+        return ResolvePathUncached(rawPath);
+
+    MountTable& mounts = MountTable::Instance();
+    if (auto cached = mounts.Lookup(rawPath))
+        return *cached;
+
+    std::string resolved = ResolvePathUncached(rawPath);
+    if (!resolved.empty())
+        mounts.Remember(rawPath, resolved);
+    return resolved;
+}
+
+std::string File::ResolvePathUncached(const std::string& rawPath)
+{
     std::string path = rawPath;
     if (fs::exists(path) && fs::is_directory(path))
         return path;
@@ -172,37 +211,57 @@ std::string File::ResolvePath(const std::string& rawPath)
         std::string subPath = (slash2 != std::string::npos) ? rest.substr(slash2) : "";
 
 #ifndef _WIN32
-        uid_t uid = getuid();
-        std::string gvfsDir = "/run/user/" + std::to_string(uid) + "/gvfs";
-        if (fs::exists(gvfsDir))
+        MountTable& mounts = MountTable::Instance();
+        auto table = mounts.Current();
+        if (table->GvfsExists)
         {
             std::string lowerServer = ToLower(server);
             std::string lowerShare  = ToLower(share);
-            std::error_code ec;
 
-            if (lowerServer.empty()) return gvfsDir;
+            if (lowerServer.empty()) return mounts.GvfsRoot();
 
             std::vector<fs::path> matchingServerEntries;
 
-            for (const auto& entry : fs::directory_iterator(gvfsDir, ec))
+            auto tryShare = [&](const MountTable::Mount& m) -> std::string
+            {
+                std::string target = m.Path + (subPath.empty() || subPath[0] == '/' ? subPath : "/" + subPath);
+                std::error_code checkEc;
+                if (subPath.empty() || fs::exists(target, checkEc)) return target;
+                return "";
+            };
+
+            // Exact server/share hits from the parsed table first
+            if (!lowerShare.empty())
+            {
+                auto exact = table->ByServerShare.find(lowerServer + "/" + lowerShare);
+                if (exact != table->ByServerShare.end())
+                {
+                    for (size_t idx : exact->second)
+                    {
+                        std::string target = tryShare(table->Mounts[idx]);
+                        if (!target.empty()) return target;
+                    }
+                }
+            }
+
+            // Then the loose substring match the plain directory scan used to do
+            for (const auto& m : table->Mounts)
             {
-                std::string dirName = entry.path().filename().string();
-                std::string lowerDir = ToLower(dirName);
+                const std::string& lowerDir = m.Name;
 
                 bool serverMatches = (lowerDir.find("server=" + lowerServer) != std::string::npos || lowerDir.find(lowerServer) != std::string::npos);
 
                 if (serverMatches)
                 {
-                    matchingServerEntries.push_back(entry.path());
+                    matchingServerEntries.push_back(m.Path);
 
                     if (!lowerShare.empty())
                     {
                         bool shareMatches = (lowerDir.find("share=" + lowerShare) != std::string::npos || lowerDir.find(lowerShare) != std::string::npos);
                         if (shareMatches)
                         {
-                            std::string target = entry.path().string() + (subPath.empty() || subPath[0] == '/' ? subPath : "/" + subPath);
-                            std::error_code checkEc;
-                            if (subPath.empty() || fs::exists(target, checkEc)) return target;
+                            std::string target = tryShare(m);
+                            if (!target.empty()) return target;
                         }
                     }
                 }
@@ -269,12 +328,12 @@ std::string File::ResolvePath(const std::string& rawPath)
     return "";
 }
 
-std::string File::AutoMountNetworkUri(const std::string& uri, const std::string& inputUser, const std::string& inputPass, const std::string& inputDom) const
+std::optional<omnisphere::dtos::ConnectNetworkShare> File::ShareFromUri(const std::string& uri, const std::string& inputUser, const std::string& inputPass, const std::string& inputDom)
 {
-    if (uri.empty() || !IsNetworkUri(uri)) return "";
+    if (uri.empty() || !IsNetworkUri(uri)) return std::nullopt;
 
     std::string lower = ToLower(uri);
-    if (lower.rfind("smb://", 0) != 0 && lower.rfind("nfs://", 0) != 0) return "";
+    if (lower.rfind("smb://", 0) != 0 && lower.rfind("nfs://", 0) != 0) return std::nullopt;
 
     std::string protocol = lower.rfind("nfs://", 0) == 0 ? "nfs" : "smb";
     std::string raw = uri.substr(6);
@@ -313,18 +372,176 @@ std::string File::AutoMountNetworkUri(const std::string& uri, const std::string&
     if (!username.empty()) dto.Username = username;
     if (!password.empty()) dto.Password = password;
     if (!domain.empty())   dto.Domain   = domain;
+    return dto;
+}
+
+std::string File::AutoMountNetworkUri(const std::string& uri, const std::string& inputUser, const std::string& inputPass, const std::string& inputDom) const
+{
+    auto share = ShareFromUri(uri, inputUser, inputPass, inputDom);
+    if (!share) return "";
 
-    std::string dummyErr;
-    MountShare(dto, dummyErr);
+    // Joins a mount already running for this share, or fails fast while a recent failure backs off
+    Mounter().Mount(*share).wait();
 
     return ResolvePath(uri);
 }
 
+std::string File::ResolveOrMount(const std::string& path) const
+{
+    std::string resolved = ResolvePath(path);
+    if (resolved.empty() && IsNetworkUri(path))
+        resolved = AutoMountNetworkUri(path);
+    return resolved;
+}
+
+std::string File::Remount(const std::string& uri) const
+{
+    auto share = ShareFromUri(uri, "", "", "");
+    if (!share) return ResolvePath(uri);
+
+#ifndef _WIN32
+    // A GVFS mount whose server dropped the session keeps its directory but fails every call,
+    // so "gio mount" alone would report it as already mounted
+    std::string shareUri = share->Protocol + "://" + share->Server + (share->Share ? "/" + *share->Share : "");
+    std::string cmd = "timeout 10s gio mount -u " + EscapeShellArg(shareUri) + " 2>&1";
+    if (FILE* pipe = ::popen(cmd.c_str(), "r"))
+    {
+        char buffer[256];
+        while (fgets(buffer, sizeof(buffer), pipe) != NULL) {}
+        ::pclose(pipe);
+    }
+#endif
+
+    MountTable::Instance().Invalidate();
+    Mounter().Mount(*share, true).wait();
+    return ResolvePath(uri);
+}
+
+void File::WhenReachable(const std::string& path, const std::string& username, const std::string& password,
+                         const std::string& domain, std::function<void()> task) const
+{
+    auto share = IsNetworkUri(path) && ResolvePath(path).empty() ? ShareFromUri(path, username, password, domain) : std::nullopt;
+    if (!share)
+    {
+        WorkStealingPool::Instance().Submit(std::move(task));
+        return;
+    }
+
+    // The task runs whatever the outcome: a failed mount surfaces as the task's own error
+    Mounter().Mount(*share, false, [task = std::move(task)](const MountOutcome&) mutable
+    {
+        WorkStealingPool::Instance().Submit(std::move(task));
+    });
+}
+
 // ---------------------------------------------------------------------------
 // ReadDir
 // ---------------------------------------------------------------------------
 
+bool File::KeepEntry(omnisphere::enums::FileType type, bool network, bool includeFiles)
+{
+    if (includeFiles)
+        return true;
+    // Locally only directories (or entries even statx could not type) are listed;
+    // network listings only drop what is known to be a regular file
+    if (!network)
+        return type == omnisphere::enums::FileType::Directory || type == omnisphere::enums::FileType::Unknown;
+    return type != omnisphere::enums::FileType::File;
+}
+
+omnisphere::models::DirectoryItem File::MakeItem(const DirectoryEntry& entry, const fs::path& targetPath,
+                                                 const std::string& requestedPath, bool isNet, bool gvfsTarget)
+{
+    const std::string& filename = entry.Name;
+    omnisphere::models::DirectoryItem item;
+
+    if (gvfsTarget && filename.rfind("smb-share:", 0) == 0)
+    {
+        size_t sPos = filename.find("server=");
+        size_t shPos = filename.find("share=");
+        std::string serverName = (sPos != std::string::npos) ? filename.substr(sPos + 7, filename.find_first_of(",/", sPos) - (sPos + 7)) : "";
+        std::string shareName  = (shPos != std::string::npos) ? filename.substr(shPos + 6, filename.find_first_of(",/", shPos) - (shPos + 6)) : "";
+
+        if (requestedPath == "smb://" || requestedPath == "smb:" || requestedPath.empty())
+        {
+            item.Name = serverName;
+            item.Path = "smb://" + serverName;
+        }
+        else
+        {
+            item.Name = serverName + (shareName.empty() ? "" : " / " + shareName);
+            item.Path = "smb://" + serverName + (shareName.empty() ? "" : "/" + shareName);
+        }
+        item.IsDirectory = true;
+    }
+    else
+    {
+        item.Name = filename;
+        item.IsDirectory = entry.Type == omnisphere::enums::FileType::Directory;
+
+        if (isNet)
+        {
+            std::string baseUri = requestedPath;
+            while (!baseUri.empty() && (baseUri.back() == '/' || baseUri.back() == '\\'))
+                baseUri.pop_back();
+            item.Path = baseUri + "/" + filename;
+        }
+        else
+        {
+            item.Path = (targetPath / filename).string();
+        }
+    }
+
+    item.Type       = entry.Type;
+    item.Size       = entry.Size;
+    item.ModifiedAt = entry.ModifiedAt;
+    return item;
+}
+
 std::vector<omnisphere::models::DirectoryItem> File::ReadDir(const omnisphere::dtos::ListDirectory& input) const
+{
+    std::string requestedPath = input.Path.value_or("");
+    std::string resolvedPath  = ResolvePath(requestedPath);
+
+    // Local listings are watched by the directory actually read
+    std::string listedPath = resolvedPath.empty() ? GetUserHomeDirectory() : resolvedPath;
+    std::error_code ec;
+    if (!fs::is_directory(listedPath, ec))
+        listedPath = fs::path(listedPath).parent_path().string();
+
+    const bool network = IsNetworkUri(requestedPath) || IsNetworkUri(resolvedPath) ||
+                         (resolvedPath.empty() && !requestedPath.empty()) || !IsLocalFileSystem(listedPath);
+
+    // The loader outlives this call in the background refresh queue, so it must not carry
+    // credentials: a share that needs them is mounted here, and the loader then finds it mounted
+    omnisphere::dtos::ListDirectory query = input;
+    if (network && resolvedPath.empty() && (input.Username || input.Password || input.Domain) &&
+        requestedPath != "smb://" && requestedPath != "nfs://")
+    {
+        resolvedPath = AutoMountNetworkUri(requestedPath, input.Username.value_or(""), input.Password.value_or(""),
+                                           input.Domain.value_or(""));
+    }
+    query.Username.reset();
+    query.Password.reset();
+    query.Domain.reset();
+
+    // Items embed the requested path (network URIs, GVFS share names), so it is part of the key
+    std::string requestedKey = requestedPath;
+    if (!IsNetworkUri(requestedKey) && !requestedKey.empty())
+        requestedKey = fs::path(requestedKey).lexically_normal().string();
+    while (requestedKey.size() > 1 && (requestedKey.back() == '/' || requestedKey.back() == '\\'))
+        requestedKey.pop_back();
+
+    std::string key = (network ? resolvedPath : listedPath) + "\n" + requestedKey;
+    if (input.IncludeMetadata.value_or(false))
+        key += "\nmeta";
+
+    File repo = *this;
+    return DirectoryCache::Instance().Get(key, listedPath, network, input.ForceRefresh.value_or(false),
+        [repo, query] { return repo.ReadDirUncached(query); });
+}
+
+std::vector<omnisphere::models::DirectoryItem> File::ReadDirUncached(const omnisphere::dtos::ListDirectory& input) const
 {
     std::vector<omnisphere::models::DirectoryItem> items;
 
@@ -378,73 +595,19 @@ std::vector<omnisphere::models::DirectoryItem> File::ReadDir(const omnisphere::d
     {
         if (!fs::is_directory(targetPath, ec)) targetPath = targetPath.parent_path();
 
-        std::error_code dirEc;
-        fs::directory_iterator iter(targetPath, fs::directory_options::skip_permission_denied, dirEc);
-        if (!dirEc)
+        const bool gvfsTarget = targetPath.string().find("/gvfs") != std::string::npos;
+        DirectoryEnumerator dir(targetPath.string(), input.IncludeMetadata.value_or(false));
+        if (dir.IsOpen())
         {
-            for (const auto& entry : iter)
+            DirectoryEntry entry;
+            while (dir.Next(entry))
             {
-                std::string filename = entry.path().filename().string();
+                const std::string& filename = entry.Name;
                 if (filename.empty() || filename[0] == '.') continue;
 
-                bool isDir = true;
-                if (!isNet && targetPath.string().find("/gvfs") == std::string::npos)
-                {
-                    std::error_code statusEc;
-                    isDir = entry.is_directory(statusEc);
-                    if (statusEc)
-                    {
-                        statusEc.clear();
-                        isDir = !fs::is_regular_file(entry.path(), statusEc);
-                    }
-                    if (!isDir) continue;
-                }
-                else
-                {
-                    std::error_code regEc;
-                    if (fs::is_regular_file(entry.path(), regEc)) continue;
-                }
-
-                omnisphere::models::DirectoryItem item;
-
-                if (targetPath.string().find("/gvfs") != std::string::npos && filename.rfind("smb-share:", 0) == 0)
-                {
-                    size_t sPos = filename.find("server=");
-                    size_t shPos = filename.find("share=");
-                    std::string serverName = (sPos != std::string::npos) ? filename.substr(sPos + 7, filename.find_first_of(",/", sPos) - (sPos + 7)) : "";
-                    std::string shareName  = (shPos != std::string::npos) ? filename.substr(shPos + 6, filename.find_first_of(",/", shPos) - (shPos + 6)) : "";
-
-                    if (requestedPath == "smb://" || requestedPath == "smb:" || requestedPath.empty())
-                    {
-                        item.Name = serverName;
-                        item.Path = "smb://" + serverName;
-                    }
-                    else
-                    {
-                        item.Name = serverName + (shareName.empty() ? "" : " / " + shareName);
-                        item.Path = "smb://" + serverName + (shareName.empty() ? "" : "/" + shareName);
-                    }
-                    item.IsDirectory = true;
-                }
-                else
-                {
-                    item.Name = filename;
-                    item.IsDirectory = true;
+                if (!KeepEntry(entry.Type, isNet || gvfsTarget, false)) continue;
 
-                    if (isNet)
-                    {
-                        std::string baseUri = requestedPath;
-                        while (!baseUri.empty() && (baseUri.back() == '/' || baseUri.back() == '\\'))
-                            baseUri.pop_back();
-                        item.Path = baseUri + "/" + filename;
-                    }
-                    else
-                    {
-                        item.Path = entry.path().string();
-                    }
-                }
-
-                items.push_back(item);
+                items.push_back(MakeItem(entry, targetPath, requestedPath, isNet, gvfsTarget));
             }
         }
     }
@@ -473,46 +636,481 @@ std::vector<omnisphere::models::DirectoryItem> File::ReadDir(const omnisphere::d
 }
 
 // ---------------------------------------------------------------------------
-// TestPermissions
+// ReadDirPage
 // ---------------------------------------------------------------------------
 
-omnisphere::models::DirectoryPermissions File::TestPermissions(const omnisphere::dtos::ValidateDirectoryPermissions& input) const
+namespace
 {
-    omnisphere::models::DirectoryPermissions result;
-    result.Path          = input.Path;
-    result.HasReadAccess = false;
-    result.HasWriteAccess = false;
 
-    std::string resolved = ResolvePath(input.Path);
-    if (resolved.empty()) return result;
+using omnisphere::enums::DirectorySortKey;
 
-    fs::path dirPath(resolved);
-    if (!fs::exists(dirPath) || !fs::is_directory(dirPath)) return result;
+// Continuation tokens are base64url of "v3|<mode>|<listing>|<payload>". <listing> is a hash of
+// the path and every option that shapes the listing, so a token only resumes the listing it
+// came from. The payload is the enumerator position for unsorted pages, or the sort key of the
+// last item returned for sorted ones.
+struct PageCursor
+{
+    std::optional<uint64_t> Position;
+    std::optional<int64_t> ModifiedAt;
+    std::optional<std::string> Name;
+};
 
-    // Test read: iterate at least one entry
-    std::error_code ec;
-    fs::directory_iterator it(dirPath, fs::directory_options::skip_permission_denied, ec);
-    result.HasReadAccess = (!ec);
+char TokenMode(DirectorySortKey sortBy)
+{
+    switch (sortBy)
+    {
+    case DirectorySortKey::Name: return 'n';
+    case DirectorySortKey::ModifiedAt: return 'm';
+    default: return 'o';
+    }
+}
+
+uint64_t ListingHash(const omnisphere::dtos::ListDirectoryPage& input)
+{
+    std::string path = input.Path.value_or("");
+    while (path.size() > 1 && (path.back() == '/' || path.back() == '\\'))
+        path.pop_back();
+
+    std::string text = path;
+    text += '\0';
+    text += TokenMode(input.SortBy.value_or(DirectorySortKey::None));
+    text += input.Descending.value_or(false) ? 'd' : 'a';
+    text += input.IncludeFiles.value_or(false) ? 'f' : '-';
+    text += input.IncludeMetadata.value_or(false) ? 'm' : '-';
+    text += '\0';
+    text += input.NamePrefix.value_or("");
+    text += '\0';
+    text += input.NameGlob.value_or("");
+
+    uint64_t hash = 14695981039346656037ull;    // FNV-1a
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string Base64Url(const std::string& raw)
+{
+    std::string text = omnisphere::codecs::Base64::Encode(reinterpret_cast<const unsigned char*>(raw.data()), raw.size());
+    while (!text.empty() && text.back() == '=')
+        text.pop_back();
+    for (char& c : text)
+        c = c == '+' ? '-' : c == '/' ? '_' : c;
+    return text;
+}
+
+std::string FromBase64Url(std::string text)
+{
+    for (char& c : text)
+    {
+        if (c == '+' || c == '/' || c == '=')
+            throw std::invalid_argument("Malformed continuation token");
+        c = c == '-' ? '+' : c == '_' ? '/' : c;
+    }
+    text.append((4 - text.size() % 4) % 4, '=');
+    try
+    {
+        const std::vector<unsigned char> bytes = omnisphere::codecs::Base64::Decode(text);
+        return std::string(bytes.begin(), bytes.end());
+    }
+    catch (const std::invalid_argument&)
+    {
+        throw std::invalid_argument("Malformed continuation token");
+    }
+}
 
-    // Test write: create and delete a 0B probe file
-    fs::path probeFile = dirPath / ".omni_perm_check.tmp";
+std::string EncodePageToken(DirectorySortKey sortBy, uint64_t listing, const PageCursor& cursor)
+{
+    std::string raw = std::string("v3|") + TokenMode(sortBy) + "|" + std::to_string(listing) + "|";
+    if (sortBy == DirectorySortKey::None)
+        raw += std::to_string(cursor.Position.value_or(0));
+    else
+        raw += std::to_string(cursor.ModifiedAt.value_or(0)) + "|" + cursor.Name.value_or("");
+    return Base64Url(raw);
+}
+
+PageCursor DecodePageToken(const std::string& token, DirectorySortKey sortBy, uint64_t listing)
+{
+    const std::string raw = FromBase64Url(token);
+    if (raw.size() < 5 || raw.compare(0, 3, "v3|") != 0 || raw[4] != '|')
+        throw std::invalid_argument("Malformed continuation token");
+    if (raw[3] != TokenMode(sortBy))
+        throw std::invalid_argument("Continuation token was issued for a different sort order");
+
+    // Splits off the next '|'-terminated field; the name is last and may itself contain '|'
+    size_t pos = 5;
+    auto field = [&]() -> std::string
+    {
+        const size_t bar = raw.find('|', pos);
+        if (bar == std::string::npos)
+            throw std::invalid_argument("Malformed continuation token");
+        std::string value = raw.substr(pos, bar - pos);
+        pos = bar + 1;
+        return value;
+    };
+
+    PageCursor cursor;
     try
     {
+        if (std::stoull(field()) != listing)
+            throw std::invalid_argument("Continuation token was issued for a different listing");
+
+        if (sortBy == DirectorySortKey::None)
+        {
+            cursor.Position = std::stoull(raw.substr(pos));
+        }
+        else
         {
-            std::ofstream ofs(probeFile.string(), std::ios::trunc | std::ios::binary);
-            result.HasWriteAccess = ofs.good();
+            cursor.ModifiedAt = std::stoll(field());
+            cursor.Name       = raw.substr(pos);
         }
-        if (result.HasWriteAccess)
-            fs::remove(probeFile, ec);
     }
-    catch (...)
+    catch (const std::invalid_argument& e)
     {
-        result.HasWriteAccess = false;
+        if (std::string_view(e.what()).rfind("Continuation", 0) == 0)
+            throw;
+        throw std::invalid_argument("Malformed continuation token");
+    }
+    catch (const std::logic_error&)
+    {
+        throw std::invalid_argument("Malformed continuation token");
+    }
+    return cursor;
+}
+
+// Case-insensitive '*' / '?' match with single-star backtracking
+bool GlobMatch(std::string_view pattern, std::string_view name)
+{
+    auto lower = [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); };
+    size_t p = 0, n = 0, starP = std::string_view::npos, starN = 0;
+    while (n < name.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || lower(pattern[p]) == lower(name[n])))
+        {
+            ++p;
+            ++n;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            starP = p++;
+            starN = n;
+        }
+        else if (starP != std::string_view::npos)
+        {
+            p = starP + 1;
+            n = ++starN;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
+
+bool StartsWithNoCase(std::string_view name, std::string_view prefix)
+{
+    if (prefix.size() > name.size())
+        return false;
+    for (size_t i = 0; i < prefix.size(); ++i)
+        if (std::tolower(static_cast<unsigned char>(name[i])) != std::tolower(static_cast<unsigned char>(prefix[i])))
+            return false;
+    return true;
+}
+
+} // namespace
+
+omnisphere::models::DirectoryPage File::ReadDirPage(const omnisphere::dtos::ListDirectoryPage& input) const
+{
+    constexpr size_t defaultPageSize = 200;
+    constexpr size_t maxPageSize     = 5000;
+
+    const size_t pageSize     = std::clamp<size_t>(input.PageSize.value_or(defaultPageSize), 1, maxPageSize);
+    const auto sortBy         = input.SortBy.value_or(DirectorySortKey::None);
+    const bool descending     = input.Descending.value_or(false);
+    const bool includeFiles   = input.IncludeFiles.value_or(false);
+    const bool withMetadata   = input.IncludeMetadata.value_or(false) || sortBy == DirectorySortKey::ModifiedAt;
+    const std::string prefix  = input.NamePrefix.value_or("");
+    const std::string glob    = input.NameGlob.value_or("");
+
+    const uint64_t listing = ListingHash(input);
+    PageCursor cursor;
+    if (input.ContinuationToken && !input.ContinuationToken->empty())
+        cursor = DecodePageToken(*input.ContinuationToken, sortBy, listing);
+
+    std::string requestedPath = input.Path.value_or("");
+    std::string resolvedPath  = ResolvePath(requestedPath);
+    bool isNet = IsNetworkUri(requestedPath) || IsNetworkUri(resolvedPath);
+
+    if (isNet && resolvedPath.empty() && !requestedPath.empty() && requestedPath != "smb://" && requestedPath != "nfs://")
+        resolvedPath = AutoMountNetworkUri(requestedPath, input.Username.value_or(""), input.Password.value_or(""), input.Domain.value_or(""));
+
+    // Entry source: the directory itself, or `gio list` names when nothing is mounted
+    fs::path targetPath;
+    std::optional<DirectoryEnumerator> dir;
+    std::vector<std::string> gioNames;
+    size_t gioIndex = 0;
+    uint64_t gioPosition = 0;
+
+    if (resolvedPath.empty() && isNet)
+    {
+        gioNames = GioList(requestedPath);
+    }
+    else
+    {
+        targetPath = resolvedPath.empty() ? fs::path(GetUserHomeDirectory()) : fs::path(resolvedPath);
+        std::error_code ec;
+        if (!fs::is_directory(targetPath, ec)) targetPath = targetPath.parent_path();
+        dir.emplace(targetPath.string(), withMetadata);
+    }
+
+    const bool gvfsTarget = targetPath.string().find("/gvfs") != std::string::npos;
+
+    auto next = [&](DirectoryEntry& entry) -> bool
+    {
+        if (dir)
+            return dir->Next(entry);
+        if (gioIndex >= gioNames.size())
+            return false;
+        entry = DirectoryEntry{gioNames[gioIndex++], omnisphere::enums::FileType::Directory, std::nullopt, std::nullopt};
+        gioPosition = gioIndex;
+        return true;
+    };
+    auto position = [&]() -> uint64_t { return dir ? dir->Position() : gioPosition; };
+
+    auto accept = [&](const DirectoryEntry& entry) -> bool
+    {
+        if (entry.Name.empty() || entry.Name[0] == '.') return false;
+        if (!KeepEntry(entry.Type, isNet || gvfsTarget, includeFiles)) return false;
+        if (!prefix.empty() && !StartsWithNoCase(entry.Name, prefix)) return false;
+        if (!glob.empty() && !GlobMatch(glob, entry.Name)) return false;
+        return true;
+    };
+
+    omnisphere::models::DirectoryPage page;
+    page.Items.reserve(std::min<size_t>(pageSize, 1024));
+
+    if (sortBy == DirectorySortKey::None)
+    {
+        // Filesystem order: resume at the saved position and stop after one page
+        if (cursor.Position)
+        {
+            if (dir)
+                dir->Seek(*cursor.Position);
+            else
+                gioIndex = std::min<size_t>(static_cast<size_t>(*cursor.Position), gioNames.size());
+        }
+
+        DirectoryEntry entry;
+        uint64_t lastPosition = 0;
+        while (next(entry))
+        {
+            if (!accept(entry)) continue;
+            if (page.Items.size() == pageSize)
+            {
+                page.HasMore = true;
+                break;
+            }
+            page.Items.push_back(MakeItem(entry, targetPath, requestedPath, isNet, gvfsTarget));
+            lastPosition = position();
+        }
+        if (page.HasMore)
+            page.ContinuationToken = EncodePageToken(sortBy, listing, PageCursor{lastPosition, std::nullopt, std::nullopt});
+        return page;
+    }
+
+    // Sorted: one pass keeps the first pageSize + 1 entries after the last key in a bounded
+    // max-heap, so memory follows the page size and the pass costs O(n log pageSize).
+    auto modifiedAt = [](const DirectoryEntry& e) { return e.ModifiedAt.value_or(INT64_MIN); };
+    auto before = [&](int64_t aTime, const std::string& aName, int64_t bTime, const std::string& bName)
+    {
+        if (sortBy == DirectorySortKey::ModifiedAt && aTime != bTime)
+            return descending ? aTime > bTime : aTime < bTime;
+        return descending ? aName > bName : aName < bName;
+    };
+    auto order = [&](const DirectoryEntry& a, const DirectoryEntry& b)
+    {
+        return before(modifiedAt(a), a.Name, modifiedAt(b), b.Name);
+    };
+
+    const size_t keep = pageSize + 1;
+    std::vector<DirectoryEntry> heap;
+    heap.reserve(keep);
+    DirectoryEntry entry;
+    while (next(entry))
+    {
+        if (!accept(entry)) continue;
+        if (cursor.Name && !before(cursor.ModifiedAt.value_or(0), *cursor.Name, modifiedAt(entry), entry.Name))
+            continue;
+        if (heap.size() == keep)
+        {
+            if (!order(entry, heap.front())) continue;
+            std::pop_heap(heap.begin(), heap.end(), order);
+            heap.back() = std::move(entry);
+        }
+        else
+        {
+            heap.push_back(std::move(entry));
+        }
+        std::push_heap(heap.begin(), heap.end(), order);
     }
+    std::sort_heap(heap.begin(), heap.end(), order);
+
+    const size_t end = std::min(heap.size(), pageSize);
+    for (size_t i = 0; i < end; ++i)
+        page.Items.push_back(MakeItem(heap[i], targetPath, requestedPath, isNet, gvfsTarget));
 
+    if (heap.size() > pageSize)
+    {
+        page.HasMore = true;
+        const DirectoryEntry& last = heap[end - 1];
+        page.ContinuationToken = EncodePageToken(sortBy, listing, PageCursor{std::nullopt, modifiedAt(last), last.Name});
+    }
+    return page;
+}
+
+// ---------------------------------------------------------------------------
+// ReadTree
+// ---------------------------------------------------------------------------
+
+omnisphere::models::TreeSummary File::ReadTree(const omnisphere::dtos::ListTree& input,
+                                               const std::function<bool(omnisphere::models::TreeDirectory&&)>& sink) const
+{
+    constexpr int defaultDepth          = 8;
+    constexpr int maxDepth              = 64;
+    constexpr size_t defaultMountSlots  = 4;
+
+    std::string requestedPath = input.Path.value_or("");
+    std::string resolvedPath  = ResolvePath(requestedPath);
+    const bool isNet = IsNetworkUri(requestedPath) || IsNetworkUri(resolvedPath);
+
+    if (isNet && resolvedPath.empty() && !requestedPath.empty() && requestedPath != "smb://" && requestedPath != "nfs://")
+        resolvedPath = AutoMountNetworkUri(requestedPath, input.Username.value_or(""), input.Password.value_or(""), input.Domain.value_or(""));
+
+    if (resolvedPath.empty())
+    {
+        if (isNet)
+            throw std::runtime_error("Network path is not mounted: " + requestedPath);
+        resolvedPath = GetUserHomeDirectory();
+    }
+
+    std::error_code ec;
+    fs::path rootPath(resolvedPath);
+    if (!fs::is_directory(rootPath, ec))
+        rootPath = rootPath.parent_path();
+
+    std::string requestedRoot = isNet ? requestedPath : rootPath.string();
+    while (requestedRoot.size() > 1 && (requestedRoot.back() == '/' || requestedRoot.back() == '\\'))
+        requestedRoot.pop_back();
+
+    const bool includeFiles  = input.IncludeFiles.value_or(false);
+    const bool aggregates    = input.IncludeAggregates.value_or(false);
+    const std::string prefix = input.NamePrefix.value_or("");
+    const std::string glob   = input.NameGlob.value_or("");
+    const size_t mountSlots  = std::max<size_t>(input.MaxConcurrencyPerMount.value_or(defaultMountSlots), 1);
+
+    TreeWalkOptions options;
+    options.MaxDepth     = std::clamp(input.MaxDepth.value_or(defaultDepth), 0, maxDepth);
+    options.WithMetadata = input.IncludeMetadata.value_or(false);
+    options.Aggregates   = aggregates;
+    options.Filter = [&](const DirectoryEntry& entry)
+    {
+        if (!KeepEntry(entry.Type, isNet, includeFiles)) return false;
+        if (!prefix.empty() && !StartsWithNoCase(entry.Name, prefix)) return false;
+        if (!glob.empty() && !GlobMatch(glob, entry.Name)) return false;
+        return true;
+    };
+    // Local disks take whatever the pool gives; one SMB/NFS server gets a few directories at a time
+    options.MountLimit = [&](const std::string& directory) -> size_t
+    {
+        return IsLocalFileSystem(directory) ? 0 : mountSlots;
+    };
+
+    auto toModel = [&](TreeWalkDirectory&& dir)
+    {
+        omnisphere::models::TreeDirectory out;
+        out.RelativePath = std::move(dir.RelativePath);
+        out.Path         = out.RelativePath.empty() ? requestedRoot : requestedRoot + "/" + out.RelativePath;
+        out.Depth        = dir.Depth;
+        out.Readable     = dir.Readable;
+        if (aggregates)
+        {
+            out.FileCount  = dir.FileCount;
+            out.TotalBytes = dir.TotalBytes;
+        }
+
+        const fs::path targetPath(dir.Path);
+        const bool gvfsTarget = dir.Path.find("/gvfs") != std::string::npos;
+        out.Items.reserve(dir.Entries.size());
+        for (const auto& entry : dir.Entries)
+            out.Items.push_back(MakeItem(entry, targetPath, out.Path, isNet, gvfsTarget));
+        return out;
+    };
+
+    TreeWalker walker;
+    const TreeWalkResult result = walker.Walk(rootPath.string(), options,
+        [&](TreeWalkDirectory&& dir) { return sink(toModel(std::move(dir))); });
+
+    omnisphere::models::TreeSummary summary;
+    summary.Directories = result.Directories;
+    summary.Unreadable  = result.Unreadable;
+    summary.Files       = result.Files;
+    summary.Bytes       = result.Bytes;
+    summary.Cancelled   = result.Cancelled;
+    return summary;
+}
+
+// ---------------------------------------------------------------------------
+// TestPermissions
+// ---------------------------------------------------------------------------
+
+omnisphere::models::DirectoryPermissions File::TestPermissions(const omnisphere::dtos::ValidateDirectoryPermissions& input) const
+{
+    omnisphere::models::DirectoryPermissions result;
+    std::string resolved = ResolvePath(input.Path);
+    if (resolved.empty())
+    {
+        result.HasReadAccess  = false;
+        result.HasWriteAccess = false;
+        result.Method         = "none";
+    }
+    else
+    {
+        result = PermissionProbe::Instance().Check(resolved, input.ForceRefresh.value_or(false));
+    }
+    result.Path = input.Path;
     return result;
 }
 
+std::vector<omnisphere::models::DirectoryPermissions> File::TestPermissions(const std::vector<std::string>& paths, bool forceRefresh) const
+{
+    constexpr size_t maxParallel = 16;
+
+    std::vector<omnisphere::models::DirectoryPermissions> results(paths.size());
+    WorkStealingPool::Instance().ForEach(paths.size(), maxParallel, [&](size_t i)
+    {
+        omnisphere::dtos::ValidateDirectoryPermissions input;
+        input.Path         = paths[i];
+        input.ForceRefresh = forceRefresh;
+        try
+        {
+            results[i] = TestPermissions(input);
+        }
+        catch (const std::exception&)
+        {
+            results[i].Path           = paths[i];
+            results[i].HasReadAccess  = false;
+            results[i].HasWriteAccess = false;
+            results[i].Method         = "none";
+        }
+    });
+    return results;
+}
+
 // ---------------------------------------------------------------------------
 // MountShare
 // ---------------------------------------------------------------------------
@@ -534,7 +1132,26 @@ static std::string UrlEncode(const std::string& str)
     return encoded;
 }
 
+MountManager& File::Mounter()
+{
+    static MountManager manager([](const omnisphere::dtos::ConnectNetworkShare& share)
+    {
+        MountOutcome outcome;
+        outcome.Uri = File().MountShareNow(share, outcome.Error);
+        return outcome;
+    });
+    return manager;
+}
+
 std::string File::MountShare(const omnisphere::dtos::ConnectNetworkShare& input, std::string& outError) const
+{
+    // Explicit connects skip the failure backoff but still join a mount already in flight
+    const MountOutcome outcome = Mounter().Mount(input, true).get();
+    outError = outcome.Error;
+    return outcome.Uri;
+}
+
+std::string File::MountShareNow(const omnisphere::dtos::ConnectNetworkShare& input, std::string& outError) const
 {
     std::string protocol = input.Protocol.empty() ? "smb" : ToLower(input.Protocol);
     std::string server   = input.Server;
@@ -618,6 +1235,7 @@ std::string File::MountShare(const omnisphere::dtos::ConnectNetworkShare& input,
         exitStatus = ::pclose(pipe);
     }
 
+    MountTable::Instance().Invalidate();
     std::string resolvedPath = ResolvePath(displayUri);
 
     bool alreadyMounted = (mountOutput.find("already mounted") != std::string::npos ||
@@ -645,6 +1263,7 @@ std::string File::MountShare(const omnisphere::dtos::ConnectNetworkShare& input,
         winCmd += " >nul 2>&1";
         ::system(winCmd.c_str());
     }
+    MountTable::Instance().Invalidate();
     std::string resolvedPath = ResolvePath(displayUri);
 #endif
 
@@ -739,6 +1358,218 @@ std::vector<unsigned char> File::ReadBytes(const std::string& fullPath) const
     return std::vector<unsigned char>((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
 }
 
+#ifdef __linux__
+namespace
+{
+
+// Network and FUSE (gvfs) filesystems, where the kernel cannot see remote changes
+bool IsRemoteFsType(long type)
+{
+    constexpr long fuseMagic = 0x65735546;
+    constexpr long nfsMagic  = 0x6969;
+    constexpr long smbMagic  = 0x517B;
+    constexpr long cifsMagic = static_cast<long>(0xFF534D42);
+    constexpr long smb2Magic = static_cast<long>(0xFE534D42);
+    return type == fuseMagic || type == nfsMagic || type == smbMagic || type == cifsMagic || type == smb2Magic;
+}
+
+} // namespace
+#endif
+
+bool File::IsLocalFileSystem(int fd)
+{
+#ifdef __linux__
+    // Network and FUSE (gvfs) mounts can change or vanish under a mapping and turn a
+    // page fault into SIGBUS, so only block-device filesystems get mmap.
+    struct statfs sfs;
+    if (::fstatfs(fd, &sfs) != 0)
+        return false;
+    return !IsRemoteFsType(static_cast<long>(sfs.f_type));
+#else
+    (void)fd;
+    return true;
+#endif
+}
+
+bool File::IsLocalFileSystem(const std::string& path)
+{
+#ifdef __linux__
+    struct statfs sfs;
+    if (::statfs(path.c_str(), &sfs) != 0)
+        return false;
+    return !IsRemoteFsType(static_cast<long>(sfs.f_type));
+#else
+    return !IsNetworkUri(path);
+#endif
+}
+
+omnisphere::models::FileBuffer File::ReadShared(const std::string& fullPath) const
+{
+    ContentCache& cache = ContentCache::Instance();
+    if (auto cached = cache.Lookup(fullPath))
+    {
+        try
+        {
+            return ReadSharedUncached(*cached, nullptr, true);
+        }
+        catch (const std::exception&)
+        {
+            cache.Invalidate(fullPath);     // Blob evicted or removed under us: go to the source
+        }
+    }
+
+    SourceStamp stamp;
+    omnisphere::models::FileBuffer result = ReadSharedUncached(fullPath, cache.Enabled() ? &stamp : nullptr, false);
+    if (cache.Enabled() && cache.Caches(fullPath, stamp.Local))
+        cache.Store(fullPath, stamp.MtimeNs, result.begin(), result.Size);
+    return result;
+}
+
+omnisphere::models::FileBuffer File::ReadSharedImmutable(const std::string& fullPath) const
+{
+    return ReadSharedUncached(fullPath, nullptr, true);
+}
+
+omnisphere::models::FileBuffer File::ReadSharedUncached(const std::string& fullPath, SourceStamp* stamp, bool immutable) const
+{
+    omnisphere::models::FileBuffer result;
+#ifndef _WIN32
+    const int fd = ::open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open file for reading: " + fullPath);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat file: " + fullPath);
+    }
+    size_t size          = static_cast<size_t>(st.st_size);
+    const bool mappable  = size >= mmapThreshold;
+    const bool local     = (mappable || stamp) && IsLocalFileSystem(fd);
+    if (stamp)
+        stamp->Local = local;
+
+    // A page past a shrunk end of file is SIGBUS, so files other writers may truncate are
+    // mapped only under a lease that copies them out of the file before it lets a writer in
+    if (mappable && local && !immutable)
+    {
+        if (auto data = LeasedMappings::Instance().Map(fd, st))
+        {
+            if (stamp)
+                stamp->MtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            result.Data   = std::move(data);
+            result.Size   = static_cast<size_t>(st.st_size);
+            result.Mapped = true;
+            return result;
+        }
+        // Not leasable: read into the heap
+    }
+    if (stamp)
+        stamp->MtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    size = static_cast<size_t>(st.st_size);
+
+    if (mappable && local && immutable)
+    {
+        void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            ::close(fd);
+            ::madvise(addr, size, MADV_SEQUENTIAL);
+            result.Data = std::shared_ptr<const unsigned char>(static_cast<const unsigned char*>(addr),
+                [size](const unsigned char* p) { ::munmap(const_cast<unsigned char*>(p), size); });
+            result.Size   = size;
+            result.Mapped = true;
+            return result;
+        }
+        // Fall through to a plain read if the mapping is refused
+    }
+    else if (mappable)
+    {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    // A file that shrinks meanwhile just yields fewer bytes
+    auto bytes = std::make_shared<std::vector<unsigned char>>(size);
+    size_t done = 0;
+    while (done < size)
+    {
+        const ssize_t n = ::pread(fd, bytes->data() + done, size - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    bytes->resize(done);
+
+    result.Size = bytes->size();
+    result.Data = std::shared_ptr<const unsigned char>(bytes, bytes->data());
+#else
+    auto bytes  = std::make_shared<std::vector<unsigned char>>(ReadBytes(fullPath));
+    result.Size = bytes->size();
+    result.Data = std::shared_ptr<const unsigned char>(bytes, bytes->data());
+#endif
+    return result;
+}
+
+uint64_t File::ReadChunks(const std::string& fullPath, uint64_t offset, std::optional<uint64_t> length, size_t chunkSize,
+                          const std::function<bool(const omnisphere::models::FileChunk&)>& sink) const
+{
+    if (chunkSize == 0)
+        throw std::invalid_argument("Chunk size must be greater than zero");
+
+    std::ifstream ifs(fullPath, std::ios::binary);
+    if (!ifs.is_open())
+        throw std::runtime_error("Cannot open file for reading: " + fullPath);
+
+    std::error_code ec;
+    const uint64_t fileSize = fs::file_size(fullPath, ec);
+    if (ec)
+        throw std::runtime_error("Cannot stat file: " + fullPath + " (" + ec.message() + ")");
+
+    if (offset > fileSize)
+        throw std::out_of_range("Offset is past the end of the file");
+
+    uint64_t remaining = std::min<uint64_t>(length.value_or(fileSize - offset), fileSize - offset);
+    if (offset > 0)
+        ifs.seekg(static_cast<std::streamoff>(offset));
+
+    if (remaining == 0)
+    {
+        // Empty file or range: still tell the sink it has seen everything
+        omnisphere::models::FileChunk chunk{offset, 0, fileSize, true, {}};
+        sink(chunk);
+        return fileSize;
+    }
+
+    std::vector<unsigned char> buffer(static_cast<size_t>(std::min<uint64_t>(chunkSize, remaining)));
+    while (remaining > 0)
+    {
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(buffer.size(), remaining));
+        ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(want));
+        const size_t got = static_cast<size_t>(ifs.gcount());
+        if (got == 0)
+            break;
+
+        remaining -= got;
+
+        omnisphere::models::FileChunk chunk;
+        chunk.Offset   = offset;
+        chunk.Length   = got;
+        chunk.FileSize = fileSize;
+        chunk.IsLast   = remaining == 0 || got < want;
+        chunk.Data     = std::string_view(reinterpret_cast<const char*>(buffer.data()), got);
+        offset += got;
+
+        if (!sink(chunk) || chunk.IsLast)
+            break;
+    }
+
+    return fileSize;
+}
+
 void File::WriteBytes(const std::string& fullPath, const std::vector<unsigned char>& data) const
 {
     std::ofstream ofs(fullPath, std::ios::binary | std::ios::trunc);
@@ -1,13 +1,25 @@
 #pragma once
 #include "File/DTOs/ListDirectory.hpp"
+#include "File/DTOs/ListDirectoryPage.hpp"
+#include "File/DTOs/ListTree.hpp"
 #include "File/DTOs/ValidateDirectoryPermissions.hpp"
 #include "File/DTOs/ConnectNetworkShare.hpp"
 #include "File/DTOs/CreateDirectory.hpp"
 #include "File/DTOs/ReadFile.hpp"
 #include "File/DTOs/SaveFile.hpp"
 #include "File/Models/DirectoryItem.hpp"
+#include "File/Models/DirectoryPage.hpp"
+#include "File/Models/FileBuffer.hpp"
+#include "File/Models/FileChunk.hpp"
 #include "File/Models/FileContent.hpp"
+#include "File/Models/TreeDirectory.hpp"
+#include "File/Models/TreeSummary.hpp"
 #include "File/Models/DirectoryPermissions.hpp"
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include "File/Repositories/MountManager.hpp"
+#include <filesystem>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <optional>
@@ -26,12 +38,38 @@ namespace omnisphere::repositories
         // List directory entries at the given path (resolves SMB/NFS URIs via GVFS/gio)
         std::vector<omnisphere::models::DirectoryItem> ReadDir(const omnisphere::dtos::ListDirectory& input) const;
 
-        // Validate read and write permissions on a directory by creating/deleting a 0B probe file
+        // One page of a directory listing with optional name prefix/glob filters and files. Unsorted
+        // pages are streamed, so memory follows the page size rather than the directory size. Sorted
+        // pages keep only the next page worth of entries after the token's sort key.
+        omnisphere::models::DirectoryPage ReadDirPage(const omnisphere::dtos::ListDirectoryPage& input) const;
+
+        // Walk the tree under Path in parallel (see TreeWalker), handing each directory to the sink as
+        // soon as it is listed. The sink is never called concurrently and returns false to stop.
+        omnisphere::models::TreeSummary ReadTree(const omnisphere::dtos::ListTree& input,
+                                                 const std::function<bool(omnisphere::models::TreeDirectory&&)>& sink) const;
+
+        // Validate read and write permissions on a directory through the PermissionProbe cache:
+        // faccessat on local filesystems, a uniquely named probe file on network mounts
         omnisphere::models::DirectoryPermissions TestPermissions(const omnisphere::dtos::ValidateDirectoryPermissions& input) const;
 
-        // Mount SMB/NFS network share via gio mount on Linux, net use on Windows
+        // The same for many directories, checked in parallel; results in the order of paths
+        std::vector<omnisphere::models::DirectoryPermissions> TestPermissions(const std::vector<std::string>& paths, bool forceRefresh) const;
+
+        // Mount SMB/NFS network share via gio mount on Linux, net use on Windows. Goes through the
+        // MountManager, so concurrent calls for one share run a single mount and share its outcome.
         std::string MountShare(const omnisphere::dtos::ConnectNetworkShare& input, std::string& outError) const;
 
+        // Resolve a path, mounting its share first when it is a network URI that is not mounted
+        std::string ResolveOrMount(const std::string& path) const;
+
+        // Unmount and mount again the share of a network URI whose mount stopped answering
+        std::string Remount(const std::string& uri) const;
+
+        // Submit `task` to the shared pool once `path` is reachable: at once for local or mounted
+        // paths, otherwise after the MountManager finishes (or fails) mounting its share.
+        void WhenReachable(const std::string& path, const std::string& username, const std::string& password,
+                           const std::string& domain, std::function<void()> task) const;
+
         // Get all active SMB/NFS network shares currently mounted on the OS
         std::vector<std::string> GetMountedShares() const;
 
@@ -41,11 +79,38 @@ namespace omnisphere::repositories
         // Read a file and return its bytes
         std::vector<unsigned char> ReadBytes(const std::string& fullPath) const;
 
+        // Read a file into a shared read-only buffer. Local files of at least mmapThreshold bytes
+        // are mapped under a read lease (see LeasedMappings), so a writer truncating them cannot
+        // turn access to the mapping into SIGBUS; files that cannot be leased are read into the
+        // heap. Cached copies of files on network mounts are immutable and mapped like
+        // ReadSharedImmutable; the ContentCache serves those when it is enabled.
+        omnisphere::models::FileBuffer ReadShared(const std::string& fullPath) const;
+
+        // ReadShared for files that are only ever replaced by rename, never truncated or rewritten
+        // in place (cache blobs, index files). Local ones of at least mmapThreshold bytes are mapped
+        // with MADV_SEQUENTIAL instead of copied.
+        omnisphere::models::FileBuffer ReadSharedImmutable(const std::string& fullPath) const;
+
+        // Below this size a read() into the heap is cheaper than setting up a mapping
+        static constexpr size_t mmapThreshold = 256 * 1024;
+
+        // Stream [offset, offset + length) of a file through a reused buffer of chunkSize bytes.
+        // The sink returns false to stop early. Returns the total file size.
+        uint64_t ReadChunks(const std::string& fullPath, uint64_t offset, std::optional<uint64_t> length, size_t chunkSize,
+                            const std::function<bool(const omnisphere::models::FileChunk&)>& sink) const;
+
+        // False for NFS, SMB/CIFS and FUSE (GVFS) mounts
+        static bool IsLocalFileSystem(const std::string& path);
+
         // Write bytes to a file (overwrites)
         void WriteBytes(const std::string& fullPath, const std::vector<unsigned char>& data) const;
 
     private:
         // Internal helpers
+        static MountManager& Mounter();
+        std::string MountShareNow(const omnisphere::dtos::ConnectNetworkShare& input, std::string& outError) const;
+        static std::optional<omnisphere::dtos::ConnectNetworkShare> ShareFromUri(const std::string& uri, const std::string& inputUser,
+                                                                                 const std::string& inputPass, const std::string& inputDom);
         std::string AutoMountNetworkUri(const std::string& uri, const std::string& inputUser = "", const std::string& inputPass = "", const std::string& inputDom = "") const;
         static std::string GetUserHomeDirectory();
         static std::string ToLower(const std::string& s);
@@ -53,5 +118,18 @@ namespace omnisphere::repositories
         static std::vector<std::string> GioList(const std::string& uri);
         static std::string GetNetworkParentPath(const std::string& path);
         static bool IsNetworkUri(const std::string& path);
+        static bool IsLocalFileSystem(int fd);
+        std::vector<omnisphere::models::DirectoryItem> ReadDirUncached(const omnisphere::dtos::ListDirectory& input) const;
+        static bool KeepEntry(omnisphere::enums::FileType type, bool network, bool includeFiles);
+        static omnisphere::models::DirectoryItem MakeItem(const DirectoryEntry& entry, const std::filesystem::path& targetPath,
+                                                          const std::string& requestedPath, bool isNet, bool gvfsTarget);
+        static std::string ResolvePathUncached(const std::string& rawPath);
+
+        struct SourceStamp
+        {
+            bool Local = true;
+            int64_t MtimeNs = 0;
+        };
+        omnisphere::models::FileBuffer ReadSharedUncached(const std::string& fullPath, SourceStamp* stamp, bool immutable) const;
     };
 } // namespace omnisphere::repositories
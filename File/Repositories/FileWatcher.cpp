@@ -0,0 +1,831 @@
+#include "File/Repositories/FileWatcher.hpp"
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include "File/Repositories/File.hpp"
+#include "File/Repositories/WorkStealingPool.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+#ifdef __linux__
+// IN_CLOSE_WRITE rather than IN_MODIFY: one event per written file instead of one per write
+constexpr uint32_t watchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB |
+                               IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+#endif
+
+constexpr size_t maxEarly = 65536;           // Events held back for watches being set up
+
+thread_local uint64_t deliveringId = 0;     // Subscription whose callback runs on this thread
+
+std::string Join(const std::string& relative, const std::string& name)
+{
+    return relative.empty() ? name : relative + "/" + name;
+}
+
+std::string FullPath(const std::string& root, const std::string& relative)
+{
+    return relative.empty() ? root : (fs::path(root) / relative).string();
+}
+
+// Directory mtime in nanoseconds; -1 when it cannot be read
+int64_t DirMtimeNs(const std::string& path)
+{
+#ifdef __linux__
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+        return -1;
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    std::error_code ec;
+    const auto time = fs::last_write_time(path, ec);
+    return ec ? -1 : static_cast<int64_t>(time.time_since_epoch().count());
+#endif
+}
+
+} // namespace
+
+// Watches added for a directory and, when recursive, everything below it. Built without
+// the lock: inotify_add_watch needs none and returns the existing wd for a directory that
+// is already watched. Paths in it are relative to the directory it was started from.
+struct FileWatcher::WatchedTree
+{
+    struct Dir
+    {
+        int Wd;
+        std::string Path;
+        std::string Relative;
+    };
+
+    std::vector<Dir> Dirs;
+    std::vector<std::pair<std::string, bool>> Entries;  // Everything below the top, with IsDirectory; when listed
+    std::vector<std::string> Failed;                    // Directories inotify refused
+    std::unordered_set<int> Seen;                       // Same directory reached again through a bind mount or the like
+
+    // list: also collect Entries and carry on past a refused directory (reporting);
+    // otherwise stop at the first one (setting up, the caller falls back to polling)
+    void Add(int fd, const std::string& path, const std::string& relative, bool recursive, bool list)
+    {
+#ifdef __linux__
+        const int wd = ::inotify_add_watch(fd, path.c_str(), watchMask);
+        if (wd < 0)
+        {
+            Failed.push_back(relative);
+            return;
+        }
+        if (!Seen.insert(wd).second)
+            return;
+        Dirs.push_back({wd, path, relative});
+
+        if (!recursive && !list)
+            return;
+        DirectoryEnumerator entries(path);
+        DirectoryEntry entry;
+        while (entries.Next(entry))
+        {
+            const bool isDir = entry.Type == omnisphere::enums::FileType::Directory;
+            const std::string childRelative = Join(relative, entry.Name);
+            if (list)
+                Entries.emplace_back(childRelative, isDir);
+            if (isDir && recursive)
+            {
+                Add(fd, (fs::path(path) / entry.Name).string(), childRelative, recursive, list);
+                if (!list && !Failed.empty())
+                    return;
+            }
+        }
+#else
+        (void)fd;
+        (void)path;
+        (void)recursive;
+        (void)list;
+        Failed.push_back(relative);
+#endif
+    }
+};
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+    inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd    = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (inotifyFd >= 0 && stopFd >= 0)
+        reader = std::thread([this] { Read(); });
+#endif
+    dispatcher = std::thread([this] { Dispatch(); });
+    poller     = std::thread([this] { PollLoop(); });
+}
+
+FileWatcher::~FileWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    dispatchCv.notify_all();
+    pollCv.notify_all();
+    dispatcher.join();
+    poller.join();
+
+#ifdef __linux__
+    if (stopFd >= 0)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(stopFd, &one, sizeof(one));
+    }
+    if (reader.joinable())
+        reader.join();
+    if (stopFd >= 0)
+        ::close(stopFd);
+    if (inotifyFd >= 0)
+        ::close(inotifyFd);
+#endif
+}
+
+FileWatcher& FileWatcher::Instance()
+{
+    static FileWatcher watcher;
+    return watcher;
+}
+
+// ---------------------------------------------------------------------------
+// Subscriptions
+// ---------------------------------------------------------------------------
+
+uint64_t FileWatcher::Watch(const std::string& directory, const FileWatchOptions& options, Callback callback)
+{
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec))
+        throw std::runtime_error("Not a directory: " + directory);
+
+    auto sub = std::make_shared<Subscription>();
+    sub->Root     = directory;
+    sub->Options  = options;
+    sub->OnChange = std::move(callback);
+    sub->Polling  = options.ForcePolling || inotifyFd < 0 || !File::IsLocalFileSystem(directory);
+    if (sub->Polling && !options.PollFallback && !options.ForcePolling)
+        throw std::runtime_error("Directory cannot be watched with inotify: " + directory);
+
+    if (!sub->Polling)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sub->Id = nextId++;
+            ++settingUp;
+        }
+        // One watch per directory of a large tree takes a while; the reader holds back the
+        // events of watches added here until they are merged
+        WatchedTree tree;
+        try
+        {
+            tree.Add(inotifyFd, directory, "", options.Recursive, false);
+        }
+        catch (...)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            MergeLocked(*sub, tree, "", false);
+            FinishSetupLocked(lock, *sub, false);
+            ReleaseWatchesLocked(*sub);
+            throw;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (MergeLocked(*sub, tree, "", false))
+        {
+            subscriptions.emplace(sub->Id, sub);
+            FinishSetupLocked(lock, *sub, true);
+            return sub->Id;
+        }
+        // Out of inotify watches (fs.inotify.max_user_watches): poll instead
+        FinishSetupLocked(lock, *sub, false);
+        ReleaseWatchesLocked(*sub);
+        if (!options.PollFallback)
+            throw std::runtime_error("Out of inotify watches for " + directory);
+        sub->Queue.clear();
+        sub->Rescan  = false;
+        sub->Polling = true;
+    }
+
+    // The first listing is the baseline the poller compares against
+    Scan(*sub, "", nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sub->Id == 0)
+        sub->Id = nextId++;
+    sub->NextPoll = Clock::now() + options.PollInterval;
+    subscriptions.emplace(sub->Id, sub);
+    pollCv.notify_all();
+    return sub->Id;
+}
+
+void FileWatcher::Unwatch(uint64_t id)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = subscriptions.find(id);
+    if (it == subscriptions.end())
+        return;
+
+    std::shared_ptr<Subscription> sub = it->second;
+    subscriptions.erase(it);
+    sub->Removed = true;
+    ReleaseWatchesLocked(*sub);
+
+    if (deliveringId != id)
+        deliveredCv.wait(lock, [&] { return !sub->Delivering; });
+}
+
+bool FileWatcher::MergeLocked(Subscription& sub, const WatchedTree& tree, const std::string& relative, bool report)
+{
+    for (const auto& added : tree.Dirs)
+    {
+        const std::string dirRelative = added.Relative.empty() ? relative : Join(relative, added.Relative);
+        WatchedDir& dir = dirs[added.Wd];
+        dir.Path = added.Path;
+        auto subscriber = std::find_if(dir.Subscribers.begin(), dir.Subscribers.end(),
+                                       [&](const auto& s) { return s.first == sub.Id; });
+        if (subscriber != dir.Subscribers.end())
+        {
+            subscriber->second = dirRelative;
+            continue;
+        }
+        dir.Subscribers.emplace_back(sub.Id, dirRelative);
+        sub.Wds.push_back(added.Wd);
+    }
+
+    if (report)
+    {
+        // Entries that appeared before the watch was in place are reported as created; a
+        // part of the tree inotify refused goes unwatched, so the subscriber has to rescan
+        for (const auto& [entryRelative, isDir] : tree.Entries)
+            AddLocked(sub, Join(relative, entryRelative), Kind::Created, isDir);
+        if (!tree.Failed.empty())
+            AddLocked(sub, relative, Kind::Rescan, true);
+    }
+    return tree.Failed.empty();
+}
+
+void FileWatcher::ReleaseWatchesLocked(Subscription& sub)
+{
+#ifdef __linux__
+    for (int wd : sub.Wds)
+    {
+        auto it = dirs.find(wd);
+        if (it == dirs.end())
+            continue;
+        auto& subscribers = it->second.Subscribers;
+        subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                         [&](const auto& s) { return s.first == sub.Id; }),
+                          subscribers.end());
+        if (subscribers.empty())
+        {
+            ::inotify_rm_watch(inotifyFd, wd);
+            dirs.erase(it);
+        }
+    }
+#endif
+    sub.Wds.clear();
+}
+
+void FileWatcher::ReleaseSubtreeLocked(Subscription& sub, const std::string& relative)
+{
+#ifdef __linux__
+    const std::string below = relative + "/";
+    for (auto wd = sub.Wds.begin(); wd != sub.Wds.end();)
+    {
+        auto it = dirs.find(*wd);
+        if (it == dirs.end())
+        {
+            ++wd;
+            continue;
+        }
+        auto& subscribers = it->second.Subscribers;
+        auto subscriber = std::find_if(subscribers.begin(), subscribers.end(), [&](const auto& s) { return s.first == sub.Id; });
+        if (subscriber == subscribers.end() ||
+            (subscriber->second != relative && subscriber->second.compare(0, below.size(), below) != 0))
+        {
+            ++wd;
+            continue;
+        }
+        subscribers.erase(subscriber);
+        if (subscribers.empty())
+        {
+            ::inotify_rm_watch(inotifyFd, *wd);
+            dirs.erase(it);
+        }
+        wd = sub.Wds.erase(wd);
+    }
+#else
+    (void)sub;
+    (void)relative;
+#endif
+}
+
+void FileWatcher::FinishSetupLocked(std::unique_lock<std::mutex>& lock, Subscription& sub, bool replay)
+{
+    // Events that arrived for sub's watches while it was being set up, in the order read
+    auto mine = std::stable_partition(early.begin(), early.end(), [&](const RawEvent& event)
+    {
+        auto dir = dirs.find(event.Wd);
+        return dir == dirs.end() || std::none_of(dir->second.Subscribers.begin(), dir->second.Subscribers.end(),
+                                                 [&](const auto& s) { return s.first == sub.Id; });
+    });
+    std::vector<RawEvent> held(std::make_move_iterator(mine), std::make_move_iterator(early.end()));
+    early.erase(mine, early.end());
+    const bool overflowed = earlyOverflow;
+    if (--settingUp == 0)
+    {
+        early.clear();  // For watches nobody took
+        earlyOverflow = false;
+    }
+    if (!replay)
+        return;
+
+    if (overflowed)
+        AddLocked(sub, "", Kind::Rescan, true);
+    for (const auto& event : held)
+        HandleLocked(lock, event);
+}
+
+// ---------------------------------------------------------------------------
+// Coalescing and delivery
+// ---------------------------------------------------------------------------
+
+void FileWatcher::AddLocked(Subscription& sub, const std::string& relative, Kind change, bool isDirectory)
+{
+    if (sub.Removed || sub.Rescan)
+        return;     // A rescan is coming anyway
+
+    const auto now = Clock::now();
+    if (sub.Queue.empty())
+        sub.FirstAt = now;
+    sub.LastAt = now;
+
+    if (change == Kind::Rescan)
+    {
+        sub.Queue.clear();
+        sub.Rescan = true;
+        dispatchCv.notify_one();
+        return;
+    }
+
+    auto it = sub.Queue.find(relative);
+    if (it == sub.Queue.end())
+    {
+        if (sub.Queue.size() >= sub.Options.MaxQueued)
+        {
+            sub.Queue.clear();
+            sub.Rescan = true;
+        }
+        else
+        {
+            sub.Queue.emplace(relative, Pending{change, isDirectory, sub.NextSeq++});
+        }
+        dispatchCv.notify_one();
+        return;
+    }
+
+    Pending& pending = it->second;
+    pending.IsDirectory = isDirectory;
+    if (pending.Change == Kind::Created && change == Kind::Deleted)
+        sub.Queue.erase(it);                    // Came and went between two deliveries
+    else if (pending.Change == Kind::Created)
+        ;                                       // Written after being created: still new to the subscriber
+    else if (pending.Change == Kind::Deleted && change == Kind::Created)
+        pending.Change = Kind::Modified;        // Replaced
+    else
+        pending.Change = change == Kind::Deleted ? Kind::Deleted : Kind::Modified;
+    dispatchCv.notify_one();
+}
+
+void FileWatcher::DeliverLocked(const std::shared_ptr<Subscription>& sub)
+{
+    std::vector<omnisphere::models::FileChangeEvent> batch;
+    if (sub->Rescan)
+    {
+        omnisphere::models::FileChangeEvent event;
+        event.Kind        = Kind::Rescan;
+        event.Path        = sub->Root;
+        event.IsDirectory = true;
+        batch.push_back(std::move(event));
+    }
+    else
+    {
+        std::vector<std::pair<const std::string*, const Pending*>> ordered;
+        ordered.reserve(sub->Queue.size());
+        for (const auto& [relative, pending] : sub->Queue)
+            ordered.emplace_back(&relative, &pending);
+        std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.second->Seq < b.second->Seq; });
+
+        batch.reserve(ordered.size());
+        for (const auto& [relative, pending] : ordered)
+        {
+            omnisphere::models::FileChangeEvent event;
+            event.Kind         = pending->Change;
+            event.RelativePath = *relative;
+            event.Path         = FullPath(sub->Root, *relative);
+            event.IsDirectory  = pending->IsDirectory;
+            batch.push_back(std::move(event));
+        }
+    }
+    sub->Queue.clear();
+    sub->Rescan     = false;
+    sub->Delivering = true;
+
+    WorkStealingPool::Instance().Submit([this, sub, batch = std::move(batch)]
+    {
+        deliveringId = sub->Id;
+        try
+        {
+            sub->OnChange(batch);
+        }
+        catch (...)
+        {
+            // A throwing subscriber must not take the pool thread down
+        }
+        deliveringId = 0;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        sub->Delivering = false;
+        deliveredCv.notify_all();
+        dispatchCv.notify_one();    // Changes may have piled up meanwhile
+    });
+}
+
+void FileWatcher::Dispatch()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        const auto now = Clock::now();
+        auto wake = now + std::chrono::seconds(60);
+        for (const auto& [id, sub] : subscriptions)
+        {
+            if (sub->Delivering || (!sub->Rescan && sub->Queue.empty()))
+                continue;
+            const auto due = std::min(sub->LastAt + sub->Options.Debounce, sub->FirstAt + sub->Options.MaxDelay);
+            if (now >= due)
+                DeliverLocked(sub);
+            else
+                wake = std::min(wake, due);
+        }
+        dispatchCv.wait_until(lock, wake);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// inotify
+// ---------------------------------------------------------------------------
+
+void FileWatcher::Read()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[16384];
+    for (;;)
+    {
+        pollfd fds[2] = {{stopFd, POLLIN, 0}, {inotifyFd, POLLIN, 0}};
+        const int rc = ::poll(fds, 2, -1);
+        if (rc < 0 && errno != EINTR)
+            return;
+        if (fds[0].revents)
+            return;
+        if (!(fds[1].revents & POLLIN))
+            continue;
+
+        ssize_t n;
+        while ((n = ::read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (ssize_t off = 0; off < n;)
+            {
+                const auto* ev = reinterpret_cast<const inotify_event*>(buffer + off);
+                off += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+
+                if (ev->mask & IN_Q_OVERFLOW)
+                {
+                    for (auto& [id, sub] : subscriptions)
+                    {
+                        if (!sub->Polling)
+                            AddLocked(*sub, "", Kind::Rescan, true);
+                    }
+                    if (settingUp > 0)
+                        earlyOverflow = true;
+                    continue;
+                }
+
+                RawEvent event{ev->wd, ev->mask, ev->len ? std::string(ev->name) : std::string()};
+                if (settingUp > 0 && dirs.find(ev->wd) == dirs.end())
+                {
+                    // Possibly for a watch a Watch call has added but not merged yet
+                    if (early.size() < maxEarly)
+                        early.push_back(std::move(event));
+                    else
+                        earlyOverflow = true;
+                    continue;
+                }
+                HandleLocked(lock, event);
+            }
+        }
+    }
+#endif
+}
+
+void FileWatcher::HandleLocked(std::unique_lock<std::mutex>& lock, const RawEvent& event)
+{
+#ifdef __linux__
+    auto dir = dirs.find(event.Wd);
+    if (dir == dirs.end())
+        return;
+
+    if (event.Mask & IN_IGNORED)
+    {
+        // Watch gone with its directory; the parent already reported the deletion
+        for (const auto& [id, relative] : dir->second.Subscribers)
+        {
+            auto sub = subscriptions.find(id);
+            if (sub != subscriptions.end())
+                sub->second->Wds.erase(std::remove(sub->second->Wds.begin(), sub->second->Wds.end(), event.Wd),
+                                       sub->second->Wds.end());
+        }
+        dirs.erase(dir);
+        return;
+    }
+
+    const bool isDir = (event.Mask & IN_ISDIR) != 0;
+    const std::string& name = event.Name;
+    const std::string path = dir->second.Path;
+    // Copied: releasing a moved subtree may erase from dirs
+    const auto subscribers = dir->second.Subscribers;
+    std::vector<std::pair<uint64_t, std::string>> grown;    // Recursive subscribers a directory appeared under
+    for (const auto& [id, relative] : subscribers)
+    {
+        auto found = subscriptions.find(id);
+        if (found == subscriptions.end())
+            continue;
+        Subscription& sub = *found->second;
+
+        if (event.Mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+        {
+            if (relative.empty())
+                AddLocked(sub, "", Kind::Deleted, true);
+            continue;
+        }
+        if (name.empty())
+            continue;
+
+        const std::string childRelative = Join(relative, name);
+        if (event.Mask & (IN_CREATE | IN_MOVED_TO))
+        {
+            AddLocked(sub, childRelative, Kind::Created, isDir);
+            if (isDir && sub.Options.Recursive)
+                grown.emplace_back(id, childRelative);
+        }
+        else if (event.Mask & (IN_DELETE | IN_MOVED_FROM))
+        {
+            AddLocked(sub, childRelative, Kind::Deleted, isDir);
+            // A moved directory keeps its wds; they are added again under the new
+            // name when (and if) it shows up inside the tree
+            if ((event.Mask & IN_MOVED_FROM) && isDir && sub.Options.Recursive)
+                ReleaseSubtreeLocked(sub, childRelative);
+        }
+        else if (!isDir)
+        {
+            AddLocked(sub, childRelative, Kind::Modified, false);
+        }
+    }
+    if (grown.empty())
+        return;
+
+    // A new or moved-in subtree can be large; list it without the lock. Events for the
+    // new watches are only handled by the reader thread, after the merge (or held back
+    // like those of a Watch call in progress).
+    lock.unlock();
+    WatchedTree tree;
+    tree.Add(inotifyFd, (fs::path(path) / name).string(), "", true, true);
+    lock.lock();
+
+    bool merged = false;
+    for (const auto& [id, childRelative] : grown)
+    {
+        auto found = subscriptions.find(id);
+        if (found == subscriptions.end())
+            continue;   // Unwatched meanwhile
+        MergeLocked(*found->second, tree, childRelative, true);
+        merged = true;
+    }
+    if (!merged)
+    {
+        for (const auto& added : tree.Dirs)
+        {
+            if (dirs.find(added.Wd) == dirs.end())
+                ::inotify_rm_watch(inotifyFd, added.Wd);
+        }
+    }
+#else
+    (void)lock;
+    (void)event;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Polling
+// ---------------------------------------------------------------------------
+
+void FileWatcher::Scan(Subscription& sub, const std::string& relative, std::vector<std::pair<std::string, Snapshot>>* created)
+{
+    const std::string path = FullPath(sub.Root, relative);
+    Snapshot self;
+    self.IsDirectory = true;
+    self.DirMtimeNs  = DirMtimeNs(path);
+    sub.Known[relative] = self;
+
+    DirectoryEnumerator entries(path, true);
+    DirectoryEntry entry;
+    while (entries.Next(entry))
+    {
+        const std::string childRelative = Join(relative, entry.Name);
+        Snapshot child;
+        child.IsDirectory = entry.Type == omnisphere::enums::FileType::Directory;
+        child.ModifiedAt  = entry.ModifiedAt.value_or(0);
+        child.Size        = entry.Size.value_or(0);
+
+        if (created)
+            created->emplace_back(childRelative, child);
+        if (child.IsDirectory && sub.Options.Recursive)
+            Scan(sub, childRelative, created);
+        else
+            sub.Known[childRelative] = child;
+    }
+}
+
+void FileWatcher::Poll(Subscription& sub, std::vector<omnisphere::models::FileChangeEvent>& changes)
+{
+    auto report = [&](const std::string& relative, Kind change, bool isDirectory)
+    {
+        omnisphere::models::FileChangeEvent event;
+        event.Kind         = change;
+        event.RelativePath = relative;
+        event.Path         = FullPath(sub.Root, relative);
+        event.IsDirectory  = isDirectory;
+        changes.push_back(std::move(event));
+    };
+
+    if (DirMtimeNs(sub.Root) < 0)
+    {
+        sub.Unreachable = true;     // Share gone for now; catch up with a full pass when it is back
+        return;
+    }
+    const bool full = sub.Unreachable || ++sub.Polls % std::max(sub.Options.FullPollEvery, 1u) == 0;
+    sub.Unreachable = false;
+
+    // Without Recursive only the root is listed; its subdirectories are in Known as entries
+    std::vector<std::string> directories{""};
+    for (const auto& [relative, known] : sub.Known)
+    {
+        if (sub.Options.Recursive && known.IsDirectory && !relative.empty())
+            directories.push_back(relative);
+    }
+
+    for (const auto& relative : directories)
+    {
+        auto self = sub.Known.find(relative);
+        if (self == sub.Known.end())
+            continue;   // Removed along with a parent earlier in this pass
+
+        const std::string path = FullPath(sub.Root, relative);
+        const int64_t mtime = DirMtimeNs(path);
+        if (!full && mtime == self->second.DirMtimeNs)
+            continue;   // Nothing was added, removed or renamed in it
+        self->second.DirMtimeNs = mtime;
+
+        // Current children of the directory in Known: keys "relative/<name>" without a further '/'
+        const std::string prefix = relative.empty() ? "" : relative + "/";
+        std::map<std::string, bool> unseen;
+        for (auto it = sub.Known.lower_bound(prefix); it != sub.Known.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+        {
+            if (!it->first.empty() && it->first.find('/', prefix.size()) == std::string::npos)
+                unseen.emplace(it->first, it->second.IsDirectory);
+        }
+
+        DirectoryEnumerator entries(path, true);
+        if (!entries.IsOpen())
+            continue;
+        DirectoryEntry entry;
+        while (entries.Next(entry))
+        {
+            const std::string childRelative = Join(relative, entry.Name);
+            const bool isDir = entry.Type == omnisphere::enums::FileType::Directory;
+            unseen.erase(childRelative);
+
+            auto known = sub.Known.find(childRelative);
+            if (known == sub.Known.end())
+            {
+                report(childRelative, Kind::Created, isDir);
+                if (isDir && sub.Options.Recursive)
+                {
+                    std::vector<std::pair<std::string, Snapshot>> inside;
+                    Scan(sub, childRelative, &inside);
+                    for (const auto& [insideRelative, snapshot] : inside)
+                        report(insideRelative, Kind::Created, snapshot.IsDirectory);
+                }
+                else
+                {
+                    Snapshot snapshot;
+                    snapshot.IsDirectory = isDir;
+                    snapshot.ModifiedAt  = entry.ModifiedAt.value_or(0);
+                    snapshot.Size        = entry.Size.value_or(0);
+                    sub.Known[childRelative] = snapshot;
+                }
+                continue;
+            }
+
+            if (!isDir && !known->second.IsDirectory &&
+                (known->second.ModifiedAt != entry.ModifiedAt.value_or(0) || known->second.Size != entry.Size.value_or(0)))
+            {
+                known->second.ModifiedAt = entry.ModifiedAt.value_or(0);
+                known->second.Size       = entry.Size.value_or(0);
+                report(childRelative, Kind::Modified, false);
+            }
+        }
+
+        for (const auto& [childRelative, isDir] : unseen)
+        {
+            report(childRelative, Kind::Deleted, isDir);
+            // Forget it and, for a directory, everything below it (inotify reports those too)
+            const std::string below = childRelative + "/";
+            sub.Known.erase(childRelative);
+            // Not the entry after it: "a.txt" sorts between "a" and "a/..."
+            auto it = sub.Known.lower_bound(below);
+            while (it != sub.Known.end() && it->first.compare(0, below.size(), below) == 0)
+            {
+                report(it->first, Kind::Deleted, it->second.IsDirectory);
+                it = sub.Known.erase(it);
+            }
+        }
+    }
+}
+
+void FileWatcher::PollLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        const auto now = Clock::now();
+        std::shared_ptr<Subscription> due;
+        auto wake = now + std::chrono::seconds(60);
+        for (const auto& [id, sub] : subscriptions)
+        {
+            if (!sub->Polling)
+                continue;
+            if (sub->NextPoll <= now)
+            {
+                due = sub;
+                break;
+            }
+            wake = std::min(wake, sub->NextPoll);
+        }
+
+        if (!due)
+        {
+            pollCv.wait_until(lock, wake);
+            continue;
+        }
+
+        // A poll may block on a slow share; it runs without the lock
+        due->NextPoll = now + due->Options.PollInterval;
+        lock.unlock();
+        std::vector<omnisphere::models::FileChangeEvent> changes;
+        try
+        {
+            Poll(*due, changes);
+        }
+        catch (...)
+        {
+            changes.clear();
+            omnisphere::models::FileChangeEvent rescan;
+            rescan.Kind = Kind::Rescan;
+            changes.push_back(rescan);
+        }
+        lock.lock();
+
+        for (const auto& change : changes)
+            AddLocked(*due, change.RelativePath, change.Kind, change.IsDirectory);
+    }
+}
+
+} // namespace omnisphere::repositories
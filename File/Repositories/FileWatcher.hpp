@@ -0,0 +1,159 @@
+#pragma once
+#include "File/Models/FileChangeEvent.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    struct FileWatchOptions
+    {
+        bool Recursive = false;
+        std::chrono::milliseconds Debounce{200};    // Deliver once the directory has been quiet this long
+        std::chrono::milliseconds MaxDelay{1000};   // ...or this long after the first pending change
+        size_t MaxQueued = 4096;                    // Distinct pending paths before the batch turns into a Rescan
+        std::chrono::seconds PollInterval{5};       // Network mounts only
+        unsigned FullPollEvery = 6;                 // Every Nth poll also re-stats files in unchanged directories
+        bool ForcePolling = false;
+        bool PollFallback = true;                   // False: Watch throws instead of polling what inotify cannot cover
+    };
+
+    // Change subscriptions for directories. Local directories are followed with one shared
+    // inotify instance; network mounts (and anything inotify cannot watch) are polled, and a
+    // poll only lists the directories whose own mtime moved, with a full pass every few
+    // rounds to catch files rewritten in place. Changes are coalesced per path (created then
+    // written is Created, created then deleted is nothing) and delivered in batches once the
+    // directory has been quiet for Debounce. A subscription holds at most MaxQueued pending
+    // paths; beyond that, or when the kernel queue overflows, the batch is replaced by a
+    // single Rescan. Three threads (inotify reader, dispatcher, poller) serve all
+    // subscriptions; callbacks run on the shared pool, never two at once for one subscription.
+    class FileWatcher
+    {
+    public:
+        using Callback = std::function<void(const std::vector<omnisphere::models::FileChangeEvent>&)>;
+
+        FileWatcher();
+        ~FileWatcher();
+
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        static FileWatcher& Instance();
+
+        // Returns the subscription id. Throws when the directory does not exist.
+        uint64_t Watch(const std::string& directory, const FileWatchOptions& options, Callback callback);
+
+        // Once this returns the callback is not running and will not be called again
+        // (unless Unwatch is called from the callback itself, which is allowed)
+        void Unwatch(uint64_t id);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        using Kind  = omnisphere::enums::FileChangeKind;
+
+        struct Pending
+        {
+            Kind Change;
+            bool IsDirectory = false;
+            uint64_t Seq = 0;
+        };
+
+        struct Snapshot
+        {
+            bool IsDirectory = false;
+            int64_t ModifiedAt = 0;     // Milliseconds, from the listing
+            uint64_t Size = 0;
+            int64_t DirMtimeNs = -1;    // Directories: mtime when last listed
+        };
+
+        struct Subscription
+        {
+            uint64_t Id = 0;
+            std::string Root;
+            FileWatchOptions Options;
+            Callback OnChange;
+            bool Removed = false;
+
+            // inotify
+            std::vector<int> Wds;
+
+            // Polling; Known is only touched by the poller thread once the watch is set up
+            bool Polling = false;
+            std::map<std::string, Snapshot> Known;
+            Clock::time_point NextPoll;
+            unsigned Polls = 0;
+            bool Unreachable = false;
+
+            // Delivery
+            std::unordered_map<std::string, Pending> Queue;
+            uint64_t NextSeq = 0;
+            bool Rescan = false;
+            Clock::time_point FirstAt;
+            Clock::time_point LastAt;
+            bool Delivering = false;
+        };
+
+        struct WatchedDir
+        {
+            std::string Path;
+            std::vector<std::pair<uint64_t, std::string>> Subscribers;  // Subscription id, path relative to its root
+        };
+
+        struct RawEvent
+        {
+            int Wd;
+            uint32_t Mask;
+            std::string Name;
+        };
+
+        std::mutex mutex;
+        std::condition_variable dispatchCv;
+        std::condition_variable deliveredCv;
+        std::condition_variable pollCv;
+        std::unordered_map<uint64_t, std::shared_ptr<Subscription>> subscriptions;
+        std::unordered_map<int, WatchedDir> dirs;
+        uint64_t nextId = 1;
+        bool stopping = false;
+
+        // Watch adds its watches without the lock; events for wds not merged yet are kept
+        // here meanwhile and replayed to the new subscription
+        unsigned settingUp = 0;
+        std::vector<RawEvent> early;
+        bool earlyOverflow = false;
+
+        int inotifyFd = -1;
+        int stopFd = -1;
+        std::thread reader;
+        std::thread dispatcher;
+        std::thread poller;
+
+        struct WatchedTree;
+
+        // Subscribes sub to the watches in tree, which was built for the directory at
+        // `relative`. With report, its entries are queued as Created. False when inotify
+        // refused part of the tree.
+        bool MergeLocked(Subscription& sub, const WatchedTree& tree, const std::string& relative, bool report);
+        void ReleaseWatchesLocked(Subscription& sub);
+        // Drops sub's watches on the directory at `relative` and below, e.g. after it moved
+        void ReleaseSubtreeLocked(Subscription& sub, const std::string& relative);
+        void FinishSetupLocked(std::unique_lock<std::mutex>& lock, Subscription& sub, bool replay);
+        void HandleLocked(std::unique_lock<std::mutex>& lock, const RawEvent& event);
+        void AddLocked(Subscription& sub, const std::string& relative, Kind change, bool isDirectory);
+        void DeliverLocked(const std::shared_ptr<Subscription>& sub);
+
+        static void Scan(Subscription& sub, const std::string& relative, std::vector<std::pair<std::string, Snapshot>>* created);
+        static void Poll(Subscription& sub, std::vector<omnisphere::models::FileChangeEvent>& changes);
+
+        void Read();
+        void Dispatch();
+        void PollLoop();
+    };
+} // namespace omnisphere::repositories
@@ -0,0 +1,1279 @@
+#include "File/Repositories/FilenameIndex.hpp"
+#include "File/Repositories/AtomicFile.hpp"
+#include "File/Repositories/ContentCache.hpp"
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include "File/Repositories/File.hpp"
+#include "File/Repositories/FileWatcher.hpp"
+#include "File/Repositories/TreeWalker.hpp"
+#include "File/Repositories/WorkStealingPool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t fileMagic     = 0x31584449494e4d4f;     // "OMNIIDX1"
+constexpr uint32_t fileVersion   = 1;
+constexpr int maxDepth           = 64;                     // As ListTree
+constexpr size_t mountSlots      = 4;                      // Directories of one network mount listed at once
+constexpr size_t minCompaction   = 4096;                   // Overlay size that triggers a merge, or 1/32 of the base
+constexpr size_t maxBacklog      = 65536;                  // Events held during the first scan before giving up on them
+constexpr std::chrono::seconds retryInterval{30};          // Root not resolvable (share not mounted yet)
+
+// The file is these records in native byte order, each section 8-byte aligned:
+// header, root path, entries sorted by folded name, directories sorted by path, entry
+// indices grouped by directory, names, folded names (same offsets), directory paths.
+struct FileHeader
+{
+    uint64_t Magic;
+    uint32_t Version;
+    uint32_t RootBytes;
+    uint64_t Entries;
+    uint64_t Dirs;
+    uint64_t NameBytes;
+    uint64_t DirPathBytes;
+    int64_t BuiltAt;
+};
+
+struct EntryRecord
+{
+    uint32_t NameOffset;    // Into both name blocks; names are '\0' terminated
+    uint32_t Dir;
+    uint16_t NameLength;
+    uint16_t Flags;
+};
+
+struct DirRecord
+{
+    uint64_t PathOffset;
+    uint32_t PathLength;
+    uint32_t FirstChild;    // Into the by-directory indices
+    uint32_t ChildCount;
+    uint32_t Reserved;
+    int64_t MtimeNs;        // When it was listed; -1 if unknown
+};
+
+constexpr uint16_t directoryFlag = 1;
+
+struct Layout
+{
+    size_t Root, Entries, Dirs, ByDir, Names, Folded, DirPaths, Total;
+
+    Layout(size_t rootBytes, size_t entries, size_t dirs, size_t nameBytes, size_t dirPathBytes)
+    {
+        auto align = [](size_t n) { return (n + 7) & ~size_t(7); };
+        Root     = sizeof(FileHeader);
+        Entries  = align(Root + rootBytes);
+        Dirs     = align(Entries + entries * sizeof(EntryRecord));
+        ByDir    = Dirs + dirs * sizeof(DirRecord);
+        Names    = align(ByDir + entries * sizeof(uint32_t));
+        Folded   = Names + nameBytes;
+        DirPaths = Folded + nameBytes;
+        Total    = DirPaths + dirPathBytes;
+    }
+};
+
+struct ScannedDir
+{
+    std::string Relative;
+    int64_t MtimeNs = -1;
+};
+
+struct ScannedEntry
+{
+    uint32_t Dir = 0;       // Into the ScannedDir list
+    std::string Name;
+    bool IsDirectory = false;
+};
+
+int64_t NowUnixMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// ASCII only, so a folded name has the length (and offsets) of the original
+char Fold(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string Fold(std::string_view text)
+{
+    std::string folded(text);
+    for (char& c : folded)
+        c = Fold(c);
+    return folded;
+}
+
+std::string Join(std::string_view relative, std::string_view name)
+{
+    std::string joined;
+    joined.reserve(relative.size() + 1 + name.size());
+    joined.append(relative);
+    if (!relative.empty())
+        joined.push_back('/');
+    joined.append(name);
+    return joined;
+}
+
+std::string_view ParentOf(std::string_view relative)
+{
+    const size_t slash = relative.rfind('/');
+    return slash == std::string_view::npos ? std::string_view() : relative.substr(0, slash);
+}
+
+std::string_view NameOf(std::string_view relative)
+{
+    const size_t slash = relative.rfind('/');
+    return slash == std::string_view::npos ? relative : relative.substr(slash + 1);
+}
+
+// Dot entries are left out of the index, as TreeWalker leaves them out of the scan
+bool Hidden(std::string_view relative)
+{
+    return !relative.empty() && (relative[0] == '.' || relative.find("/.") != std::string_view::npos);
+}
+
+bool StartsWith(std::string_view text, std::string_view prefix)
+{
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+const char* Search(const char* haystack, size_t size, std::string_view needle)
+{
+#ifdef __linux__
+    return static_cast<const char*>(::memmem(haystack, size, needle.data(), needle.size()));
+#else
+    const char* end = haystack + size;
+    const char* hit = std::search(haystack, end, needle.begin(), needle.end());
+    return hit == end ? nullptr : hit;
+#endif
+}
+
+int64_t DirMtimeNs(const std::string& path)
+{
+#ifndef _WIN32
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+        return -1;
+#ifdef __APPLE__
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#else
+    std::error_code ec;
+    const auto time = fs::last_write_time(path, ec);
+    return ec ? -1 : static_cast<int64_t>(time.time_since_epoch().count());
+#endif
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Base: one immutable index file, mapped or in memory
+// ---------------------------------------------------------------------------
+
+class FilenameIndex::Base
+{
+public:
+    static std::shared_ptr<const Base> Build(const std::string& root, std::vector<ScannedDir> dirs,
+                                             const std::vector<ScannedEntry>& entries, int64_t builtAt)
+    {
+        // Directories by path, so a lookup is a binary search and a subtree is a range
+        std::vector<uint32_t> dirOrder(dirs.size());
+        for (uint32_t i = 0; i < dirOrder.size(); ++i)
+            dirOrder[i] = i;
+        std::sort(dirOrder.begin(), dirOrder.end(), [&](uint32_t a, uint32_t b) { return dirs[a].Relative < dirs[b].Relative; });
+        std::vector<uint32_t> dirRank(dirs.size());
+        for (uint32_t i = 0; i < dirOrder.size(); ++i)
+            dirRank[dirOrder[i]] = i;
+
+        std::vector<std::string> folded(entries.size());
+        size_t nameBytes = 0;
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            folded[i] = Fold(entries[i].Name);
+            nameBytes += entries[i].Name.size() + 1;
+        }
+        size_t dirPathBytes = 0;
+        for (const auto& dir : dirs)
+            dirPathBytes += dir.Relative.size();
+        if (nameBytes > UINT32_MAX || entries.size() > UINT32_MAX)
+            throw std::runtime_error("Too many names to index under " + root);
+
+        std::vector<uint32_t> order(entries.size());
+        for (uint32_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            if (int c = folded[a].compare(folded[b]))
+                return c < 0;
+            if (entries[a].Dir != entries[b].Dir)
+                return dirRank[entries[a].Dir] < dirRank[entries[b].Dir];
+            return entries[a].Name < entries[b].Name;
+        });
+
+        const Layout layout(root.size(), entries.size(), dirs.size(), nameBytes, dirPathBytes);
+        auto bytes = std::make_shared<std::vector<unsigned char>>(layout.Total);
+        unsigned char* out = bytes->data();
+
+        FileHeader header{};
+        header.Magic        = fileMagic;
+        header.Version      = fileVersion;
+        header.RootBytes    = static_cast<uint32_t>(root.size());
+        header.Entries      = entries.size();
+        header.Dirs         = dirs.size();
+        header.NameBytes    = nameBytes;
+        header.DirPathBytes = dirPathBytes;
+        header.BuiltAt      = builtAt;
+        std::memcpy(out, &header, sizeof(header));
+        std::memcpy(out + layout.Root, root.data(), root.size());
+
+        auto* entryOut = reinterpret_cast<EntryRecord*>(out + layout.Entries);
+        std::vector<uint32_t> childCount(dirs.size(), 0);
+        uint32_t nameOffset = 0;
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            const ScannedEntry& entry = entries[order[i]];
+            EntryRecord record{};
+            record.NameOffset = nameOffset;
+            record.Dir        = dirRank[entry.Dir];
+            record.NameLength = static_cast<uint16_t>(entry.Name.size());
+            record.Flags      = entry.IsDirectory ? directoryFlag : 0;
+            entryOut[i] = record;
+            std::memcpy(out + layout.Names + nameOffset, entry.Name.data(), entry.Name.size());
+            std::memcpy(out + layout.Folded + nameOffset, folded[order[i]].data(), entry.Name.size());
+            nameOffset += static_cast<uint32_t>(entry.Name.size()) + 1;
+            ++childCount[record.Dir];
+        }
+
+        auto* dirOut = reinterpret_cast<DirRecord*>(out + layout.Dirs);
+        uint64_t pathOffset = 0;
+        uint32_t firstChild = 0;
+        for (uint32_t d = 0; d < dirOrder.size(); ++d)
+        {
+            const ScannedDir& dir = dirs[dirOrder[d]];
+            DirRecord record{};
+            record.PathOffset = pathOffset;
+            record.PathLength = static_cast<uint32_t>(dir.Relative.size());
+            record.FirstChild = firstChild;
+            record.ChildCount = childCount[d];
+            record.MtimeNs    = dir.MtimeNs;
+            dirOut[d] = record;
+            std::memcpy(out + layout.DirPaths + pathOffset, dir.Relative.data(), dir.Relative.size());
+            pathOffset += dir.Relative.size();
+            firstChild += childCount[d];
+        }
+
+        // Stable by directory, so each directory's children stay in folded-name order
+        auto* byDir = reinterpret_cast<uint32_t*>(out + layout.ByDir);
+        std::vector<uint32_t> next(dirs.size());
+        for (uint32_t d = 0; d < dirs.size(); ++d)
+            next[d] = dirOut[d].FirstChild;
+        for (uint32_t i = 0; i < order.size(); ++i)
+            byDir[next[entryOut[i].Dir]++] = i;
+
+        omnisphere::models::FileBuffer buffer;
+        buffer.Size = bytes->size();
+        buffer.Data = std::shared_ptr<const unsigned char>(bytes, bytes->data());
+        return Open(std::move(buffer), root);
+    }
+
+    // Null when the bytes are not a complete index of this root
+    static std::shared_ptr<const Base> Open(omnisphere::models::FileBuffer buffer, const std::string& root)
+    {
+        if (buffer.Size < sizeof(FileHeader))
+            return nullptr;
+        const unsigned char* in = buffer.begin();
+        const auto* header = reinterpret_cast<const FileHeader*>(in);
+        if (header->Magic != fileMagic || header->Version != fileVersion || header->RootBytes != root.size() ||
+            header->Entries > UINT32_MAX || header->Dirs > UINT32_MAX || header->NameBytes > UINT32_MAX)
+            return nullptr;
+
+        const Layout layout(header->RootBytes, header->Entries, header->Dirs, header->NameBytes, header->DirPathBytes);
+        if (layout.Total != buffer.Size || std::memcmp(in + layout.Root, root.data(), root.size()) != 0)
+            return nullptr;
+
+        auto base = std::shared_ptr<Base>(new Base());
+        base->header   = header;
+        base->entries  = reinterpret_cast<const EntryRecord*>(in + layout.Entries);
+        base->dirs     = reinterpret_cast<const DirRecord*>(in + layout.Dirs);
+        base->byDir    = reinterpret_cast<const uint32_t*>(in + layout.ByDir);
+        base->names    = reinterpret_cast<const char*>(in + layout.Names);
+        base->folded   = reinterpret_cast<const char*>(in + layout.Folded);
+        base->dirPaths = reinterpret_cast<const char*>(in + layout.DirPaths);
+
+        // A truncated or foreign file must not send a lookup out of bounds
+        for (size_t i = 0; i < header->Entries; ++i)
+        {
+            const EntryRecord& e = base->entries[i];
+            if (e.Dir >= header->Dirs || uint64_t(e.NameOffset) + e.NameLength >= header->NameBytes || base->byDir[i] >= header->Entries)
+                return nullptr;
+        }
+        for (size_t d = 0; d < header->Dirs; ++d)
+        {
+            const DirRecord& r = base->dirs[d];
+            if (r.PathOffset + r.PathLength > header->DirPathBytes || uint64_t(r.FirstChild) + r.ChildCount > header->Entries)
+                return nullptr;
+        }
+
+        base->buffer = std::move(buffer);
+        return base;
+    }
+
+    const omnisphere::models::FileBuffer& Bytes() const { return buffer; }
+    size_t Entries() const { return header->Entries; }
+    size_t Dirs() const { return header->Dirs; }
+    int64_t BuiltAt() const { return header->BuiltAt; }
+
+    std::string_view Name(size_t i) const { return {names + entries[i].NameOffset, entries[i].NameLength}; }
+    std::string_view Folded(size_t i) const { return {folded + entries[i].NameOffset, entries[i].NameLength}; }
+    bool IsDirectory(size_t i) const { return entries[i].Flags & directoryFlag; }
+    uint32_t DirOf(size_t i) const { return entries[i].Dir; }
+    std::string Relative(size_t i) const { return Join(DirPath(entries[i].Dir), Name(i)); }
+
+    std::string_view DirPath(size_t d) const { return {dirPaths + dirs[d].PathOffset, dirs[d].PathLength}; }
+    int64_t DirMtime(size_t d) const { return dirs[d].MtimeNs; }
+
+    std::optional<size_t> FindDir(std::string_view relative) const
+    {
+        size_t lo = 0, hi = Dirs();
+        while (lo < hi)
+        {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (DirPath(mid) < relative)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < Dirs() && DirPath(lo) == relative)
+            return lo;
+        return std::nullopt;
+    }
+
+    // Directories at or below `relative`: a contiguous range of the sorted paths
+    std::pair<size_t, size_t> Subtree(std::string_view relative) const
+    {
+        const std::string below = relative.empty() ? std::string() : std::string(relative) + "/";
+        size_t lo = 0, hi = Dirs();
+        while (lo < hi)
+        {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (DirPath(mid) < below)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        size_t end = lo;
+        while (end < Dirs() && StartsWith(DirPath(end), below))
+            ++end;
+        return {lo, end};
+    }
+
+    const uint32_t* ChildrenBegin(size_t d) const { return byDir + dirs[d].FirstChild; }
+    const uint32_t* ChildrenEnd(size_t d) const { return byDir + dirs[d].FirstChild + dirs[d].ChildCount; }
+
+    std::optional<size_t> Locate(std::string_view relative) const
+    {
+        const auto dir = FindDir(ParentOf(relative));
+        if (!dir)
+            return std::nullopt;
+        const std::string_view name = NameOf(relative);
+        const std::string key = Fold(name);
+        const uint32_t* it = std::lower_bound(ChildrenBegin(*dir), ChildrenEnd(*dir), key,
+                                              [&](uint32_t i, const std::string& k) { return Folded(i) < k; });
+        for (; it != ChildrenEnd(*dir) && Folded(*it) == key; ++it)
+        {
+            if (Name(*it) == name)
+                return *it;
+        }
+        return std::nullopt;
+    }
+
+    // Entries whose folded name starts with `prefix`
+    std::pair<size_t, size_t> PrefixRange(std::string_view prefix) const
+    {
+        size_t lo = 0, hi = Entries();
+        while (lo < hi)
+        {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (Folded(mid) < prefix)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        size_t end = lo, count = Entries() - lo;
+        while (count > 0)
+        {
+            const size_t step = count / 2;
+            if (StartsWith(Folded(end + step), prefix))
+            {
+                end += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        return {lo, end};
+    }
+
+    // Calls visit(entry) for every entry whose folded name contains `needle`, in name order,
+    // until it returns false
+    template <typename Visit>
+    void Containing(std::string_view needle, Visit&& visit) const
+    {
+        const size_t total = header->NameBytes;
+        size_t pos = 0;
+        while (pos < total)
+        {
+            const char* hit = Search(folded + pos, total - pos, needle);
+            if (!hit)
+                return;
+            const uint32_t offset = static_cast<uint32_t>(hit - folded);
+            const EntryRecord* e = std::upper_bound(entries, entries + Entries(), offset,
+                                                    [](uint32_t o, const EntryRecord& r) { return o < r.NameOffset; }) - 1;
+            if (offset + needle.size() <= uint64_t(e->NameOffset) + e->NameLength && !visit(static_cast<size_t>(e - entries)))
+                return;
+            pos = e->NameOffset + e->NameLength + 1;
+        }
+    }
+
+private:
+    Base() = default;
+
+    omnisphere::models::FileBuffer buffer;
+    const FileHeader* header = nullptr;
+    const EntryRecord* entries = nullptr;
+    const DirRecord* dirs = nullptr;
+    const uint32_t* byDir = nullptr;
+    const char* names = nullptr;
+    const char* folded = nullptr;
+    const char* dirPaths = nullptr;
+};
+
+// ---------------------------------------------------------------------------
+// Root: a base plus the changes since it was built
+// ---------------------------------------------------------------------------
+
+struct FilenameIndex::Root
+{
+    std::string Name;
+    std::string Path;                                       // As configured
+    std::string Resolved;
+    std::shared_ptr<const Base> Index;                      // Null until the first scan or load
+
+    std::map<std::string, bool> Added;                      // Relative path -> is directory
+    std::unordered_set<std::string> Removed;                // Hidden in Index, with everything below
+    std::unordered_map<std::string, int64_t> DirMtimes;     // Listed again since Index was built
+    std::vector<omnisphere::models::FileChangeEvent> Backlog;   // Arrived during the first scan
+
+    // Overlay changes made while Compact merges a copy of the overlay; replayed against the
+    // merged base once it is in place
+    struct Change
+    {
+        enum { Add, Remove, Listed } Op;
+        std::string Relative;
+        bool IsDirectory = false;
+        int64_t MtimeNs = -1;
+    };
+    std::optional<std::vector<Change>> Journal;
+    bool JournalOverflowed = false;
+
+    uint64_t WatchId = 0;
+    bool Live = false;
+    bool Loaded = false;
+    bool RescanDue = false;
+    Clock::time_point NextRun;
+
+    std::optional<int64_t> LastBuiltAt;
+    double LastBuildMs = 0;
+    std::optional<int64_t> LastRescanAt;
+    std::optional<std::string> LastError;
+
+    size_t Overlay() const { return Added.size() + Removed.size(); }
+    bool NeedsCompaction() const { return Index && Overlay() > std::max(minCompaction, Index->Entries() / 32); }
+
+    bool Visible(std::string_view relative) const
+    {
+        if (Removed.empty())
+            return true;
+        std::string path(relative);
+        for (;;)
+        {
+            if (Removed.count(path))
+                return false;
+            const size_t slash = path.rfind('/');
+            if (slash == std::string::npos)
+                return true;
+            path.resize(slash);
+        }
+    }
+
+    bool InIndex(std::string_view relative) const
+    {
+        return Index && Index->Locate(relative) && Visible(relative);
+    }
+
+    void Record(Change change)
+    {
+        if (!Journal)
+            return;
+        if (Journal->size() < maxBacklog)
+            Journal->push_back(std::move(change));
+        else
+            JournalOverflowed = true;
+    }
+
+    void Add(const std::string& relative, bool isDirectory)
+    {
+        Record({Change::Add, relative, isDirectory});
+        if (relative.empty() || Hidden(relative) || InIndex(relative))
+            return;
+        Added[relative] = isDirectory;
+    }
+
+    void Remove(const std::string& relative)
+    {
+        Record({Change::Remove, relative});
+        const std::string below = relative + "/";
+        auto it = Added.find(relative);
+        if (it != Added.end())
+            it = Added.erase(it);
+        else
+            it = Added.lower_bound(below);
+        while (it != Added.end() && StartsWith(it->first, below))
+            it = Added.erase(it);
+        if (InIndex(relative))
+            Removed.insert(relative);
+    }
+
+    void Apply(const omnisphere::models::FileChangeEvent& event)
+    {
+        using Kind = omnisphere::enums::FileChangeKind;
+        if (!Index)
+        {
+            if (Backlog.size() < maxBacklog)
+                Backlog.push_back(event);
+            else
+                RescanDue = true;
+            return;
+        }
+
+        if (event.Kind == Kind::Rescan || (event.Kind == Kind::Deleted && event.RelativePath.empty()))
+            RescanDue = true;
+        else if (event.Kind == Kind::Created)
+            Add(event.RelativePath, event.IsDirectory);
+        else if (event.Kind == Kind::Deleted)
+            Remove(event.RelativePath);
+        // Modified changes no name
+    }
+
+    void Listed(const std::string& relative, int64_t mtimeNs)
+    {
+        Record({Change::Listed, relative, false, mtimeNs});
+        DirMtimes[relative] = mtimeNs;
+    }
+
+    // Name and type of what the index holds directly inside `relative`
+    std::map<std::string, bool> Children(const std::string& relative) const
+    {
+        std::map<std::string, bool> children;
+        if (Index && Visible(relative))
+        {
+            if (auto dir = Index->FindDir(relative))
+            {
+                for (const uint32_t* it = Index->ChildrenBegin(*dir); it != Index->ChildrenEnd(*dir); ++it)
+                {
+                    const std::string name(Index->Name(*it));
+                    if (Removed.empty() || !Removed.count(Join(relative, name)))
+                        children.emplace(name, Index->IsDirectory(*it));
+                }
+            }
+        }
+        const std::string prefix = relative.empty() ? std::string() : relative + "/";
+        for (auto it = Added.lower_bound(prefix); it != Added.end() && StartsWith(it->first, prefix); ++it)
+        {
+            if (it->first.find('/', prefix.size()) == std::string::npos)
+                children[it->first.substr(prefix.size())] = it->second;
+        }
+        return children;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// FilenameIndex
+// ---------------------------------------------------------------------------
+
+namespace
+{
+
+std::string DefaultDirectory()
+{
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    return base ? std::string(base) + "\\OmniSphere\\index" : "OmniSphere\\index";
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/omnisphere/index";
+    const char* home = std::getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.cache/omnisphere/index";
+#endif
+}
+
+} // namespace
+
+FilenameIndex::FilenameIndex(std::string directory, std::chrono::seconds rescanInterval)
+    : directory(directory.empty() ? DefaultDirectory() : std::move(directory)), rescanInterval(rescanInterval)
+{
+    // Constructed first, so they are destroyed after the worker and the watches are gone
+    WorkStealingPool::Instance();
+    ContentCache::Instance();
+    FileWatcher::Instance();
+    worker = std::thread([this] { Run(); });
+}
+
+FilenameIndex::~FilenameIndex()
+{
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+
+    std::vector<uint64_t> watches;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (const auto& [name, root] : roots)
+        {
+            if (root->WatchId)
+                watches.push_back(root->WatchId);
+        }
+        roots.clear();
+    }
+    for (uint64_t id : watches)
+        FileWatcher::Instance().Unwatch(id);
+}
+
+FilenameIndex& FilenameIndex::Instance()
+{
+    static FilenameIndex index;
+    return index;
+}
+
+std::string FilenameIndex::IndexPath(const std::string& name) const
+{
+    return (fs::path(directory) / (name + ".idx")).string();
+}
+
+bool FilenameIndex::CurrentLocked(const std::shared_ptr<Root>& root) const
+{
+    auto it = roots.find(root->Name);
+    return it != roots.end() && it->second == root;
+}
+
+void FilenameIndex::Set(const std::string& name, const std::string& path)
+{
+    uint64_t oldWatch = 0;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        auto it = roots.find(name);
+        if (it != roots.end() && it->second->Path == path)
+            return;
+        if (it != roots.end())
+        {
+            oldWatch = it->second->WatchId;
+            roots.erase(it);
+        }
+        if (!path.empty())
+        {
+            auto root = std::make_shared<Root>();
+            root->Name    = name;
+            root->Path    = path;
+            root->NextRun = Clock::now();
+            roots.emplace(name, root);
+        }
+    }
+    // Outside the lock: Unwatch waits for a running callback, which takes the lock
+    if (oldWatch)
+        FileWatcher::Instance().Unwatch(oldWatch);
+    wake.notify_all();
+}
+
+std::vector<omnisphere::models::IndexedFile> FilenameIndex::Find(const FilenameQuery& query) const
+{
+    struct Hit
+    {
+        std::string Folded;
+        omnisphere::models::IndexedFile File;
+    };
+    const std::string needle = Fold(query.Text);
+    std::vector<Hit> hits;
+    if (query.MaxResults == 0)
+        return {};
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (const auto& [name, root] : roots)
+    {
+        if (!root->Index)
+            continue;
+        if (!query.Roots.empty() && std::find(query.Roots.begin(), query.Roots.end(), name) == query.Roots.end())
+            continue;
+
+        std::string rootPath = root->Path;
+        while (rootPath.size() > 1 && (rootPath.back() == '/' || rootPath.back() == '\\'))
+            rootPath.pop_back();
+        auto add = [&](std::string_view fileName, std::string relative, bool isDirectory)
+        {
+            Hit hit;
+            hit.Folded                 = Fold(fileName);
+            hit.File.Root              = name;
+            hit.File.Name              = std::string(fileName);
+            hit.File.Path              = rootPath + "/" + relative;
+            hit.File.RelativePath      = std::move(relative);
+            hit.File.IsDirectory       = isDirectory;
+            hits.push_back(std::move(hit));
+        };
+
+        // The index yields names in order, so its first MaxResults visible hits are enough
+        const Base& base = *root->Index;
+        size_t taken = 0;
+        auto visit = [&](size_t i)
+        {
+            if (!query.IncludeDirectories && base.IsDirectory(i))
+                return true;
+            std::string relative = base.Relative(i);
+            if (!root->Visible(relative))
+                return true;
+            add(base.Name(i), std::move(relative), base.IsDirectory(i));
+            return ++taken < query.MaxResults;
+        };
+        if (query.Substring && !needle.empty())
+        {
+            base.Containing(needle, visit);
+        }
+        else
+        {
+            const auto [begin, end] = base.PrefixRange(needle);
+            for (size_t i = begin; i < end && visit(i); ++i)
+                ;
+        }
+
+        for (const auto& [relative, isDirectory] : root->Added)
+        {
+            if (!query.IncludeDirectories && isDirectory)
+                continue;
+            const std::string folded = Fold(NameOf(relative));
+            if (query.Substring ? folded.find(needle) != std::string::npos : StartsWith(folded, needle))
+                add(NameOf(relative), relative, isDirectory);
+        }
+    }
+    lock.unlock();
+
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b)
+    {
+        if (a.Folded != b.Folded)
+            return a.Folded < b.Folded;
+        if (a.File.Root != b.File.Root)
+            return a.File.Root < b.File.Root;
+        return a.File.RelativePath < b.File.RelativePath;
+    });
+    if (hits.size() > query.MaxResults)
+        hits.resize(query.MaxResults);
+
+    std::vector<omnisphere::models::IndexedFile> results;
+    results.reserve(hits.size());
+    for (auto& hit : hits)
+        results.push_back(std::move(hit.File));
+    return results;
+}
+
+std::vector<omnisphere::models::FilenameIndexStatus> FilenameIndex::Status() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<omnisphere::models::FilenameIndexStatus> statuses;
+    for (const auto& [name, root] : roots)
+    {
+        omnisphere::models::FilenameIndexStatus status;
+        status.Root           = name;
+        status.Path           = root->Path;
+        status.Ready          = root->Index != nullptr;
+        status.Live           = root->Live;
+        status.Loaded         = root->Loaded;
+        status.Entries        = root->Index ? root->Index->Entries() : 0;
+        status.PendingChanges = root->Overlay();
+        status.LastBuiltAt    = root->LastBuiltAt;
+        status.LastBuildMs    = root->LastBuildMs;
+        status.LastRescanAt   = root->LastRescanAt;
+        status.LastError      = root->LastError;
+        statuses.push_back(std::move(status));
+    }
+    return statuses;
+}
+
+// ---------------------------------------------------------------------------
+// Background work
+// ---------------------------------------------------------------------------
+
+void FilenameIndex::Run()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    while (!stopping)
+    {
+        const auto now = Clock::now();
+        auto wakeAt = now + std::chrono::minutes(5);
+        std::shared_ptr<Root> due;
+        for (const auto& [name, root] : roots)
+        {
+            const bool periodic = !root->Index || !root->Live;
+            if (root->RescanDue || root->NeedsCompaction() || (periodic && root->NextRun <= now))
+            {
+                due = root;
+                break;
+            }
+            if (periodic)
+                wakeAt = std::min(wakeAt, root->NextRun);
+        }
+
+        if (!due)
+        {
+            wake.wait_until(lock, wakeAt);
+            continue;
+        }
+
+        lock.unlock();
+        try
+        {
+            Maintain(due);
+        }
+        catch (const std::exception& e)
+        {
+            std::unique_lock<std::shared_mutex> failed(mutex);
+            due->LastError = e.what();
+            due->RescanDue = false;
+            due->NextRun   = Clock::now() + retryInterval;
+        }
+        lock.lock();
+    }
+}
+
+void FilenameIndex::Maintain(const std::shared_ptr<Root>& root)
+{
+    bool started;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        started = root->Index != nullptr;
+    }
+    if (!started)
+    {
+        Start(root);
+        return;
+    }
+
+    bool rescan, compact;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        rescan = root->RescanDue || (!root->Live && root->NextRun <= Clock::now());
+        root->RescanDue = false;
+        if (rescan)
+            root->NextRun = Clock::now() + rescanInterval;
+        compact = root->NeedsCompaction();
+    }
+    if (rescan)
+        Rescan(root);
+    if (compact || rescan)
+    {
+        bool needed;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+            needed = root->NeedsCompaction();
+        }
+        if (needed)
+            Compact(root);
+    }
+}
+
+void FilenameIndex::Start(const std::shared_ptr<Root>& root)
+{
+    const std::string resolved = File::ResolvePath(root->Path);
+    if (resolved.empty() || DirMtimeNs(resolved) < 0)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        root->LastError = "Storage root is not reachable: " + root->Path;
+        root->NextRun   = Clock::now() + retryInterval;
+        return;
+    }
+
+    // Watch before scanning, so nothing that changes during the scan is missed
+    uint64_t watchId = 0;
+    if (File::IsLocalFileSystem(resolved))
+    {
+        FileWatchOptions options;
+        options.Recursive    = true;
+        options.MaxQueued    = maxBacklog;
+        options.PollFallback = false;   // A second copy of the tree in the poller is what this avoids
+        std::weak_ptr<Root> weak = root;
+        try
+        {
+            watchId = FileWatcher::Instance().Watch(resolved, options,
+                [this, weak](const std::vector<omnisphere::models::FileChangeEvent>& events)
+            {
+                auto root = weak.lock();
+                if (!root)
+                    return;
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                if (!CurrentLocked(root))
+                    return;
+                for (const auto& event : events)
+                    root->Apply(event);
+                if (root->RescanDue || root->NeedsCompaction())
+                    wake.notify_all();
+            });
+        }
+        catch (const std::exception&)
+        {
+            watchId = 0;    // Too many directories for inotify: periodic rescans instead
+        }
+    }
+
+    bool current;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        current = CurrentLocked(root);
+        if (current)
+        {
+            root->Resolved = resolved;
+            root->WatchId  = watchId;
+            root->Live     = watchId != 0;
+        }
+    }
+    if (!current)
+    {
+        if (watchId)
+            FileWatcher::Instance().Unwatch(watchId);
+        return;
+    }
+
+    const auto started = Clock::now();
+    std::shared_ptr<const Base> base;
+    try
+    {
+        base = Base::Open(File().ReadSharedImmutable(IndexPath(root->Name)), resolved);
+    }
+    catch (const std::exception&)
+    {
+        // Not there yet
+    }
+    const bool loaded = base != nullptr;
+
+    if (!loaded)
+    {
+        std::vector<ScannedDir> dirs;
+        std::vector<ScannedEntry> entries;
+        TreeWalkOptions options;
+        options.MaxDepth   = maxDepth;
+        options.SkipHidden = true;
+        options.MountLimit = [](const std::string& directory) -> size_t
+        {
+            return File::IsLocalFileSystem(directory) ? 0 : mountSlots;
+        };
+
+        TreeWalker walker;
+        const TreeWalkResult result = walker.Walk(resolved, options, [&](TreeWalkDirectory&& dir)
+        {
+            const uint32_t index = static_cast<uint32_t>(dirs.size());
+            dirs.push_back(ScannedDir{std::move(dir.RelativePath), dir.Readable ? dir.ModifiedNs : -1});
+            for (auto& entry : dir.Entries)
+                entries.push_back(ScannedEntry{index, std::move(entry.Name), entry.Type == omnisphere::enums::FileType::Directory});
+            return !stopping.load();
+        });
+        if (result.Cancelled)
+            return;
+        base = Base::Build(resolved, std::move(dirs), entries, NowUnixMs());
+    }
+    const double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (!CurrentLocked(root))
+            return;
+        root->Index       = base;
+        root->Loaded      = loaded;
+        root->LastBuiltAt = base->BuiltAt();
+        root->LastBuildMs = elapsedMs;
+        root->LastError.reset();
+        root->NextRun     = Clock::now() + rescanInterval;
+        // A loaded index is as old as the file; a scan may have raced the changes it missed
+        root->RescanDue   = loaded || root->Backlog.size() >= maxBacklog;
+        for (const auto& event : root->Backlog)
+            root->Apply(event);
+        root->Backlog.clear();
+        root->Backlog.shrink_to_fit();
+    }
+    wake.notify_all();
+    if (!loaded)
+        Persist(root, base);
+}
+
+void FilenameIndex::Rescan(const std::shared_ptr<Root>& root)
+{
+    // Every directory the index knows, with the mtime it was listed at
+    std::vector<std::pair<std::string, int64_t>> known;
+    std::string resolved;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (!root->Index)
+            return;
+        resolved = root->Resolved;
+        const Base& base = *root->Index;
+        known.reserve(base.Dirs());
+        for (size_t d = 0; d < base.Dirs(); ++d)
+        {
+            const std::string relative(base.DirPath(d));
+            if (!root->Visible(relative))
+                continue;
+            auto listed = root->DirMtimes.find(relative);
+            known.emplace_back(relative, listed != root->DirMtimes.end() ? listed->second : base.DirMtime(d));
+        }
+        for (const auto& [relative, isDirectory] : root->Added)
+        {
+            if (!isDirectory)
+                continue;
+            auto listed = root->DirMtimes.find(relative);
+            known.emplace_back(relative, listed != root->DirMtimes.end() ? listed->second : -1);
+        }
+    }
+
+    // A stat per directory, in parallel: only the ones that gained, lost or renamed entries are listed
+    std::vector<int64_t> current(known.size(), -1);
+    const size_t parallel = File::IsLocalFileSystem(resolved) ? WorkStealingPool::Instance().Size() : mountSlots;
+    WorkStealingPool::Instance().ForEach(known.size(), parallel, [&](size_t i)
+    {
+        if (!stopping.load(std::memory_order_relaxed))
+            current[i] = DirMtimeNs(known[i].first.empty() ? resolved : (fs::path(resolved) / known[i].first).string());
+    });
+
+    std::deque<std::string> pending;
+    for (size_t i = 0; i < known.size(); ++i)
+    {
+        // Gone (-1): its parent changed too and drops it
+        if (current[i] >= 0 && current[i] != known[i].second)
+            pending.push_back(known[i].first);
+    }
+
+    while (!pending.empty() && !stopping.load())
+    {
+        const std::string relative = std::move(pending.front());
+        pending.pop_front();
+
+        DirectoryEnumerator dir(relative.empty() ? resolved : (fs::path(resolved) / relative).string());
+        uint64_t device = 0, inode = 0;
+        int64_t mtime = -1;
+        if (!dir.IsOpen())
+            continue;
+        dir.Identity(device, inode, &mtime);
+        std::map<std::string, bool> listed;
+        DirectoryEntry entry;
+        while (dir.Next(entry))
+        {
+            if (entry.Name[0] != '.')
+                listed.emplace(std::move(entry.Name), entry.Type == omnisphere::enums::FileType::Directory);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (!CurrentLocked(root))
+            return;
+        const std::map<std::string, bool> indexed = root->Children(relative);
+        for (const auto& [name, isDirectory] : indexed)
+        {
+            auto now = listed.find(name);
+            if (now == listed.end() || now->second != isDirectory)
+                root->Remove(Join(relative, name));
+        }
+        for (const auto& [name, isDirectory] : listed)
+        {
+            auto before = indexed.find(name);
+            if (before != indexed.end() && before->second == isDirectory)
+                continue;
+            const std::string child = Join(relative, name);
+            root->Add(child, isDirectory);
+            if (isDirectory)
+                pending.push_back(child);   // New directory: list what is in it
+        }
+        root->Listed(relative, mtime);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    root->LastRescanAt = NowUnixMs();
+}
+
+void FilenameIndex::Compact(const std::shared_ptr<Root>& root)
+{
+    const auto started = Clock::now();
+    std::shared_ptr<const Base> current;
+    std::string resolved;
+    std::map<std::string, bool> added;
+    std::unordered_set<std::string> removed;
+    std::unordered_map<std::string, int64_t> dirMtimes;
+    {
+        // Only a copy of the overlay is merged; changes from here on go to the journal
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (!root->Index || !CurrentLocked(root) || root->Journal)
+            return;
+        current   = root->Index;
+        resolved  = root->Resolved;
+        added     = root->Added;
+        removed   = root->Removed;
+        dirMtimes = root->DirMtimes;
+        root->Journal.emplace();
+        root->JournalOverflowed = false;
+    }
+
+    // The merge sorts every name, so it runs without the lock: queries and watcher
+    // updates go on against the old base and the live overlay
+    std::shared_ptr<const Base> merged;
+    try
+    {
+        const Base& base = *current;
+        // What Removed hides, resolved to base records once instead of per entry
+        std::vector<bool> dirHidden(base.Dirs(), false), entryHidden(base.Entries(), false);
+        for (const auto& relative : removed)
+        {
+            if (auto entry = base.Locate(relative))
+                entryHidden[*entry] = true;
+            if (auto dir = base.FindDir(relative))
+                dirHidden[*dir] = true;
+            const auto [begin, end] = base.Subtree(relative);
+            for (size_t d = begin; d < end; ++d)
+                dirHidden[d] = true;
+        }
+
+        std::vector<ScannedDir> dirs;
+        std::unordered_map<std::string, uint32_t> dirIndex;
+        auto dirOf = [&](const std::string& relative) -> uint32_t
+        {
+            auto [it, inserted] = dirIndex.emplace(relative, static_cast<uint32_t>(dirs.size()));
+            if (inserted)
+            {
+                auto listed = dirMtimes.find(relative);
+                dirs.push_back(ScannedDir{relative, listed != dirMtimes.end() ? listed->second : -1});
+            }
+            return it->second;
+        };
+
+        std::vector<uint32_t> baseDir(base.Dirs(), UINT32_MAX);
+        for (size_t d = 0; d < base.Dirs(); ++d)
+        {
+            if (dirHidden[d])
+                continue;
+            const std::string relative(base.DirPath(d));
+            baseDir[d] = dirOf(relative);
+            if (!dirMtimes.count(relative))
+                dirs[baseDir[d]].MtimeNs = base.DirMtime(d);
+        }
+
+        std::vector<ScannedEntry> entries;
+        entries.reserve(base.Entries() + added.size());
+        for (size_t i = 0; i < base.Entries(); ++i)
+        {
+            if (entryHidden[i] || baseDir[base.DirOf(i)] == UINT32_MAX)
+                continue;
+            entries.push_back(ScannedEntry{baseDir[base.DirOf(i)], std::string(base.Name(i)), base.IsDirectory(i)});
+        }
+        for (const auto& [relative, isDirectory] : added)
+        {
+            if (isDirectory)
+                dirOf(relative);
+            entries.push_back(ScannedEntry{dirOf(std::string(ParentOf(relative))), std::string(NameOf(relative)), isDirectory});
+        }
+
+        merged = Base::Build(resolved, std::move(dirs), entries, NowUnixMs());
+    }
+    catch (...)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        root->Journal.reset();
+        throw;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        std::vector<Root::Change> journal = std::move(*root->Journal);
+        root->Journal.reset();
+        if (!CurrentLocked(root) || root->Index != current)
+            return;
+
+        root->Index = merged;
+        root->Added.clear();
+        root->Removed.clear();
+        root->DirMtimes.clear();
+        // What changed during the merge, now relative to the merged base
+        if (root->JournalOverflowed)
+        {
+            root->RescanDue = true;
+        }
+        else
+        {
+            for (const auto& change : journal)
+            {
+                if (change.Op == Root::Change::Add)
+                    root->Add(change.Relative, change.IsDirectory);
+                else if (change.Op == Root::Change::Remove)
+                    root->Remove(change.Relative);
+                else
+                    root->Listed(change.Relative, change.MtimeNs);
+            }
+        }
+        root->LastBuiltAt = merged->BuiltAt();
+        root->LastBuildMs = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    }
+    wake.notify_all();
+    Persist(root, merged);
+}
+
+void FilenameIndex::Persist(const std::shared_ptr<Root>& root, const std::shared_ptr<const Base>& base)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        if (!CurrentLocked(root))
+            return;     // Path changed meanwhile; the file now belongs to the new one
+    }
+    try
+    {
+        std::error_code ec;
+        fs::create_directories(directory, ec);
+        AtomicFile file(IndexPath(root->Name));
+        file.Write(base->Bytes().begin(), base->Bytes().Size);
+        // A cache: losing the newest copy to a crash costs a rescan, not data
+        file.Commit(omnisphere::enums::FsyncPolicy::None);
+    }
+    catch (const std::exception& e)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        root->LastError = std::string("Index not saved: ") + e.what();
+    }
+}
+
+} // namespace omnisphere::repositories
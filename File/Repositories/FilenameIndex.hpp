@@ -0,0 +1,78 @@
+#pragma once
+#include "File/Models/FilenameIndexStatus.hpp"
+#include "File/Models/IndexedFile.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    struct FilenameQuery
+    {
+        std::string Text;
+        bool Substring = false;
+        bool IncludeDirectories = true;
+        size_t MaxResults = 1000;
+        std::vector<std::string> Roots;     // Empty: all
+    };
+
+    // Names of everything below the storage roots, for prefix and substring lookups without
+    // walking the tree. Each root is scanned once in parallel (TreeWalker) into one flat file:
+    // records sorted by case-folded name, so a prefix is a binary search, and the folded names
+    // back to back, so a substring is one memmem pass. The file is read back through
+    // ReadSharedImmutable, i.e. mapped, so a restart costs a page-in rather than a scan and is
+    // followed by an incremental rescan. Changes after the scan collect in a small in-memory
+    // overlay, fed by FileWatcher on local roots and by incremental rescans elsewhere (only
+    // directories whose mtime moved are listed again), and are merged into a new file once the
+    // overlay grows past a fraction of the base. Hidden entries are not indexed. One
+    // background thread does the scanning and merging for all roots.
+    class FilenameIndex
+    {
+    public:
+        explicit FilenameIndex(std::string directory = "", std::chrono::seconds rescanInterval = std::chrono::minutes(5));
+        ~FilenameIndex();
+
+        FilenameIndex(const FilenameIndex&) = delete;
+        FilenameIndex& operator=(const FilenameIndex&) = delete;
+
+        static FilenameIndex& Instance();
+
+        // Add, change or (with an empty path) remove one root; indexing happens in the background
+        void Set(const std::string& name, const std::string& path);
+
+        // Roots that are still being scanned for the first time are skipped
+        std::vector<omnisphere::models::IndexedFile> Find(const FilenameQuery& query) const;
+
+        std::vector<omnisphere::models::FilenameIndexStatus> Status() const;
+
+    private:
+        class Base;
+        struct Root;
+
+        std::string directory;
+        std::chrono::seconds rescanInterval;
+
+        mutable std::shared_mutex mutex;
+        std::condition_variable_any wake;
+        std::map<std::string, std::shared_ptr<Root>> roots;
+        std::atomic<bool> stopping{false};
+        std::thread worker;
+
+        void Run();
+        void Maintain(const std::shared_ptr<Root>& root);
+        void Start(const std::shared_ptr<Root>& root);
+        void Rescan(const std::shared_ptr<Root>& root);
+        void Compact(const std::shared_ptr<Root>& root);
+        void Persist(const std::shared_ptr<Root>& root, const std::shared_ptr<const Base>& base);
+        bool CurrentLocked(const std::shared_ptr<Root>& root) const;     // Still the configured root
+        std::string IndexPath(const std::string& name) const;
+    };
+} // namespace omnisphere::repositories
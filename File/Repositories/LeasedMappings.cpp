@@ -0,0 +1,234 @@
+#include "File/Repositories/LeasedMappings.hpp"
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+#ifdef __linux__
+// Realtime, so breaks queue with the fd in si_fd. SIGRTMIN is not a constant expression.
+int LeaseSignal()
+{
+    return SIGRTMIN + 3;
+}
+
+// Moves a private copy of the bytes over the mapping, so it stops depending on the file
+bool Detach(void* addr, size_t size)
+{
+    void* copy = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (copy == MAP_FAILED)
+        return false;
+    std::memcpy(copy, addr, size);
+    ::mprotect(copy, size, PROT_READ);
+    if (::mremap(copy, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, addr) == MAP_FAILED)
+    {
+        ::munmap(copy, size);
+        return false;
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+LeasedMappings::LeasedMappings()
+    : registry(std::make_shared<Registry>())
+{
+#ifdef __linux__
+    sigset_t signals;
+    ::sigemptyset(&signals);
+    ::sigaddset(&signals, LeaseSignal());
+    ::sigaddset(&signals, SIGIO);   // Sent instead when the realtime queue is full
+
+    signalFd = ::signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+    stopFd   = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (signalFd < 0 || stopFd < 0)
+        return;
+
+    // The keeper starts with both signals blocked, so a break waits for signalFd instead of
+    // running the default action, which would end the process
+    sigset_t previous;
+    ::pthread_sigmask(SIG_BLOCK, &signals, &previous);
+    keeper = std::thread([this] { Keep(); });
+    ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    std::unique_lock<std::mutex> lock(startMutex);
+    startedCv.wait(lock, [this] { return keeperTid != 0; });
+#endif
+}
+
+LeasedMappings::~LeasedMappings()
+{
+#ifdef __linux__
+    if (stopFd >= 0)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(stopFd, &one, sizeof(one));
+    }
+    if (keeper.joinable())
+        keeper.join();
+
+    // Nobody answers breaks any more: give the leases up, buffers still unmap themselves
+    {
+        std::lock_guard<std::mutex> lock(registry->Mutex);
+        for (const auto& [fd, mapping] : registry->ByFd)
+        {
+            ::fcntl(fd, F_SETLEASE, F_UNLCK);
+            ::close(fd);
+        }
+        registry->ByFd.clear();
+    }
+    if (stopFd >= 0)
+        ::close(stopFd);
+    if (signalFd >= 0)
+        ::close(signalFd);
+#endif
+}
+
+LeasedMappings& LeasedMappings::Instance()
+{
+    static LeasedMappings mappings;
+    return mappings;
+}
+
+std::shared_ptr<const unsigned char> LeasedMappings::Map(int fd, struct stat& st)
+{
+#ifdef __linux__
+    if (keeperTid == 0)
+        return nullptr;
+
+    // Held until the mapping is registered, so a break that arrives meanwhile finds it
+    std::lock_guard<std::mutex> lock(registry->Mutex);
+
+    f_owner_ex owner{F_OWNER_TID, static_cast<pid_t>(keeperTid)};
+    if (::fcntl(fd, F_SETSIG, LeaseSignal()) != 0 || ::fcntl(fd, F_SETOWN_EX, &owner) != 0 ||
+        ::fcntl(fd, F_SETLEASE, F_RDLCK) != 0)
+        return nullptr;
+
+    // From here on the file cannot be opened for writing or truncated without a break
+    void* addr = MAP_FAILED;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        ::fcntl(fd, F_SETLEASE, F_UNLCK);
+        return nullptr;
+    }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    ::madvise(addr, size, MADV_SEQUENTIAL);
+    const uint64_t id = ++registry->LastId;
+    registry->ByFd[fd] = Mapping{id, addr, size};
+
+    return std::shared_ptr<const unsigned char>(static_cast<const unsigned char*>(addr),
+        [registry = registry, fd, id, addr, size](const unsigned char*)
+        {
+            Release(*registry, fd, id);
+            ::munmap(addr, size);
+        });
+#else
+    (void)fd;
+    (void)st;
+    return nullptr;
+#endif
+}
+
+void LeasedMappings::Release(Registry& registry, int fd, uint64_t id)
+{
+#ifdef __linux__
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+    auto it = registry.ByFd.find(fd);
+    if (it == registry.ByFd.end() || it->second.Id != id)
+        return;     // Already broken, and fd may now belong to another mapping
+    ::fcntl(fd, F_SETLEASE, F_UNLCK);
+    ::close(fd);
+    registry.ByFd.erase(it);
+#else
+    (void)registry;
+    (void)fd;
+    (void)id;
+#endif
+}
+
+void LeasedMappings::BreakLocked(int fd)
+{
+#ifdef __linux__
+    auto it = registry->ByFd.find(fd);
+    if (it == registry->ByFd.end())
+        return;
+    // A signal queued for a lease since released can name an fd reused by a newer one
+    if (::fcntl(fd, F_GETLEASE) != F_UNLCK)
+        return;
+
+    // If there is no memory for the copy the mapping stays on the file; the breaker still
+    // gets through, since the kernel ends the lease after lease-break-time anyway
+    Detach(it->second.Addr, it->second.Size);
+    ::fcntl(fd, F_SETLEASE, F_UNLCK);
+    ::close(fd);
+    registry->ByFd.erase(it);
+#else
+    (void)fd;
+#endif
+}
+
+void LeasedMappings::Keep()
+{
+#ifdef __linux__
+    {
+        std::lock_guard<std::mutex> lock(startMutex);
+        keeperTid = static_cast<long>(::syscall(SYS_gettid));
+    }
+    startedCv.notify_all();
+
+    signalfd_siginfo info[16];
+    for (;;)
+    {
+        pollfd fds[2] = {{stopFd, POLLIN, 0}, {signalFd, POLLIN, 0}};
+        const int rc = ::poll(fds, 2, -1);
+        if (rc < 0 && errno != EINTR)
+            return;
+        if (fds[0].revents)
+            return;
+        if (!(fds[1].revents & POLLIN))
+            continue;
+
+        ssize_t n;
+        while ((n = ::read(signalFd, info, sizeof(info))) > 0)
+        {
+            std::lock_guard<std::mutex> lock(registry->Mutex);
+            for (size_t i = 0; i < static_cast<size_t>(n) / sizeof(signalfd_siginfo); ++i)
+            {
+                if (static_cast<int>(info[i].ssi_signo) == LeaseSignal())
+                {
+                    BreakLocked(info[i].ssi_fd);
+                    continue;
+                }
+
+                // SIGIO carries no fd: look for every lease being broken
+                std::vector<int> fds;
+                for (const auto& [fd, mapping] : registry->ByFd)
+                    fds.push_back(fd);
+                for (int fd : fds)
+                    BreakLocked(fd);
+            }
+        }
+    }
+#endif
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,65 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <sys/stat.h>
+
+namespace omnisphere::repositories
+{
+    // Maps files other writers may truncate. Each mapping holds a read lease on its file, so
+    // an open for writing or a truncate has to break the lease first and waits until it is
+    // released. On a break the keeper thread copies the mapped bytes into anonymous memory,
+    // moves that over the mapping with mremap, so readers keep the same address and bytes and
+    // can no longer fault into SIGBUS, and then releases the lease. Linux only; elsewhere, and
+    // for files that cannot be leased (owned by another user, or already open for writing),
+    // Map returns null and the caller reads into the heap instead.
+    class LeasedMappings
+    {
+    public:
+        LeasedMappings();
+        ~LeasedMappings();
+
+        LeasedMappings(const LeasedMappings&) = delete;
+        LeasedMappings& operator=(const LeasedMappings&) = delete;
+
+        static LeasedMappings& Instance();
+
+        // Leases and maps the whole file open read-only on fd. On success the mapping owns fd
+        // and st is refreshed under the lease; on failure fd is left open and untouched.
+        std::shared_ptr<const unsigned char> Map(int fd, struct stat& st);
+
+    private:
+        struct Mapping
+        {
+            uint64_t Id = 0;
+            void* Addr = nullptr;
+            size_t Size = 0;
+        };
+
+        // Outlives the instance while buffers still reference it
+        struct Registry
+        {
+            std::mutex Mutex;
+            std::unordered_map<int, Mapping> ByFd;
+            uint64_t LastId = 0;
+        };
+
+        std::shared_ptr<Registry> registry;
+
+        std::mutex startMutex;
+        std::condition_variable startedCv;
+        long keeperTid = 0;
+
+        int signalFd = -1;
+        int stopFd = -1;
+        std::thread keeper;
+
+        static void Release(Registry& registry, int fd, uint64_t id);
+        void BreakLocked(int fd);
+        void Keep();
+    };
+} // namespace omnisphere::repositories
@@ -0,0 +1,231 @@
+#include "File/Repositories/MountManager.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <sodium.h>
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+std::string Lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+// Keyed per process, so the value says nothing about the password outside this process
+uint64_t PasswordHash(const omnisphere::dtos::ConnectNetworkShare& share)
+{
+    static const auto key = []
+    {
+        std::array<unsigned char, crypto_generichash_KEYBYTES> bytes{};
+        if (sodium_init() >= 0)
+            randombytes_buf(bytes.data(), bytes.size());
+        return bytes;
+    }();
+
+    const std::string password = share.Password.value_or("");
+    unsigned char out[crypto_generichash_BYTES];
+    crypto_generichash(out, sizeof(out), reinterpret_cast<const unsigned char*>(password.data()), password.size(),
+                       key.data(), key.size());
+    uint64_t hash = 0;
+    std::memcpy(&hash, out, sizeof(hash));
+    return hash;
+}
+
+} // namespace
+
+MountManager::MountManager(Runner runner, size_t threads, std::chrono::seconds baseBackoff, std::chrono::seconds maxBackoff)
+    : runner(std::move(runner)), baseBackoff(baseBackoff), maxBackoff(std::max(maxBackoff, baseBackoff))
+{
+    threads = std::max<size_t>(threads, 1);
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back([this] { Run(); });
+}
+
+MountManager::~MountManager()
+{
+    std::deque<std::pair<std::string, std::shared_ptr<Flight>>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        abandoned.swap(queue);
+    }
+    queueCv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+
+    for (auto& [key, flight] : abandoned)
+        flight->Promise.set_value(MountOutcome{"", "Mount manager is shutting down"});
+}
+
+std::string MountManager::KeyOf(const omnisphere::dtos::ConnectNetworkShare& share)
+{
+    std::string server = share.Server;
+    for (const char* prefix : {"smb://", "nfs://", "\\\\"})
+    {
+        if (Lower(server).rfind(prefix, 0) == 0)
+        {
+            server = server.substr(std::strlen(prefix));
+            break;
+        }
+    }
+    std::replace(server.begin(), server.end(), '\\', '/');
+
+    std::string shareName = share.Share.value_or("");
+    const size_t slash = server.find('/');
+    if (slash != std::string::npos)
+    {
+        if (shareName.empty()) shareName = server.substr(slash + 1);
+        server = server.substr(0, slash);
+    }
+    std::replace(shareName.begin(), shareName.end(), '\\', '/');
+    while (!shareName.empty() && shareName.front() == '/') shareName.erase(0, 1);
+    while (!shareName.empty() && shareName.back() == '/') shareName.pop_back();
+
+    const std::string protocol = share.Protocol.empty() ? "smb" : share.Protocol;
+    return Lower(protocol + "|" + server + "|" + shareName + "|" + share.Username.value_or("") + "|" + share.Domain.value_or(""));
+}
+
+std::shared_future<MountOutcome> MountManager::Mount(const omnisphere::dtos::ConnectNetworkShare& share, bool retryNow, Callback callback)
+{
+    // A mount in flight is only joined with the same credentials: a caller bringing a
+    // corrected password must not inherit the outcome of the attempt with the stale one
+    const std::string key = KeyOf(share);
+    const uint64_t passwordHash = PasswordHash(share);
+    const std::string flightKey = key + "|" + std::to_string(passwordHash);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto flying = inFlight.find(flightKey);
+    if (flying != inFlight.end())
+    {
+        ++stats.Joined;
+        if (callback)
+            flying->second->Callbacks.push_back(std::move(callback));
+        return flying->second->Future;
+    }
+
+    auto failed = failures.find(key);
+    if (failed != failures.end() && !retryNow && Clock::now() < failed->second.RetryAt &&
+        failed->second.PasswordHash == passwordHash)
+    {
+        ++stats.NegativeHits;
+        const auto wait = std::chrono::duration_cast<std::chrono::seconds>(failed->second.RetryAt - Clock::now()).count() + 1;
+        MountOutcome outcome{"", failed->second.Error + " (not retried for " + std::to_string(wait) + " s)"};
+        lock.unlock();
+
+        std::promise<MountOutcome> ready;
+        ready.set_value(outcome);
+        if (callback)
+            callback(outcome);
+        return ready.get_future().share();
+    }
+
+    auto flight          = std::make_shared<Flight>();
+    flight->Share        = share;
+    flight->ShareKey     = key;
+    flight->PasswordHash = passwordHash;
+    flight->Future       = flight->Promise.get_future().share();
+    if (callback)
+        flight->Callbacks.push_back(std::move(callback));
+
+    inFlight.emplace(flightKey, flight);
+    queue.emplace_back(flightKey, flight);
+    ++stats.Started;
+    lock.unlock();
+    queueCv.notify_one();
+    return flight->Future;
+}
+
+void MountManager::Forget(const omnisphere::dtos::ConnectNetworkShare& share)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    failures.erase(KeyOf(share));
+}
+
+MountManagerStats MountManager::Stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    MountManagerStats result = stats;
+    result.InFlight = inFlight.size();
+    return result;
+}
+
+void MountManager::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        queueCv.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+            return;
+
+        auto [key, flight] = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        MountOutcome outcome;
+        try
+        {
+            outcome = runner(flight->Share);
+            if (!outcome.Ok() && outcome.Error.empty())
+                outcome.Error = "Failed to mount network share";
+        }
+        catch (const std::exception& e)
+        {
+            outcome.Error = e.what();
+        }
+        catch (...)
+        {
+            outcome.Error = "Failed to mount network share";
+        }
+
+        Complete(key, flight, outcome);
+        lock.lock();
+    }
+}
+
+void MountManager::Complete(const std::string& key, const std::shared_ptr<Flight>& flight, const MountOutcome& outcome)
+{
+    std::vector<Callback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight.erase(key);
+        callbacks.swap(flight->Callbacks);
+
+        if (outcome.Ok())
+        {
+            failures.erase(flight->ShareKey);
+        }
+        else
+        {
+            ++stats.Failures;
+            Failure& failure = failures[flight->ShareKey];
+            ++failure.Count;
+            const unsigned shift = std::min(failure.Count - 1, 16u);
+            const std::chrono::seconds backoff = std::min<std::chrono::seconds>(baseBackoff * (1 << shift), maxBackoff);
+            failure.RetryAt      = Clock::now() + backoff;
+            failure.Error        = outcome.Error;
+            failure.PasswordHash = flight->PasswordHash;
+        }
+    }
+
+    flight->Promise.set_value(outcome);
+    for (auto& callback : callbacks)
+    {
+        try
+        {
+            callback(outcome);
+        }
+        catch (...)
+        {
+            // A failing continuation must not take the mount thread down
+        }
+    }
+}
+
+} // namespace omnisphere::repositories
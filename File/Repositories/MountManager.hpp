@@ -0,0 +1,108 @@
+#pragma once
+#include "File/DTOs/ConnectNetworkShare.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    struct MountOutcome
+    {
+        std::string Uri;        // Display URI of the mounted share, empty on failure
+        std::string Error;
+
+        bool Ok() const { return !Uri.empty(); }
+    };
+
+    struct MountManagerStats
+    {
+        size_t Started = 0;         // Mount commands actually run
+        size_t Joined = 0;          // Requests that attached to a mount already in flight
+        size_t NegativeHits = 0;    // Requests answered from the failure cache
+        size_t Failures = 0;
+        size_t InFlight = 0;
+    };
+
+    // Runs share mounts on a few dedicated threads so callers are not tied up for the
+    // length of a `gio mount`. There is at most one mount in flight per (protocol,
+    // server, share, user, domain, password); later requests with the same credentials
+    // get the same shared future. A
+    // failed mount is remembered and answered immediately until its backoff expires
+    // (doubling per consecutive failure), unless retried with different credentials.
+    class MountManager
+    {
+    public:
+        using Runner   = std::function<MountOutcome(const omnisphere::dtos::ConnectNetworkShare&)>;
+        using Callback = std::function<void(const MountOutcome&)>;
+
+        explicit MountManager(Runner runner, size_t threads = 4,
+                              std::chrono::seconds baseBackoff = std::chrono::seconds(2),
+                              std::chrono::seconds maxBackoff = std::chrono::seconds(300));
+        ~MountManager();
+
+        MountManager(const MountManager&) = delete;
+        MountManager& operator=(const MountManager&) = delete;
+
+        // Starts or joins the mount of `share`. `retryNow` skips the failure cache (explicit
+        // connects). `callback`, if given, runs once the outcome is known: on a mount thread,
+        // or right here when the answer comes from the failure cache.
+        std::shared_future<MountOutcome> Mount(const omnisphere::dtos::ConnectNetworkShare& share,
+                                               bool retryNow = false, Callback callback = nullptr);
+
+        // Drop the remembered failure of `share`, if any
+        void Forget(const omnisphere::dtos::ConnectNetworkShare& share);
+
+        MountManagerStats Stats() const;
+
+        // "protocol|server|share|user|domain", lowercase
+        static std::string KeyOf(const omnisphere::dtos::ConnectNetworkShare& share);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Flight
+        {
+            omnisphere::dtos::ConnectNetworkShare Share;
+            std::string ShareKey;
+            uint64_t PasswordHash = 0;
+            std::promise<MountOutcome> Promise;
+            std::shared_future<MountOutcome> Future;
+            std::vector<Callback> Callbacks;
+        };
+
+        struct Failure
+        {
+            unsigned Count = 0;
+            Clock::time_point RetryAt;
+            std::string Error;
+            uint64_t PasswordHash = 0;
+        };
+
+        Runner runner;
+        std::chrono::seconds baseBackoff;
+        std::chrono::seconds maxBackoff;
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> inFlight;
+        std::unordered_map<std::string, Failure> failures;
+        std::deque<std::pair<std::string, std::shared_ptr<Flight>>> queue;
+        MountManagerStats stats;
+
+        std::condition_variable queueCv;
+        std::vector<std::thread> workers;
+        bool stopping = false;
+
+        void Run();
+        void Complete(const std::string& key, const std::shared_ptr<Flight>& flight, const MountOutcome& outcome);
+    };
+} // namespace omnisphere::repositories
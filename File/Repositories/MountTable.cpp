@@ -0,0 +1,279 @@
+#include "File/Repositories/MountTable.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+std::string Lower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+bool SameMounts(const MountTable::Snapshot& a, const MountTable::Snapshot& b)
+{
+    if (a.GvfsExists != b.GvfsExists || a.Mounts.size() != b.Mounts.size())
+        return false;
+    std::vector<std::string> left, right;
+    for (const auto& m : a.Mounts) left.push_back(m.Name);
+    for (const auto& m : b.Mounts) right.push_back(m.Name);
+    std::sort(left.begin(), left.end());
+    std::sort(right.begin(), right.end());
+    return left == right;
+}
+
+} // namespace
+
+MountTable::MountTable(std::string gvfsRoot, std::string mountInfoPath, size_t lruCapacity)
+    : gvfsRoot(std::move(gvfsRoot)), mountInfoPath(std::move(mountInfoPath)), lruCapacity(std::max<size_t>(lruCapacity, 1))
+{
+#ifdef __linux__
+    stopFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stopFd >= 0 && !this->gvfsRoot.empty())
+        watcher = std::thread([this] { Watch(); });
+#endif
+}
+
+MountTable::~MountTable()
+{
+#ifdef __linux__
+    if (stopFd >= 0)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(stopFd, &one, sizeof(one));
+    }
+    if (watcher.joinable())
+        watcher.join();
+    if (stopFd >= 0)
+        ::close(stopFd);
+#endif
+}
+
+MountTable& MountTable::Instance()
+{
+#ifndef _WIN32
+    static MountTable table("/run/user/" + std::to_string(getuid()) + "/gvfs");
+#else
+    static MountTable table("");
+#endif
+    return table;
+}
+
+MountTable::Mount MountTable::Parse(const std::string& name, const std::string& path)
+{
+    Mount mount;
+    mount.Name = Lower(name);
+    mount.Path = path;
+
+    const size_t colon = mount.Name.find(':');
+    std::string kind   = mount.Name.substr(0, colon);
+    const size_t dash  = kind.find('-');
+    mount.Protocol     = kind.substr(0, dash);
+
+    if (colon == std::string::npos)
+        return mount;
+
+    size_t pos = colon + 1;
+    while (pos < mount.Name.size())
+    {
+        size_t end = mount.Name.find(',', pos);
+        if (end == std::string::npos) end = mount.Name.size();
+        const std::string pair = mount.Name.substr(pos, end - pos);
+        const size_t eq = pair.find('=');
+        if (eq != std::string::npos)
+        {
+            const std::string key = pair.substr(0, eq);
+            const std::string val = pair.substr(eq + 1);
+            if (key == "server")     mount.Server = val;
+            else if (key == "share") mount.Share  = val;
+            else if (key == "user")  mount.User   = val;
+        }
+        pos = end + 1;
+    }
+    return mount;
+}
+
+std::shared_ptr<const MountTable::Snapshot> MountTable::Build() const
+{
+    auto snap = std::make_shared<Snapshot>();
+    snap->BuiltAt = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    if (gvfsRoot.empty() || !fs::is_directory(gvfsRoot, ec))
+        return snap;
+
+    snap->GvfsExists = true;
+    for (const auto& entry : fs::directory_iterator(gvfsRoot, ec))
+    {
+        snap->Mounts.push_back(Parse(entry.path().filename().string(), entry.path().string()));
+        const Mount& m = snap->Mounts.back();
+        const size_t idx = snap->Mounts.size() - 1;
+        if (!m.Server.empty())
+            snap->ByServerShare[m.Server + "/" + m.Share].push_back(idx);
+    }
+    return snap;
+}
+
+std::shared_ptr<const MountTable::Snapshot> MountTable::Current()
+{
+    // Taken before listing, so an invalidation that races the listing forces another one
+    const uint64_t gen = Generation();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const bool stale = !snapshot || snapshotGeneration != gen ||
+                           std::chrono::steady_clock::now() - snapshot->BuiltAt >= refreshInterval;
+        if (!stale)
+            return snapshot;
+    }
+
+    // Listing GVFS can block on gvfsd; Lookup and Remember must not wait behind it
+    std::shared_ptr<const Snapshot> built = Build();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // A concurrent caller may have installed a newer listing meanwhile
+    if (!snapshot || snapshot->BuiltAt < built->BuiltAt)
+    {
+        const bool changed = snapshot && !SameMounts(*snapshot, *built);
+        snapshot = std::move(built);
+        snapshotGeneration = gen;
+        // A share mounted or unmounted behind the watch's back: resolutions made against
+        // the old listing may point at a share that is gone or miss one that is back. If
+        // the generation moved during the listing they are dropped already.
+        uint64_t expected = gen;
+        if (changed && generation.compare_exchange_strong(expected, gen + 1, std::memory_order_acq_rel))
+            snapshotGeneration = gen + 1;
+    }
+    return snapshot;
+}
+
+std::optional<std::string> MountTable::Lookup(const std::string& rawPath)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    // An old table may hide a share that changed; the caller resolves through Current()
+    const auto now = std::chrono::steady_clock::now();
+    if (!snapshot || now - snapshot->BuiltAt >= refreshInterval)
+        return std::nullopt;
+    auto it = lruIndex.find(rawPath);
+    if (it == lruIndex.end())
+        return std::nullopt;
+
+    const CacheEntry& entry = *it->second;
+    if (entry.Generation != Generation() || now - entry.StoredAt >= entryTtl)
+    {
+        lru.erase(it->second);
+        lruIndex.erase(it);
+        return std::nullopt;
+    }
+
+    lru.splice(lru.begin(), lru, it->second);
+    return entry.Resolved;
+}
+
+void MountTable::Remember(const std::string& rawPath, const std::string& resolved)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = lruIndex.find(rawPath);
+    if (it != lruIndex.end())
+    {
+        lru.erase(it->second);
+        lruIndex.erase(it);
+    }
+
+    lru.push_front(CacheEntry{rawPath, resolved, Generation(), std::chrono::steady_clock::now()});
+    lruIndex[rawPath] = lru.begin();
+
+    while (lru.size() > lruCapacity)
+    {
+        lruIndex.erase(lru.back().Key);
+        lru.pop_back();
+    }
+}
+
+void MountTable::Invalidate()
+{
+    generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void MountTable::Watch()
+{
+#ifdef __linux__
+    const int inFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // The kernel flags mountinfo with POLLPRI whenever the mount namespace changes
+    const int mountFd = ::open(mountInfoPath.c_str(), O_RDONLY | O_CLOEXEC);
+    int wd = -1;
+    alignas(inotify_event) char buffer[4096];
+
+    auto drainMountInfo = [&]
+    {
+        ::lseek(mountFd, 0, SEEK_SET);
+        while (::read(mountFd, buffer, sizeof(buffer)) > 0) {}
+    };
+    if (mountFd >= 0)
+        drainMountInfo();
+
+    for (;;)
+    {
+        if (inFd >= 0 && wd < 0)
+        {
+            wd = ::inotify_add_watch(inFd, gvfsRoot.c_str(),
+                                     IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+            if (wd >= 0)
+                Invalidate();
+        }
+
+        pollfd fds[3] = {{stopFd, POLLIN, 0}, {inFd, POLLIN, 0}, {mountFd, POLLPRI, 0}};
+        const int rc = ::poll(fds, 3, static_cast<int>(std::chrono::milliseconds(refreshInterval).count()));
+        if (rc < 0 && errno != EINTR)
+            break;
+        if (fds[0].revents)
+            break;
+
+        if (fds[1].revents & POLLIN)
+        {
+            ssize_t n;
+            while ((n = ::read(inFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (ssize_t off = 0; off < n;)
+                {
+                    const auto* ev = reinterpret_cast<const inotify_event*>(buffer + off);
+                    // The GVFS directory went away (logout, gvfsd restart): re-arm on the next pass
+                    if (ev->mask & IN_IGNORED)
+                        wd = -1;
+                    off += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+                }
+            }
+            Invalidate();
+        }
+
+        if (fds[2].revents & (POLLPRI | POLLERR))
+        {
+            drainMountInfo();
+            Invalidate();
+        }
+    }
+
+    if (inFd >= 0) ::close(inFd);
+    if (mountFd >= 0) ::close(mountFd);
+#endif
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    // Parsed view of the GVFS mount directory plus an LRU of resolved network paths.
+    // The table is listed again when it is older than refreshInterval; a listing that
+    // differs from the previous one bumps the generation, which drops every cached
+    // resolution. A background thread watches the GVFS directory with inotify and polls
+    // /proc/self/mountinfo, and bumps the generation on a change so it is seen sooner.
+    class MountTable
+    {
+    public:
+        // One entry of the GVFS directory, e.g. "smb-share:server=nas,share=docs,user=bob".
+        // Protocol, Server, Share and User are lowercase; Name is lowercase as well.
+        struct Mount
+        {
+            std::string Protocol;
+            std::string Server;
+            std::string Share;
+            std::string User;
+            std::string Name;
+            std::string Path;
+        };
+
+        struct Snapshot
+        {
+            bool GvfsExists = false;
+            std::vector<Mount> Mounts;
+            std::unordered_map<std::string, std::vector<size_t>> ByServerShare;   // "server/share"
+            std::chrono::steady_clock::time_point BuiltAt;
+        };
+
+        MountTable(std::string gvfsRoot, std::string mountInfoPath = "/proc/self/mountinfo", size_t lruCapacity = 1024);
+        ~MountTable();
+
+        MountTable(const MountTable&) = delete;
+        MountTable& operator=(const MountTable&) = delete;
+
+        // Table for the current user's /run/user/<uid>/gvfs
+        static MountTable& Instance();
+
+        const std::string& GvfsRoot() const { return gvfsRoot; }
+
+        // Current table, rebuilt first if something changed since the last call
+        std::shared_ptr<const Snapshot> Current();
+
+        std::optional<std::string> Lookup(const std::string& rawPath);
+        void Remember(const std::string& rawPath, const std::string& resolved);
+
+        // Forget everything; used after mounting so the new share is seen right away
+        void Invalidate();
+
+        uint64_t Generation() const { return generation.load(std::memory_order_acquire); }
+
+        static Mount Parse(const std::string& name, const std::string& path);
+
+    private:
+        struct CacheEntry
+        {
+            std::string Key;
+            std::string Resolved;
+            uint64_t Generation;
+            std::chrono::steady_clock::time_point StoredAt;
+        };
+
+        // Cached resolutions also expire on their own: the watch only sees the top of the
+        // GVFS directory, not folders disappearing inside a share.
+        static constexpr std::chrono::seconds entryTtl{30};
+        // The table is listed again when older than this, watch or not: GVFS shares are not
+        // kernel mounts, and the FUSE root raises no inotify events for shares mounted or
+        // unmounted by other processes
+        static constexpr std::chrono::seconds refreshInterval{2};
+
+        std::string gvfsRoot;
+        std::string mountInfoPath;
+        size_t lruCapacity;
+
+        std::atomic<uint64_t> generation{1};
+
+        std::mutex mutex;
+        std::shared_ptr<const Snapshot> snapshot;
+        uint64_t snapshotGeneration = 0;
+        std::list<CacheEntry> lru;
+        std::unordered_map<std::string, std::list<CacheEntry>::iterator> lruIndex;
+
+        int stopFd = -1;
+        std::thread watcher;
+
+        std::shared_ptr<const Snapshot> Build() const;
+        void Watch();
+    };
+} // namespace omnisphere::repositories
@@ -0,0 +1,170 @@
+#include "File/Repositories/PermissionProbe.hpp"
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include "File/Repositories/File.hpp"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+constexpr size_t maxEntries = 4096;    // Expired entries are swept once the cache grows past this
+
+// Unique per process and call, so two callers probing one directory never trip over
+// each other's probe file
+std::string ProbeName()
+{
+    static std::atomic<uint64_t> counter{0};
+    static const uint64_t salt = std::random_device{}();
+#ifdef _WIN32
+    const uint64_t pid = 0;
+#else
+    const uint64_t pid = static_cast<uint64_t>(::getpid());
+#endif
+    return ".omni_perm_check-" + std::to_string(pid) + "-" + std::to_string(salt) + "-" + std::to_string(counter++) + ".tmp";
+}
+
+bool CanCreateProbe(const std::string& directory)
+{
+    const std::string probe = (fs::path(directory) / ProbeName()).string();
+#ifndef _WIN32
+    const int fd = ::open(probe.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+    ::close(fd);
+    ::unlink(probe.c_str());
+    return true;
+#else
+    bool created = false;
+    {
+        std::ofstream ofs(probe, std::ios::trunc | std::ios::binary);
+        created = ofs.good();
+    }
+    std::error_code ec;
+    if (created)
+        fs::remove(probe, ec);
+    return created;
+#endif
+}
+
+} // namespace
+
+PermissionProbe::PermissionProbe(std::chrono::seconds ttl) : ttl(ttl)
+{
+}
+
+PermissionProbe& PermissionProbe::Instance()
+{
+    static PermissionProbe probe;
+    return probe;
+}
+
+omnisphere::models::DirectoryPermissions PermissionProbe::Probe(const std::string& directory)
+{
+    omnisphere::models::DirectoryPermissions result;
+    result.Path           = directory;
+    result.HasReadAccess  = false;
+    result.HasWriteAccess = false;
+    result.Method         = "none";
+
+    std::error_code ec;
+    if (!fs::is_directory(directory, ec))
+        return result;
+
+#ifndef _WIN32
+    if (File::IsLocalFileSystem(directory))
+    {
+        // Listing needs read and search permission, creating a file write and search
+        result.Method         = "access";
+        result.HasReadAccess  = ::faccessat(AT_FDCWD, directory.c_str(), R_OK | X_OK, AT_EACCESS) == 0;
+        result.HasWriteAccess = ::faccessat(AT_FDCWD, directory.c_str(), W_OK | X_OK, AT_EACCESS) == 0;
+        return result;
+    }
+#endif
+
+    result.Method = "probe";
+    DirectoryEnumerator dir(directory);
+    DirectoryEntry entry;
+    result.HasReadAccess  = dir.IsOpen();
+    if (result.HasReadAccess)
+        dir.Next(entry);
+    result.HasWriteAccess = CanCreateProbe(directory);
+    return result;
+}
+
+omnisphere::models::DirectoryPermissions PermissionProbe::Check(const std::string& directory, bool forceRefresh)
+{
+    std::shared_future<omnisphere::models::DirectoryPermissions> pending;
+    std::promise<omnisphere::models::DirectoryPermissions> mine;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto cached = entries.find(directory);
+        if (!forceRefresh && cached != entries.end() && Clock::now() - cached->second.CheckedAt < ttl)
+        {
+            omnisphere::models::DirectoryPermissions result = cached->second.Result;
+            result.Cached = true;
+            return result;
+        }
+
+        auto flying = inFlight.find(directory);
+        if (flying != inFlight.end())
+        {
+            pending = flying->second;
+        }
+        else
+        {
+            inFlight.emplace(directory, mine.get_future().share());
+        }
+    }
+    if (pending.valid())
+        return pending.get();
+
+    omnisphere::models::DirectoryPermissions result;
+    try
+    {
+        result = Probe(directory);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight.erase(directory);
+        mine.set_exception(std::current_exception());
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight.erase(directory);
+        if (result.Method != "none")
+            entries[directory] = Entry{result, Clock::now()};
+        if (entries.size() > maxEntries)
+        {
+            const auto now = Clock::now();
+            for (auto it = entries.begin(); it != entries.end();)
+                it = now - it->second.CheckedAt >= ttl ? entries.erase(it) : std::next(it);
+        }
+    }
+    mine.set_value(result);
+    return result;
+}
+
+void PermissionProbe::Invalidate(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.erase(directory);
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,49 @@
+#pragma once
+#include "File/Models/DirectoryPermissions.hpp"
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace omnisphere::repositories
+{
+    // Read/write permission checks for directories, cached per resolved path for a TTL.
+    // On local filesystems the kernel is asked with faccessat(AT_EACCESS), which honours
+    // ACLs and read-only mounts without touching the disk. Network mounts (SMB, NFS, GVFS)
+    // report modes that need not match what the server allows, so there the directory is
+    // opened and read, and a uniquely named probe file is created and removed. Concurrent
+    // checks of one directory share a single probe.
+    class PermissionProbe
+    {
+    public:
+        explicit PermissionProbe(std::chrono::seconds ttl = std::chrono::seconds(30));
+
+        PermissionProbe(const PermissionProbe&) = delete;
+        PermissionProbe& operator=(const PermissionProbe&) = delete;
+
+        static PermissionProbe& Instance();
+
+        // Path of the result is left to the caller
+        omnisphere::models::DirectoryPermissions Check(const std::string& directory, bool forceRefresh);
+
+        void Invalidate(const std::string& directory);
+
+        // The uncached check
+        static omnisphere::models::DirectoryPermissions Probe(const std::string& directory);
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            omnisphere::models::DirectoryPermissions Result;
+            Clock::time_point CheckedAt;
+        };
+
+        std::chrono::seconds ttl;
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        std::unordered_map<std::string, std::shared_future<omnisphere::models::DirectoryPermissions>> inFlight;
+    };
+} // namespace omnisphere::repositories
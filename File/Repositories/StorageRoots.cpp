@@ -0,0 +1,300 @@
+#include "File/Repositories/StorageRoots.hpp"
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include "File/Repositories/File.hpp"
+#include "File/Repositories/WorkStealingPool.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+int64_t NowUnixMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool IsNetworkPath(const std::string& path)
+{
+    return path.rfind("smb:", 0) == 0 || path.rfind("nfs:", 0) == 0 || path.rfind("\\\\", 0) == 0;
+}
+
+struct ProbeResult
+{
+    bool Alive = false;
+    bool Remounted = false;
+    std::string Resolved;
+    std::string Error;
+    double LatencyMs = 0;
+};
+
+// errno of opening the directory and reading its first entry, 0 when both worked
+int ReadError(const std::string& directory)
+{
+    DirectoryEnumerator dir(directory);
+    DirectoryEntry entry;
+    if (dir.IsOpen())
+        dir.Next(entry);    // An empty root is fine; the point is one round trip to the server
+    return dir.Error();
+}
+
+// Errors of a mount whose server or session is gone, as opposed to a directory that is
+// merely not readable (EACCES, ENOENT), which a remount would not fix
+bool DeadMount(int error)
+{
+    switch (error)
+    {
+    case ENOTCONN:
+    case EIO:
+    case ETIMEDOUT:
+#ifdef EHOSTDOWN
+    case EHOSTDOWN:
+#endif
+#ifdef ESTALE
+    case ESTALE:
+#endif
+        return true;
+    default:
+        return false;
+    }
+}
+
+ProbeResult Probe(const std::string& path, bool mayRemount)
+{
+    const auto started = Clock::now();
+    const File repo;
+    ProbeResult result;
+
+    result.Resolved = repo.ResolveOrMount(path);
+    int error = result.Resolved.empty() ? 0 : ReadError(result.Resolved);
+    if (error != 0 && mayRemount && DeadMount(error) && IsNetworkPath(path))
+    {
+        // Resolved but dead: a GVFS mount whose server dropped the session keeps its directory
+        result.Resolved  = repo.Remount(path);
+        result.Remounted = true;
+        error = result.Resolved.empty() ? 0 : ReadError(result.Resolved);
+    }
+
+    if (result.Resolved.empty())
+        result.Error = "Could not resolve or mount " + path;
+    else if (error != 0)
+        result.Error = "Directory is not readable: " + result.Resolved + ": " + std::strerror(error);
+    else
+        result.Alive = true;
+
+    result.LatencyMs = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    return result;
+}
+
+} // namespace
+
+struct StorageRoots::State
+{
+    struct Root
+    {
+        omnisphere::models::StorageRootStatus Status;
+        uint64_t Generation = 0;        // Bumped when the path changes; late probe results are dropped
+        bool Probing = false;
+        bool TimedOut = false;
+        Clock::time_point ProbeStarted;
+        Clock::time_point NextProbe;
+        unsigned RemountFailures = 0;   // Remounts in a row that left the root down
+        Clock::time_point RemountAt;    // No remount before this
+    };
+
+    // Remounts that do not bring a root back are spaced out, doubling from RetryInterval
+    static constexpr std::chrono::seconds maxRemountBackoff{300};
+
+    std::chrono::seconds ProbeInterval;
+    std::chrono::seconds RetryInterval;
+    std::chrono::seconds ProbeTimeout;
+
+    mutable std::mutex Mutex;
+    mutable std::condition_variable Changed;
+    std::map<std::string, Root> Roots;
+    uint64_t NextGeneration = 1;
+    bool Stopping = false;
+
+    static void StartProbeLocked(const std::shared_ptr<State>& self, const std::string& name, Root& root)
+    {
+        root.Probing      = true;
+        root.TimedOut     = false;
+        root.ProbeStarted = Clock::now();
+
+        const uint64_t generation = root.Generation;
+        const std::string path    = root.Status.Path;
+        const bool mayRemount     = root.ProbeStarted >= root.RemountAt;
+        WorkStealingPool::Instance().Submit([self, name, generation, path, mayRemount]
+        {
+            ProbeResult result;
+            try
+            {
+                result = Probe(path, mayRemount);
+            }
+            catch (const std::exception& e)
+            {
+                result.Error = e.what();
+            }
+            self->Finish(name, generation, result);
+        });
+    }
+
+    void Finish(const std::string& name, uint64_t generation, const ProbeResult& result)
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        auto it = Roots.find(name);
+        if (it == Roots.end() || it->second.Generation != generation)
+            return;
+
+        Root& root = it->second;
+        auto& status = root.Status;
+        root.Probing   = false;
+        root.NextProbe = Clock::now() + (result.Alive ? ProbeInterval : RetryInterval);
+
+        ++status.Probes;
+        status.LastProbeAt   = NowUnixMs();
+        status.LastLatencyMs = result.LatencyMs;
+        status.MaxLatencyMs  = std::max(status.MaxLatencyMs, result.LatencyMs);
+        if (result.Remounted)
+        {
+            ++status.Remounts;
+            if (result.Alive)
+            {
+                root.RemountFailures = 0;
+            }
+            else
+            {
+                const unsigned shift = std::min(root.RemountFailures++, 16u);
+                root.RemountAt = Clock::now() + std::min<std::chrono::seconds>(RetryInterval * (1 << shift), maxRemountBackoff);
+            }
+        }
+        else if (result.Alive)
+        {
+            root.RemountFailures = 0;
+        }
+        if (!result.Resolved.empty())
+            status.ResolvedPath = result.Resolved;
+
+        if (result.Alive)
+        {
+            status.AvgLatencyMs = status.AvgLatencyMs == 0 ? result.LatencyMs : 0.8 * status.AvgLatencyMs + 0.2 * result.LatencyMs;
+            status.Alive        = true;
+            status.LastAliveAt  = status.LastProbeAt;
+            status.LastError.reset();
+        }
+        else
+        {
+            if (!root.TimedOut)
+                ++status.Failures;
+            status.Alive     = false;
+            status.LastError = result.Error;
+        }
+        Changed.notify_all();
+    }
+
+    void Schedule(const std::shared_ptr<State>& self)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        while (!Stopping)
+        {
+            const auto now = Clock::now();
+            auto wake = now + ProbeInterval;
+            for (auto& [name, root] : Roots)
+            {
+                if (!root.Probing && now >= root.NextProbe)
+                    StartProbeLocked(self, name, root);
+
+                if (root.Probing && !root.TimedOut && now - root.ProbeStarted >= ProbeTimeout)
+                {
+                    // Calls into a hung mount do not return; report it down while the probe is stuck
+                    root.TimedOut            = true;
+                    root.Status.Alive        = false;
+                    root.Status.LastError    = "Probe timed out";
+                    root.Status.LastProbeAt  = NowUnixMs();
+                    ++root.Status.Failures;
+                    Changed.notify_all();
+                }
+
+                wake = std::min(wake, root.Probing ? root.ProbeStarted + ProbeTimeout : root.NextProbe);
+            }
+            Changed.wait_until(lock, std::max(wake, now + std::chrono::milliseconds(50)));
+        }
+    }
+};
+
+StorageRoots::StorageRoots(std::chrono::seconds probeInterval, std::chrono::seconds retryInterval, std::chrono::seconds probeTimeout)
+    : state(std::make_shared<State>())
+{
+    state->ProbeInterval = probeInterval;
+    state->RetryInterval = std::min(retryInterval, probeInterval);
+    state->ProbeTimeout  = probeTimeout;
+    scheduler = std::thread([s = state] { s->Schedule(s); });
+}
+
+StorageRoots::~StorageRoots()
+{
+    {
+        std::lock_guard<std::mutex> lock(state->Mutex);
+        state->Stopping = true;
+    }
+    state->Changed.notify_all();
+    scheduler.join();
+}
+
+StorageRoots& StorageRoots::Instance()
+{
+    static StorageRoots roots;
+    return roots;
+}
+
+void StorageRoots::Set(const std::string& name, const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(state->Mutex);
+    auto it = state->Roots.find(name);
+    if (path.empty())
+    {
+        if (it != state->Roots.end())
+            state->Roots.erase(it);
+        return;
+    }
+    if (it != state->Roots.end() && it->second.Status.Path == path)
+        return;
+
+    State::Root& root = state->Roots[name];
+    root = State::Root{};
+    root.Status.Name = name;
+    root.Status.Path = path;
+    root.Generation  = state->NextGeneration++;
+    State::StartProbeLocked(state, name, root);
+    state->Changed.notify_all();
+}
+
+std::vector<omnisphere::models::StorageRootStatus> StorageRoots::Status() const
+{
+    std::lock_guard<std::mutex> lock(state->Mutex);
+    std::vector<omnisphere::models::StorageRootStatus> result;
+    result.reserve(state->Roots.size());
+    for (const auto& [name, root] : state->Roots)
+        result.push_back(root.Status);
+    return result;
+}
+
+bool StorageRoots::WaitForFirstProbe(std::chrono::milliseconds timeout) const
+{
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    return state->Changed.wait_for(lock, timeout, [this]
+    {
+        return std::all_of(state->Roots.begin(), state->Roots.end(),
+                           [](const auto& entry) { return entry.second.Status.LastProbeAt.has_value(); });
+    });
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,46 @@
+#pragma once
+#include "File/Models/StorageRootStatus.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    // Keeps the configured storage roots (ImagePath, PDFPath, XMLPath) resolved, mounted and
+    // warm. Setting a root starts its first probe right away on the shared pool, so all roots
+    // resolve and mount in parallel at startup instead of on the first user request. After
+    // that a background thread probes each root every probeInterval (retryInterval while it
+    // is down). A probe resolves the path, mounting the share through the MountManager when
+    // it is gone, and reads the first entry of the directory; a mounted share that fails with
+    // ENOTCONN, EIO, ETIMEDOUT, EHOSTDOWN or ESTALE is unmounted and mounted again before users
+    // run into it, with exponential backoff between remounts that do not help.
+    class StorageRoots
+    {
+    public:
+        StorageRoots(std::chrono::seconds probeInterval = std::chrono::seconds(15),
+                     std::chrono::seconds retryInterval = std::chrono::seconds(3),
+                     std::chrono::seconds probeTimeout = std::chrono::seconds(10));
+        ~StorageRoots();
+
+        StorageRoots(const StorageRoots&) = delete;
+        StorageRoots& operator=(const StorageRoots&) = delete;
+
+        static StorageRoots& Instance();
+
+        // Add, change or (with an empty path) remove one root
+        void Set(const std::string& name, const std::string& path);
+
+        std::vector<omnisphere::models::StorageRootStatus> Status() const;
+
+        // Wait until every root has finished its first probe, or the timeout passes
+        bool WaitForFirstProbe(std::chrono::milliseconds timeout) const;
+
+    private:
+        // Shared with in-flight probes so one that hangs on a dead mount cannot outlive it
+        struct State;
+        std::shared_ptr<State> state;
+        std::thread scheduler;
+    };
+} // namespace omnisphere::repositories
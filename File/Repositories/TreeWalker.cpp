@@ -0,0 +1,248 @@
+#include "File/Repositories/TreeWalker.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+using omnisphere::enums::FileType;
+
+struct Job
+{
+    std::string Path;
+    std::string RelativePath;
+    int Depth = 0;
+    uint64_t GateKey = 0;       // Device of the parent directory; 0 for the root
+};
+
+// Mount slots: at most Limit directories of one device are listed at a time, the rest wait here
+struct Gate
+{
+    size_t Limit = 0;
+    size_t Active = 0;
+    std::deque<Job> Waiting;
+};
+
+struct WalkState
+{
+    WorkStealingPool& Pool;
+    TreeWalkOptions Options;
+    TreeWalker::Sink Sink;
+
+    std::atomic<size_t> Outstanding{0};
+    std::atomic<bool> Stop{false};
+
+    std::mutex GateMutex;
+    std::unordered_map<uint64_t, Gate> Gates;
+    std::set<std::pair<uint64_t, uint64_t>> Visited;
+
+    std::mutex SinkMutex;
+    TreeWalkResult Result;
+    std::exception_ptr Error;
+
+    std::mutex DoneMutex;
+    std::condition_variable DoneCv;
+
+    WalkState(WorkStealingPool& pool, const TreeWalkOptions& options, const TreeWalker::Sink& sink)
+        : Pool(pool), Options(options), Sink(sink) {}
+};
+
+void Process(const std::shared_ptr<WalkState>& state, const Job& job);
+
+void Finish(const std::shared_ptr<WalkState>& state)
+{
+    if (state->Outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard<std::mutex> lock(state->DoneMutex);
+        state->DoneCv.notify_all();
+    }
+}
+
+size_t LimitFor(const std::shared_ptr<WalkState>& state, const std::string& directory)
+{
+    return state->Options.MountLimit ? state->Options.MountLimit(directory) : 0;
+}
+
+void EnsureGate(const std::shared_ptr<WalkState>& state, uint64_t key, const std::string& directory)
+{
+    {
+        std::lock_guard<std::mutex> lock(state->GateMutex);
+        if (state->Gates.count(key))
+            return;
+    }
+    // The limit callback may touch the filesystem (statfs), keep it outside the lock
+    const size_t limit = LimitFor(state, directory);
+    std::lock_guard<std::mutex> lock(state->GateMutex);
+    state->Gates.try_emplace(key).first->second.Limit = limit;
+}
+
+void Submit(const std::shared_ptr<WalkState>& state, Job job)
+{
+    state->Pool.Submit([state, job = std::move(job)] { Process(state, job); });
+}
+
+// Caller has already counted the job in Outstanding
+void Enqueue(const std::shared_ptr<WalkState>& state, Job job)
+{
+    std::unique_lock<std::mutex> lock(state->GateMutex);
+    Gate& gate = state->Gates[job.GateKey];
+    if (gate.Limit != 0 && gate.Active >= gate.Limit)
+    {
+        gate.Waiting.push_back(std::move(job));
+        return;
+    }
+    ++gate.Active;
+    lock.unlock();
+    Submit(state, std::move(job));
+}
+
+// Hand the slot to the next waiting directory of the same mount, or give it back
+void Release(const std::shared_ptr<WalkState>& state, uint64_t key)
+{
+    std::unique_lock<std::mutex> lock(state->GateMutex);
+    Gate& gate = state->Gates[key];
+    if (gate.Waiting.empty())
+    {
+        --gate.Active;
+        return;
+    }
+    Job next = std::move(gate.Waiting.front());
+    gate.Waiting.pop_front();
+    lock.unlock();
+    Submit(state, std::move(next));
+}
+
+void Emit(const std::shared_ptr<WalkState>& state, TreeWalkDirectory&& directory)
+{
+    std::lock_guard<std::mutex> lock(state->SinkMutex);
+    if (state->Stop.load(std::memory_order_relaxed))
+        return;
+
+    TreeWalkResult& result = state->Result;
+    ++result.Directories;
+    if (!directory.Readable)
+        ++result.Unreadable;
+    result.Files += directory.FileCount;
+    result.Bytes += directory.TotalBytes;
+
+    try
+    {
+        if (!state->Sink(std::move(directory)))
+        {
+            result.Cancelled = true;
+            state->Stop = true;
+        }
+    }
+    catch (...)
+    {
+        state->Error = std::current_exception();
+        state->Stop  = true;
+    }
+}
+
+void List(const std::shared_ptr<WalkState>& state, const Job& job)
+{
+    const TreeWalkOptions& options = state->Options;
+    DirectoryEnumerator dir(job.Path, options.WithMetadata || options.Aggregates);
+
+    TreeWalkDirectory out;
+    out.Path         = job.Path;
+    out.RelativePath = job.RelativePath;
+    out.Depth        = job.Depth;
+    out.Readable     = dir.IsOpen();
+
+    uint64_t device = job.GateKey, inode = 0;
+    if (dir.IsOpen() && dir.Identity(device, inode, &out.ModifiedNs))
+    {
+        std::unique_lock<std::mutex> lock(state->GateMutex);
+        if (!state->Visited.emplace(device, inode).second)
+            return;     // Reached again through a symlink
+        const bool newMount = !state->Gates.count(device);
+        lock.unlock();
+        if (newMount)
+            EnsureGate(state, device, job.Path);
+    }
+
+    const bool descend = job.Depth < options.MaxDepth;
+    DirectoryEntry entry;
+    while (dir.IsOpen() && dir.Next(entry))
+    {
+        if (options.SkipHidden && entry.Name[0] == '.')
+            continue;
+
+        if (entry.Type == FileType::Directory && descend && !state->Stop.load(std::memory_order_relaxed))
+        {
+            Job child;
+            child.Path         = job.Path + (job.Path.empty() || job.Path.back() == '/' ? "" : "/") + entry.Name;
+            child.RelativePath = job.RelativePath.empty() ? entry.Name : job.RelativePath + "/" + entry.Name;
+            child.Depth        = job.Depth + 1;
+            child.GateKey      = device;
+            state->Outstanding.fetch_add(1, std::memory_order_relaxed);
+            Enqueue(state, std::move(child));
+        }
+
+        if (options.Aggregates && entry.Type == FileType::File)
+        {
+            ++out.FileCount;
+            out.TotalBytes += entry.Size.value_or(0);
+        }
+
+        if (!options.Filter || options.Filter(entry))
+            out.Entries.push_back(std::move(entry));
+    }
+
+    Emit(state, std::move(out));
+}
+
+void Process(const std::shared_ptr<WalkState>& state, const Job& job)
+{
+    if (!state->Stop.load(std::memory_order_relaxed))
+        List(state, job);
+    Release(state, job.GateKey);
+    Finish(state);
+}
+
+} // namespace
+
+TreeWalker::TreeWalker(WorkStealingPool& pool)
+    : pool(pool)
+{
+}
+
+TreeWalkResult TreeWalker::Walk(const std::string& root, const TreeWalkOptions& options, const Sink& sink)
+{
+    auto state = std::make_shared<WalkState>(pool, options, sink);
+
+    Job job;
+    job.Path = root;
+    EnsureGate(state, 0, root);
+    state->Outstanding = 1;
+    Enqueue(state, std::move(job));
+
+    while (state->Outstanding.load(std::memory_order_acquire) != 0)
+    {
+        if (pool.TryRunOne())
+            continue;
+        std::unique_lock<std::mutex> lock(state->DoneMutex);
+        state->DoneCv.wait_for(lock, std::chrono::milliseconds(5),
+                               [&] { return state->Outstanding.load(std::memory_order_acquire) == 0; });
+    }
+
+    std::lock_guard<std::mutex> lock(state->SinkMutex);
+    if (state->Error)
+        std::rethrow_exception(state->Error);
+    return state->Result;
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,70 @@
+#pragma once
+#include "File/Repositories/DirectoryEnumerator.hpp"
+#include "File/Repositories/WorkStealingPool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    struct TreeWalkOptions
+    {
+        int MaxDepth = 0;                   // 0 lists only the root, 1 its children, ...
+        bool WithMetadata = false;          // statx every entry (size and mtime)
+        bool Aggregates = false;            // Count the files and bytes of each directory
+        bool SkipHidden = true;             // Dot entries are neither reported nor descended into
+
+        // Which entries are reported; directories are descended into whether reported or not
+        std::function<bool(const DirectoryEntry&)> Filter;
+
+        // Directories of one mount listed at the same time; 0 means no limit. Asked once per
+        // mount (device) the walk enters, with the first directory seen on it.
+        std::function<size_t(const std::string& directory)> MountLimit;
+    };
+
+    // One listed directory. RelativePath is "" for the root and uses '/' separators.
+    struct TreeWalkDirectory
+    {
+        std::string Path;
+        std::string RelativePath;
+        int Depth = 0;
+        bool Readable = true;
+        int64_t ModifiedNs = -1;            // mtime of the directory when it was opened, -1 if unknown
+        std::vector<DirectoryEntry> Entries;
+        uint64_t FileCount = 0;             // Regular files directly inside, with Aggregates
+        uint64_t TotalBytes = 0;
+    };
+
+    struct TreeWalkResult
+    {
+        uint64_t Directories = 0;
+        uint64_t Unreadable = 0;
+        uint64_t Files = 0;
+        uint64_t Bytes = 0;                 // Only counted with Aggregates
+        bool Cancelled = false;
+    };
+
+    // Lists a directory tree on a work-stealing pool. Each directory is one task; children
+    // are pushed to the worker's own deque and idle workers steal the shallowest pending
+    // ones, so wide and deep trees both spread. Directories waiting for a mount slot are
+    // parked per mount rather than blocking a worker. Symlinked directories are followed
+    // once: a (device, inode) set stops cycles.
+    class TreeWalker
+    {
+    public:
+        // Invoked for every directory, serialised (never concurrently). Returning false stops the walk.
+        using Sink = std::function<bool(TreeWalkDirectory&&)>;
+
+        explicit TreeWalker(WorkStealingPool& pool = WorkStealingPool::Instance());
+
+        // Blocks until the walk finishes; the calling thread helps run pool tasks meanwhile.
+        // An exception thrown by the sink stops the walk and is rethrown here.
+        TreeWalkResult Walk(const std::string& root, const TreeWalkOptions& options, const Sink& sink);
+
+    private:
+        WorkStealingPool& pool;
+    };
+} // namespace omnisphere::repositories
@@ -0,0 +1,583 @@
+#include "File/Repositories/UploadSessions.hpp"
+#include "File/Repositories/AtomicFile.hpp"
+#include "File/Repositories/ContentHash.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+constexpr const char* stateSuffix = ".upload";
+
+std::string DefaultDirectory()
+{
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    return base ? std::string(base) + "\\OmniSphere\\uploads" : "OmniSphere\\uploads";
+#else
+    if (const char* xdg = std::getenv("XDG_STATE_HOME"); xdg && *xdg)
+        return std::string(xdg) + "/omnisphere/uploads";
+    const char* home = std::getenv("HOME");
+    return std::string(home ? home : "/tmp") + "/.local/state/omnisphere/uploads";
+#endif
+}
+
+std::string ErrnoMessage(const std::string& what, const std::string& path)
+{
+    return what + ": " + path + " (" + std::strerror(errno) + ")";
+}
+
+int64_t NowUnixMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string NewId()
+{
+    unsigned char bytes[16];
+    randombytes_buf(bytes, sizeof(bytes));
+    char hex[sizeof(bytes) * 2 + 1];
+    sodium_bin2hex(hex, sizeof(hex), bytes, sizeof(bytes));
+    return hex;
+}
+
+// State file values are one line each; names and paths may contain anything, so '%',
+// CR and LF are written as %XX
+std::string EscapeValue(const std::string& value)
+{
+    static constexpr char hex[] = "0123456789ABCDEF";
+    std::string out;
+    out.reserve(value.size());
+    for (const char c : value)
+    {
+        if (c == '%' || c == '\n' || c == '\r')
+        {
+            out += '%';
+            out += hex[static_cast<unsigned char>(c) >> 4];
+            out += hex[static_cast<unsigned char>(c) & 0xF];
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string UnescapeValue(const std::string& value)
+{
+    std::string out;
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        if (value[i] == '%' && i + 2 < value.size() && std::isxdigit(static_cast<unsigned char>(value[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(value[i + 2])))
+        {
+            out += static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+        {
+            out += value[i];
+        }
+    }
+    return out;
+}
+
+// Positioned I/O on the temp file
+
+int OpenData(const std::string& path, bool create)
+{
+#ifdef _WIN32
+    const int flags = _O_RDWR | _O_BINARY | (create ? _O_CREAT | _O_EXCL : 0);
+    return ::_open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    const int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0);
+    return ::open(path.c_str(), flags, 0666);
+#endif
+}
+
+void CloseData(int& fd)
+{
+    if (fd < 0)
+        return;
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+    fd = -1;
+}
+
+void WriteAt(int fd, uint64_t offset, const unsigned char* data, size_t size, const std::string& path)
+{
+#ifdef _WIN32
+    if (::_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0)
+        throw std::runtime_error(ErrnoMessage("Cannot seek upload file", path));
+#endif
+    while (size > 0)
+    {
+#ifdef _WIN32
+        const int n = ::_write(fd, data, static_cast<unsigned int>(std::min<size_t>(size, 1u << 30)));
+#else
+        const ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+#endif
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(ErrnoMessage("Cannot write upload file", path));
+        }
+        data   += n;
+        size   -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+size_t ReadAt(int fd, uint64_t offset, unsigned char* data, size_t size, const std::string& path)
+{
+#ifdef _WIN32
+    if (::_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0)
+        throw std::runtime_error(ErrnoMessage("Cannot seek upload file", path));
+    const int n = ::_read(fd, data, static_cast<unsigned int>(size));
+#else
+    ssize_t n;
+    do
+        n = ::pread(fd, data, size, static_cast<off_t>(offset));
+    while (n < 0 && errno == EINTR);
+#endif
+    if (n < 0)
+        throw std::runtime_error(ErrnoMessage("Cannot read upload file", path));
+    return static_cast<size_t>(n);
+}
+
+void SyncData(int fd, const std::string& path)
+{
+#ifdef _WIN32
+    const int rc = ::_commit(fd);
+#elif defined(__APPLE__)
+    const int rc = ::fsync(fd);
+#else
+    const int rc = ::fdatasync(fd);
+#endif
+    if (rc != 0)
+        throw std::runtime_error(ErrnoMessage("Cannot flush upload file", path));
+}
+
+} // namespace
+
+struct UploadSessions::Session
+{
+    // Never taken while holding UploadSessions::mutex. Target, size and hash of Info never
+    // change, so they may be read without it.
+    std::mutex Mutex;
+    omnisphere::models::UploadSession Info;
+    std::string TempPath;
+    omnisphere::enums::FsyncPolicy Durability = omnisphere::enums::FsyncPolicy::File;
+    std::map<uint64_t, uint64_t> Ranges;    // Received [start, end), merged
+    uint64_t HashedTo = 0;                  // The hasher has seen [0, HashedTo)
+    ContentHasher Hasher;
+    int Fd = -1;
+    std::atomic<bool> Closed{false};        // Committed or discarded
+
+    ~Session() { CloseData(Fd); }
+
+    void Open()
+    {
+        if (Fd >= 0)
+            return;
+        Fd = OpenData(TempPath, false);
+        if (Fd < 0)
+            throw std::runtime_error(ErrnoMessage("Cannot open upload file", TempPath));
+    }
+
+    void AddRange(uint64_t start, uint64_t end)
+    {
+        auto it = Ranges.upper_bound(start);
+        if (it != Ranges.begin() && std::prev(it)->second >= start)
+        {
+            --it;
+            start = it->first;
+        }
+        while (it != Ranges.end() && it->first <= end)
+        {
+            end = std::max(end, it->second);
+            it  = Ranges.erase(it);
+        }
+        Ranges.emplace(start, end);
+
+        Info.Received = 0;
+        for (const auto& [from, to] : Ranges)
+            Info.Received += to - from;
+        Info.Acknowledged = Ranges.begin()->first == 0 ? Ranges.begin()->second : 0;
+    }
+};
+
+UploadSessions::UploadSessions(std::string stateDirectory, std::chrono::hours expiry)
+    : directory(stateDirectory.empty() ? DefaultDirectory() : std::move(stateDirectory)), expiry(expiry)
+{
+}
+
+UploadSessions::~UploadSessions() = default;
+
+UploadSessions& UploadSessions::Instance()
+{
+    static UploadSessions uploads;
+    return uploads;
+}
+
+std::string UploadSessions::StatePath(const std::string& id) const
+{
+    return (fs::path(directory) / (id + stateSuffix)).string();
+}
+
+// ---------------------------------------------------------------------------
+// Begin
+// ---------------------------------------------------------------------------
+
+omnisphere::models::UploadSession UploadSessions::Begin(const std::string& fullPath, const std::string& fileName, uint64_t size,
+                                                        const std::optional<std::string>& hash, omnisphere::enums::FsyncPolicy durability)
+{
+    if (hash && !ContentHasher::IsValid(*hash))
+        throw std::invalid_argument("Not a content hash: " + *hash);
+
+    std::vector<std::shared_ptr<Session>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        LoadLocked();
+        expired = TakeExpiredLocked();
+    }
+    for (const auto& session : expired)
+    {
+        std::lock_guard<std::mutex> sessionLock(session->Mutex);
+        if (!session->Closed)
+            Discard(*session);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // A client that lost its upload id picks its session up again by starting over. Only
+    // the content hash says it is the same file; without one the client has to resume by id.
+    for (const auto& [id, existing] : sessions)
+    {
+        if (!hash || existing->Closed || existing->Info.FullPath != fullPath || existing->Info.Size != size ||
+            existing->Info.ContentHash != hash)
+            continue;
+        auto found = existing;
+        lock.unlock();
+        std::lock_guard<std::mutex> sessionLock(found->Mutex);
+        return found->Info;
+    }
+
+    auto session = std::make_shared<Session>();
+    session->Info.UploadId    = NewId();
+    session->Info.FileName    = fileName;
+    session->Info.FullPath    = fullPath;
+    session->Info.Size        = size;
+    session->Info.ContentHash = hash;
+    session->Info.CreatedAt   = NowUnixMs();
+    session->Durability       = durability;
+
+    const fs::path target(fullPath);
+    session->TempPath = (target.parent_path() / ("." + target.filename().string() + ".upload-" + session->Info.UploadId)).string();
+
+    session->Fd = OpenData(session->TempPath, true);
+    if (session->Fd < 0)
+        throw std::runtime_error(ErrnoMessage("Cannot create upload file", session->TempPath));
+    try
+    {
+#ifndef _WIN32
+        // Same mode as AtomicFile gives a replaced or new file
+        struct stat st;
+        if (::stat(fullPath.c_str(), &st) == 0)
+        {
+            ::fchmod(session->Fd, st.st_mode & 07777);
+        }
+        else
+        {
+            mode_t mask = ::umask(0);
+            ::umask(mask);
+            ::fchmod(session->Fd, 0666 & ~mask);
+        }
+#endif
+        // Sparse: blocks are only allocated as chunks arrive
+        fs::resize_file(session->TempPath, size);
+        fs::create_directories(directory);
+        Save(*session);
+    }
+    catch (...)
+    {
+        CloseData(session->Fd);
+        std::error_code ec;
+        fs::remove(session->TempPath, ec);
+        throw;
+    }
+
+    sessions.emplace(session->Info.UploadId, session);
+    return session->Info;
+}
+
+// ---------------------------------------------------------------------------
+// Append
+// ---------------------------------------------------------------------------
+
+omnisphere::models::UploadSession UploadSessions::Append(const std::string& id, uint64_t offset, const unsigned char* data, size_t size)
+{
+    auto session = Find(id);
+    std::lock_guard<std::mutex> lock(session->Mutex);
+    if (session->Closed)
+        throw std::runtime_error("Upload is already finished: " + id);
+    if (offset > session->Info.Size || size > session->Info.Size - offset)
+        throw std::out_of_range("Chunk at " + std::to_string(offset) + " (+" + std::to_string(size) + ") is past the end of the " +
+                                std::to_string(session->Info.Size) + " byte upload");
+    if (size == 0)
+        return session->Info;
+
+    session->Open();
+    WriteAt(session->Fd, offset, data, size, session->TempPath);
+    // The chunk must be on disk before the state file says it arrived
+    if (session->Durability != omnisphere::enums::FsyncPolicy::None)
+        SyncData(session->Fd, session->TempPath);
+
+    const uint64_t end = offset + size;
+    if (offset <= session->HashedTo && end > session->HashedTo)
+    {
+        session->Hasher.Update(data + (session->HashedTo - offset), static_cast<size_t>(end - session->HashedTo));
+        session->HashedTo = end;
+    }
+    session->AddRange(offset, end);
+    Save(*session);
+    return session->Info;
+}
+
+omnisphere::models::UploadSession UploadSessions::Get(const std::string& id)
+{
+    auto session = Find(id);
+    std::lock_guard<std::mutex> lock(session->Mutex);
+    return session->Info;
+}
+
+// ---------------------------------------------------------------------------
+// Commit
+// ---------------------------------------------------------------------------
+
+std::string UploadSessions::Commit(const std::string& id)
+{
+    auto session = Find(id);
+    std::lock_guard<std::mutex> lock(session->Mutex);
+    if (session->Closed)
+        throw std::runtime_error("Upload is already finished: " + id);
+    if (session->Info.Acknowledged != session->Info.Size)
+        throw std::runtime_error("Upload is incomplete: " + std::to_string(session->Info.Acknowledged) + " of " +
+                                 std::to_string(session->Info.Size) + " bytes acknowledged");
+
+    session->Open();
+
+    // Hash what came out of order straight from the file
+    std::vector<unsigned char> buffer(1 << 20);
+    while (session->HashedTo < session->Info.Size)
+    {
+        const size_t want = static_cast<size_t>(std::min<uint64_t>(buffer.size(), session->Info.Size - session->HashedTo));
+        const size_t n = ReadAt(session->Fd, session->HashedTo, buffer.data(), want, session->TempPath);
+        if (n == 0)
+            throw std::runtime_error("Upload file is shorter than expected: " + session->TempPath);
+        session->Hasher.Update(buffer.data(), n);
+        session->HashedTo += n;
+    }
+    const std::string hash = session->Hasher.Final();
+
+    if (session->Info.ContentHash && *session->Info.ContentHash != hash)
+    {
+        Discard(*session);
+        throw std::runtime_error("Uploaded content does not match its hash " + *session->Info.ContentHash + " (got " + hash + ")");
+    }
+
+    CloseData(session->Fd);
+    std::error_code ec;
+    fs::rename(session->TempPath, session->Info.FullPath, ec);
+    if (ec)
+        throw std::runtime_error("Cannot replace file: " + session->Info.FullPath + " (" + ec.message() + ")");
+    if (session->Durability == omnisphere::enums::FsyncPolicy::FileAndDirectory)
+    {
+        const fs::path parent = fs::path(session->Info.FullPath).parent_path();
+        AtomicFile::SyncDirectory(parent.empty() ? "." : parent.string());
+    }
+
+    session->Closed = true;
+    fs::remove(StatePath(id), ec);
+    std::lock_guard<std::mutex> mapLock(mutex);
+    sessions.erase(id);
+    return hash;
+}
+
+void UploadSessions::Abort(const std::string& id)
+{
+    auto session = Find(id);
+    std::lock_guard<std::mutex> lock(session->Mutex);
+    if (!session->Closed)
+        Discard(*session);
+}
+
+// ---------------------------------------------------------------------------
+// Session state
+// ---------------------------------------------------------------------------
+
+std::shared_ptr<UploadSessions::Session> UploadSessions::Find(const std::string& id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    LoadLocked();
+    auto it = sessions.find(id);
+    if (it == sessions.end())
+        throw std::runtime_error("Unknown or expired upload: " + id);
+    return it->second;
+}
+
+std::vector<std::shared_ptr<UploadSessions::Session>> UploadSessions::TakeExpiredLocked()
+{
+    const int64_t oldest = NowUnixMs() - std::chrono::duration_cast<std::chrono::milliseconds>(expiry).count();
+    std::vector<std::shared_ptr<Session>> expired;
+    for (auto it = sessions.begin(); it != sessions.end();)
+    {
+        if (it->second->Info.CreatedAt < oldest)
+        {
+            expired.push_back(it->second);
+            it = sessions.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return expired;
+}
+
+void UploadSessions::Discard(Session& session)
+{
+    session.Closed = true;
+    CloseData(session.Fd);
+    std::error_code ec;
+    fs::remove(session.TempPath, ec);
+    fs::remove(StatePath(session.Info.UploadId), ec);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    sessions.erase(session.Info.UploadId);
+}
+
+void UploadSessions::Save(const Session& session) const
+{
+    const auto& info = session.Info;
+    std::ostringstream out;
+    out << "id=" << info.UploadId << '\n'
+        << "name=" << EscapeValue(info.FileName) << '\n'
+        << "target=" << EscapeValue(info.FullPath) << '\n'
+        << "temp=" << EscapeValue(session.TempPath) << '\n'
+        << "size=" << info.Size << '\n'
+        << "hash=" << info.ContentHash.value_or("") << '\n'
+        << "durability=" << static_cast<int>(session.Durability) << '\n'
+        << "created=" << info.CreatedAt << '\n'
+        << "hashedTo=" << session.HashedTo << '\n'
+        << "hashState=" << (session.HashedTo > 0 ? session.Hasher.Snapshot() : "") << '\n'
+        << "ranges=";
+    for (const auto& [start, end] : session.Ranges)
+        out << start << '-' << end << ',';
+    out << '\n';
+
+    const std::string text = out.str();
+    AtomicFile file(StatePath(info.UploadId));
+    file.Write(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+    file.Commit(session.Durability == omnisphere::enums::FsyncPolicy::None ? omnisphere::enums::FsyncPolicy::None
+                                                                            : omnisphere::enums::FsyncPolicy::File);
+}
+
+void UploadSessions::LoadLocked()
+{
+    if (loaded)
+        return;
+    loaded = true;
+
+    std::error_code ec;
+    const int64_t oldest = NowUnixMs() - std::chrono::duration_cast<std::chrono::milliseconds>(expiry).count();
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->path().extension() != stateSuffix)
+            continue;
+
+        std::map<std::string, std::string> fields;
+        std::ifstream in(it->path());
+        for (std::string line; std::getline(in, line);)
+        {
+            const size_t eq = line.find('=');
+            if (eq != std::string::npos)
+                fields[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+
+        auto session = std::make_shared<Session>();
+        auto& info = session->Info;
+        info.UploadId   = fields["id"];
+        info.FileName   = UnescapeValue(fields["name"]);
+        info.FullPath   = UnescapeValue(fields["target"]);
+        info.Size       = std::strtoull(fields["size"].c_str(), nullptr, 10);
+        info.CreatedAt  = std::strtoll(fields["created"].c_str(), nullptr, 10);
+        session->TempPath   = UnescapeValue(fields["temp"]);
+        session->Durability = static_cast<omnisphere::enums::FsyncPolicy>(std::atoi(fields["durability"].c_str()));
+        if (!fields["hash"].empty())
+            info.ContentHash = fields["hash"];
+
+        std::error_code sizeEc;
+        const bool usable = info.UploadId + stateSuffix == it->path().filename().string() && info.CreatedAt >= oldest &&
+                            fs::file_size(session->TempPath, sizeEc) == info.Size && !sizeEc;
+        if (!usable)
+        {
+            std::error_code removeEc;
+            if (!session->TempPath.empty())
+                fs::remove(session->TempPath, removeEc);
+            fs::remove(it->path(), removeEc);
+            continue;
+        }
+
+        std::istringstream ranges(fields["ranges"]);
+        for (std::string range; std::getline(ranges, range, ',');)
+        {
+            const size_t dash = range.find('-');
+            if (dash != std::string::npos)
+                session->AddRange(std::strtoull(range.c_str(), nullptr, 10), std::strtoull(range.c_str() + dash + 1, nullptr, 10));
+        }
+        // A snapshot from another libsodium build is useless; hash everything on Commit instead
+        session->HashedTo = std::strtoull(fields["hashedTo"].c_str(), nullptr, 10);
+        if (session->HashedTo > 0 && !session->Hasher.Restore(fields["hashState"]))
+        {
+            session->Hasher   = ContentHasher();
+            session->HashedTo = 0;
+        }
+
+        sessions.emplace(info.UploadId, session);
+    }
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,65 @@
+#pragma once
+#include "File/Enums/FsyncPolicy.hpp"
+#include "File/Models/UploadSession.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    // Resumable uploads of large files. Begin creates a sparse temp file of the final size
+    // next to the target, so Commit is a rename within one filesystem. Each chunk is written
+    // at its offset, flushed, and recorded in a small state file before it is acknowledged;
+    // after a restart the session is picked up from that file and the client carries on from
+    // Acknowledged. Chunks arriving in order are hashed as they come and the hash state is
+    // saved with the session, so Commit only reads back what arrived out of order. Memory
+    // per upload is one chunk. Sessions not committed within the expiry are removed.
+    class UploadSessions
+    {
+    public:
+        explicit UploadSessions(std::string stateDirectory = "", std::chrono::hours expiry = std::chrono::hours(24 * 7));
+        ~UploadSessions();
+
+        UploadSessions(const UploadSessions&) = delete;
+        UploadSessions& operator=(const UploadSessions&) = delete;
+
+        static UploadSessions& Instance();
+
+        // Start an upload. With a content hash, an open session for the same target, size and
+        // hash is returned instead; without one every call starts a new session and an
+        // interrupted upload is resumed by its id. Expired sessions are removed first.
+        omnisphere::models::UploadSession Begin(const std::string& fullPath, const std::string& fileName, uint64_t size,
+                                                const std::optional<std::string>& hash, omnisphere::enums::FsyncPolicy durability);
+
+        omnisphere::models::UploadSession Append(const std::string& id, uint64_t offset, const unsigned char* data, size_t size);
+
+        omnisphere::models::UploadSession Get(const std::string& id);
+
+        // Check that every byte arrived and the hash matches, then rename the file into
+        // place. Returns the content hash. A hash mismatch discards the upload.
+        std::string Commit(const std::string& id);
+
+        void Abort(const std::string& id);
+
+    private:
+        struct Session;
+
+        std::string directory;
+        std::chrono::hours expiry;
+        std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+        bool loaded = false;
+
+        std::shared_ptr<Session> Find(const std::string& id);
+        void LoadLocked();
+        std::vector<std::shared_ptr<Session>> TakeExpiredLocked();
+        std::string StatePath(const std::string& id) const;
+        void Save(const Session& session) const;
+        void Discard(Session& session);
+    };
+} // namespace omnisphere::repositories
@@ -0,0 +1,188 @@
+#include "File/Repositories/WorkStealingPool.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace omnisphere::repositories
+{
+
+namespace
+{
+
+// Which pool and deque the current thread works for, so nested submits stay local
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local size_t currentIndex = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+{
+    threads = std::max<size_t>(threads, 1);
+    queues.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        queues.push_back(std::make_unique<Queue>());
+
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back([this, i] { Run(i); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+WorkStealingPool& WorkStealingPool::Instance()
+{
+    static WorkStealingPool pool;
+    return pool;
+}
+
+size_t WorkStealingPool::DefaultThreads()
+{
+    return std::max<size_t>(std::thread::hardware_concurrency() * 2, 8);
+}
+
+void WorkStealingPool::Submit(Task task)
+{
+    const size_t index = currentPool == this ? currentIndex
+                                             : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+
+    // Taking the sleep mutex orders this against a worker that just found nothing to do
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    sleepCv.notify_one();
+}
+
+bool WorkStealingPool::PopLocal(size_t index, Task& task)
+{
+    Queue& q = *queues[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+        return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::Steal(size_t thief, Task& task)
+{
+    const size_t n = queues.size();
+    for (size_t k = 1; k <= n; ++k)
+    {
+        Queue& q = *queues[(thief + k) % n];
+        std::unique_lock<std::mutex> lock(q.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || q.tasks.empty())
+            continue;
+        // Oldest task: for tree walks that is the shallowest, i.e. the largest piece of work
+        task = std::move(q.tasks.front());
+        q.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool WorkStealingPool::TryRunOne()
+{
+    if (queued.load(std::memory_order_acquire) == 0)
+        return false;
+
+    Task task;
+    const bool found = currentPool == this ? (PopLocal(currentIndex, task) || Steal(currentIndex, task))
+                                           : Steal(nextQueue.load(std::memory_order_relaxed) % queues.size(), task);
+    if (!found)
+        return false;
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+}
+
+void WorkStealingPool::ForEach(size_t count, size_t maxParallel, const std::function<void(size_t)>& body)
+{
+    struct Shared
+    {
+        std::atomic<size_t> Next{0};
+        size_t Running = 0;
+        std::exception_ptr Error;
+        std::mutex Mutex;
+        std::condition_variable Done;
+    };
+    auto shared = std::make_shared<Shared>();
+    const size_t runners = std::min(count, std::max<size_t>(maxParallel, 1));
+    if (runners == 0)
+        return;
+
+    // Each runner claims the next index until none are left, so at most `runners` calls overlap
+    auto runner = [shared, count, &body]
+    {
+        for (size_t i; (i = shared->Next.fetch_add(1)) < count;)
+        {
+            try
+            {
+                body(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(shared->Mutex);
+                if (!shared->Error)
+                    shared->Error = std::current_exception();
+                shared->Next = count;
+            }
+        }
+        std::lock_guard<std::mutex> lock(shared->Mutex);
+        if (--shared->Running == 0)
+            shared->Done.notify_all();
+    };
+
+    shared->Running = runners;
+    for (size_t k = 1; k < runners; ++k)
+        Submit(runner);
+    runner();
+
+    std::unique_lock<std::mutex> lock(shared->Mutex);
+    while (shared->Running != 0)
+    {
+        lock.unlock();
+        const bool helped = TryRunOne();
+        lock.lock();
+        if (!helped)
+            shared->Done.wait_for(lock, std::chrono::milliseconds(5), [&] { return shared->Running == 0; });
+    }
+    if (shared->Error)
+        std::rethrow_exception(shared->Error);
+}
+
+void WorkStealingPool::Run(size_t index)
+{
+    currentPool  = this;
+    currentIndex = index;
+
+    Task task;
+    for (;;)
+    {
+        if (PopLocal(index, task) || Steal(index, task))
+        {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCv.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+} // namespace omnisphere::repositories
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace omnisphere::repositories
+{
+    // Fixed set of workers, each owning a deque. Tasks submitted from a worker go to the back
+    // of its own deque and are popped LIFO (depth-first, cache-warm); idle workers steal from
+    // the front of the others' deques. Tasks submitted from outside are spread round-robin.
+    class WorkStealingPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        explicit WorkStealingPool(size_t threads = DefaultThreads());
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // Shared pool for file system work
+        static WorkStealingPool& Instance();
+
+        // Filesystem work is mostly waiting on I/O, so run more workers than cores
+        static size_t DefaultThreads();
+
+        void Submit(Task task);
+
+        // Run one queued task on the calling thread, if any. Lets a thread that waits for
+        // pool work help instead of blocking (and not deadlock when it is itself a worker).
+        bool TryRunOne();
+
+        // Call body(0..count-1) with at most maxParallel calls running at once, the calling
+        // thread being one of them, and return when all are done. The first exception stops
+        // the remaining calls from starting and is rethrown.
+        void ForEach(size_t count, size_t maxParallel, const std::function<void(size_t)>& body);
+
+        size_t Size() const { return workers.size(); }
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> queued{0};
+        std::atomic<size_t> nextQueue{0};
+
+        std::mutex sleepMutex;
+        std::condition_variable sleepCv;
+        bool stopping = false;
+
+        bool PopLocal(size_t index, Task& task);
+        bool Steal(size_t thief, Task& task);
+        void Run(size_t index);
+    };
+} // namespace omnisphere::repositories
@@ -1,9 +1,12 @@
 #include "GlobalConfiguration/GlobalConfiguration.hpp"
 #include "GlobalConfiguration/Repositories/GlobalConfiguration.hpp"
+#include "File/File.hpp"
+#include <atomic>
 
 namespace omnisphere::services {
 struct GlobalConfiguration::Impl {
   std::shared_ptr<omnisphere::repositories::GlobalConfiguration> repository;
+  mutable std::atomic<bool> storageRootsStarted{false};
   explicit Impl(std::shared_ptr<omnisphere::data::DatabasePool> database)
       : repository(
             std::make_shared<omnisphere::repositories::GlobalConfiguration>(
@@ -18,11 +21,29 @@ GlobalConfiguration::~GlobalConfiguration() = default;
 
 bool GlobalConfiguration::Modify(
     const omnisphere::dtos::UpdateGlobalConfiguration &config) const {
-  return pimpl->repository->Update(config);
+  const bool updated = pimpl->repository->Update(config);
+  if (updated && pimpl->storageRootsStarted) {
+    omnisphere::dtos::ConfigureStorageRoots roots;
+    roots.ImagePath = config.ImagePath;
+    roots.PDFPath = config.PDFPath;
+    roots.XMLPath = config.XMLPath;
+    omnisphere::services::File().ConfigureStorageRoots(roots);
+  }
+  return updated;
 }
 
 omnisphere::models::GlobalConfiguration
 GlobalConfiguration::Get(int confEntry) const {
   return pimpl->repository->Get(confEntry);
 }
+
+void GlobalConfiguration::StartStorageRoots(int confEntry) const {
+  const auto config = pimpl->repository->Get(confEntry);
+  omnisphere::dtos::ConfigureStorageRoots roots;
+  roots.ImagePath = config.ImagePath.value_or("");
+  roots.PDFPath = config.PDFPath.value_or("");
+  roots.XMLPath = config.XMLPath.value_or("");
+  omnisphere::services::File().ConfigureStorageRoots(roots);
+  pimpl->storageRootsStarted = true;
+}
 } // namespace omnisphere::services
@@ -18,6 +18,11 @@ public:
 
   omnisphere::models::GlobalConfiguration Get(int confEntry) const;
 
+  // Hands ImagePath, PDFPath and XMLPath of confEntry to the File storage roots,
+  // which mount and probe them in the background. Later Modify calls keep them
+  // in sync.
+  void StartStorageRoots(int confEntry) const;
+
 private:
   struct Impl;
   std::unique_ptr<Impl> pimpl;
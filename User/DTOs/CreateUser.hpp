@@ -20,6 +20,6 @@ struct CreateUser {
   bool ChangePasswordNextLogin;
   bool PasswordNeverExpires;
   int CreatedBy;
-  std::string CreateDate;
+  std::string CreateDate; // Ignored: stamped by the server
 };
 } // namespace omnisphere::dtos
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+#include "User/Enums/UserField.hpp"
+#include <optional>
+#include <string>
+
+namespace omnisphere::dtos {
+struct GetUserChanges {
+  // NextWatermark of a previous call (an opaque rowversion); unset starts
+  // from the beginning
+  std::optional<std::string> Watermark;
+  int Limit = 500;
+  omnisphere::enums::UserField Fields = omnisphere::enums::UserField::All;
+};
+} // namespace omnisphere::dtos
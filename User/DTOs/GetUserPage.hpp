@@ -0,0 +1,20 @@
+#pragma once
+#include "User/Enums/UserCountMode.hpp"
+#include "User/Enums/UserField.hpp"
+#include "User/Enums/UserSortKey.hpp"
+#include <optional>
+#include <string>
+
+namespace omnisphere::dtos {
+struct GetUserPage {
+  // Opaque cursors returned by a previous page; at most one may be set
+  std::optional<std::string> After;
+  std::optional<std::string> Before;
+  int Limit = 50;
+  omnisphere::enums::UserSortKey SortBy = omnisphere::enums::UserSortKey::Entry;
+  bool Descending = false;
+  omnisphere::enums::UserCountMode Count =
+      omnisphere::enums::UserCountMode::None;
+  omnisphere::enums::UserField Fields = omnisphere::enums::UserField::All;
+};
+} // namespace omnisphere::dtos
@@ -24,7 +24,7 @@ struct UserData {
 struct UpdateUser {
   UserCondition Where;
   UserData Data;
-  std::string UpdateDate;
+  std::string UpdateDate; // Ignored: stamped by the server
   int UpdatedBy;
 };
 } // namespace omnisphere::dtos
\ No newline at end of file
@@ -0,0 +1,5 @@
+#pragma once
+
+namespace omnisphere::enums {
+enum class UserChangeKind { Inserted, Updated, Locked };
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace omnisphere::enums {
+// None skips counting, Exact runs COUNT(*) on every request and Approximate
+// serves a cached count that is refreshed once it gets stale.
+enum class UserCountMode { None, Exact, Approximate };
+}
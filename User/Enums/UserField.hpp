@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+
+namespace omnisphere::enums {
+// Projection mask for user reads. Entry is always selected.
+enum class UserField : uint32_t {
+  None = 0,
+  Entry = 1u << 0,
+  Code = 1u << 1,
+  Name = 1u << 2,
+  Email = 1u << 3,
+  Phone = 1u << 4,
+  Employee = 1u << 5,
+  RoleEntry = 1u << 6,
+  MaxDisccountPerLine = 1u << 7,
+  MaxDisccountPerDocument = 1u << 8,
+  PermissionMode = 1u << 9,
+  Department = 1u << 10,
+  SuperUser = 1u << 11,
+  IsLocked = 1u << 12,
+  IsActive = 1u << 13,
+  ChangePasswordNextLogin = 1u << 14,
+  PasswordNeverExpires = 1u << 15,
+  CreatedBy = 1u << 16,
+  CreateDate = 1u << 17,
+  LastUpdatedBy = 1u << 18,
+  UpdateDate = 1u << 19,
+  All = (1u << 20) - 1
+};
+
+constexpr UserField operator|(UserField a, UserField b) {
+  return static_cast<UserField>(static_cast<uint32_t>(a) |
+                                static_cast<uint32_t>(b));
+}
+
+constexpr UserField operator&(UserField a, UserField b) {
+  return static_cast<UserField>(static_cast<uint32_t>(a) &
+                                static_cast<uint32_t>(b));
+}
+
+constexpr UserField &operator|=(UserField &a, UserField b) {
+  return a = a | b;
+}
+
+constexpr bool HasField(UserField fields, UserField field) {
+  return (fields & field) != UserField::None;
+}
+} // namespace omnisphere::enums
@@ -0,0 +1,5 @@
+#pragma once
+
+namespace omnisphere::enums {
+enum class UserSortKey { Entry, Code, Name, CreateDate };
+}
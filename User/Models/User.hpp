@@ -9,7 +9,7 @@
 namespace omnisphere::models {
 class User {
 public:
-  int Entry;
+  int Entry = 0;
   std::string Code;
   std::optional<std::string> Name;
   std::optional<std::string> Email;
@@ -22,12 +22,12 @@ public:
   std::optional<omnisphere::enums::PermissionMode> PermissionMode;
   std::optional<int> Department;
 
-  bool SuperUser;
-  bool IsLocked;
+  bool SuperUser = false;
+  bool IsLocked = false;
   bool IsActive = true;
-  bool ChangePasswordNextLogin;
-  bool PasswordNeverExpires;
-  int CreatedBy;
+  bool ChangePasswordNextLogin = false;
+  bool PasswordNeverExpires = false;
+  int CreatedBy = 0;
   std::string CreateDate;
   std::optional<int> LastUpdatedBy;
   std::optional<std::string> UpdateDate;
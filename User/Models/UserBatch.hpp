@@ -0,0 +1,271 @@
+#pragma once
+#include "../Enums/PermissionMode.hpp"
+#include "../Enums/UserField.hpp"
+#include "User.hpp"
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace omnisphere::models {
+// Compact result set for bulk user reads. Rows are fixed-size records, all
+// strings live in one contiguous buffer and a per-row UserField mask marks
+// which values are present, so a batch costs a handful of allocations
+// regardless of its size.
+class UserBatch {
+public:
+  using UserField = omnisphere::enums::UserField;
+
+  UserBatch() = default;
+
+  size_t Size() const { return rows.size(); }
+  bool Empty() const { return rows.empty(); }
+
+  void Reserve(size_t rowCount, size_t stringBytes) {
+    rows.reserve(rowCount);
+    strings.reserve(stringBytes);
+  }
+
+  // Appends a row where only Entry is present and returns its index
+  size_t AddRow(int entry) {
+    rows.emplace_back();
+    rows.back().Entry = entry;
+    rows.back().Present = static_cast<uint32_t>(UserField::Entry);
+    return rows.size() - 1;
+  }
+
+  void SetString(size_t row, UserField field, std::string_view value) {
+    Row &r = rows.at(row);
+    StringRef &ref = r.Strings[StringSlot(field)];
+    ref.Offset = static_cast<uint32_t>(strings.size());
+    ref.Length = static_cast<uint32_t>(value.size());
+    strings.append(value.data(), value.size());
+    r.Present |= static_cast<uint32_t>(field);
+  }
+
+  void SetInt(size_t row, UserField field, int value) {
+    Row &r = rows.at(row);
+    r.Ints[IntSlot(field)] = value;
+    r.Present |= static_cast<uint32_t>(field);
+  }
+
+  void SetDouble(size_t row, UserField field, double value) {
+    Row &r = rows.at(row);
+    r.Doubles[field == UserField::MaxDisccountPerLine ? 0 : 1] = value;
+    r.Present |= static_cast<uint32_t>(field);
+  }
+
+  void SetBool(size_t row, UserField field, bool value) {
+    Row &r = rows.at(row);
+    if (value)
+      r.Flags |= static_cast<uint32_t>(field);
+    else
+      r.Flags &= ~static_cast<uint32_t>(field);
+    r.Present |= static_cast<uint32_t>(field);
+  }
+
+  void SetPermissionMode(size_t row, omnisphere::enums::PermissionMode mode) {
+    Row &r = rows.at(row);
+    r.Mode = mode;
+    r.Present |= static_cast<uint32_t>(UserField::PermissionMode);
+  }
+
+  void Append(const User &user) {
+    const size_t row = AddRow(user.Entry);
+    SetString(row, UserField::Code, user.Code);
+    SetOptional(row, UserField::Name, user.Name);
+    SetOptional(row, UserField::Email, user.Email);
+    SetOptional(row, UserField::Phone, user.Phone);
+    SetOptional(row, UserField::Employee, user.Employee);
+    SetOptional(row, UserField::RoleEntry, user.RoleEntry);
+    if (user.MaxDisccountPerLine)
+      SetDouble(row, UserField::MaxDisccountPerLine, *user.MaxDisccountPerLine);
+    if (user.MaxDisccountPerDocument)
+      SetDouble(row, UserField::MaxDisccountPerDocument,
+                *user.MaxDisccountPerDocument);
+    if (user.PermissionMode)
+      SetPermissionMode(row, *user.PermissionMode);
+    SetOptional(row, UserField::Department, user.Department);
+    SetBool(row, UserField::SuperUser, user.SuperUser);
+    SetBool(row, UserField::IsLocked, user.IsLocked);
+    SetBool(row, UserField::IsActive, user.IsActive);
+    SetBool(row, UserField::ChangePasswordNextLogin,
+            user.ChangePasswordNextLogin);
+    SetBool(row, UserField::PasswordNeverExpires, user.PasswordNeverExpires);
+    SetInt(row, UserField::CreatedBy, user.CreatedBy);
+    SetString(row, UserField::CreateDate, user.CreateDate);
+    SetOptional(row, UserField::LastUpdatedBy, user.LastUpdatedBy);
+    SetOptional(row, UserField::UpdateDate, user.UpdateDate);
+  }
+
+  bool Has(size_t row, UserField field) const {
+    return (rows.at(row).Present & static_cast<uint32_t>(field)) != 0;
+  }
+
+  int Entry(size_t row) const { return rows.at(row).Entry; }
+  std::string_view Code(size_t row) const {
+    return String(row, UserField::Code).value_or(std::string_view());
+  }
+  std::optional<std::string_view> Name(size_t row) const {
+    return String(row, UserField::Name);
+  }
+  std::optional<std::string_view> Email(size_t row) const {
+    return String(row, UserField::Email);
+  }
+  std::optional<std::string_view> Phone(size_t row) const {
+    return String(row, UserField::Phone);
+  }
+  std::optional<int> Employee(size_t row) const {
+    return Int(row, UserField::Employee);
+  }
+  std::optional<int> RoleEntry(size_t row) const {
+    return Int(row, UserField::RoleEntry);
+  }
+  std::optional<double> MaxDisccountPerLine(size_t row) const {
+    if (!Has(row, UserField::MaxDisccountPerLine))
+      return std::nullopt;
+    return rows[row].Doubles[0];
+  }
+  std::optional<double> MaxDisccountPerDocument(size_t row) const {
+    if (!Has(row, UserField::MaxDisccountPerDocument))
+      return std::nullopt;
+    return rows[row].Doubles[1];
+  }
+  std::optional<omnisphere::enums::PermissionMode>
+  PermissionMode(size_t row) const {
+    if (!Has(row, UserField::PermissionMode))
+      return std::nullopt;
+    return rows[row].Mode;
+  }
+  std::optional<int> Department(size_t row) const {
+    return Int(row, UserField::Department);
+  }
+  bool SuperUser(size_t row) const { return Flag(row, UserField::SuperUser); }
+  bool IsLocked(size_t row) const { return Flag(row, UserField::IsLocked); }
+  bool IsActive(size_t row) const {
+    return !Has(row, UserField::IsActive) || Flag(row, UserField::IsActive);
+  }
+  bool ChangePasswordNextLogin(size_t row) const {
+    return Flag(row, UserField::ChangePasswordNextLogin);
+  }
+  bool PasswordNeverExpires(size_t row) const {
+    return Flag(row, UserField::PasswordNeverExpires);
+  }
+  int CreatedBy(size_t row) const {
+    return Int(row, UserField::CreatedBy).value_or(0);
+  }
+  std::string_view CreateDate(size_t row) const {
+    return String(row, UserField::CreateDate).value_or(std::string_view());
+  }
+  std::optional<int> LastUpdatedBy(size_t row) const {
+    return Int(row, UserField::LastUpdatedBy);
+  }
+  std::optional<std::string_view> UpdateDate(size_t row) const {
+    return String(row, UserField::UpdateDate);
+  }
+
+  // Materializes one row for callers that need the regular model
+  User ToModel(size_t row) const {
+    User user;
+    user.Entry = Entry(row);
+    user.Code = std::string(Code(row));
+    if (auto v = Name(row)) user.Name = std::string(*v);
+    if (auto v = Email(row)) user.Email = std::string(*v);
+    if (auto v = Phone(row)) user.Phone = std::string(*v);
+    user.Employee = Employee(row);
+    user.RoleEntry = RoleEntry(row);
+    user.MaxDisccountPerLine = MaxDisccountPerLine(row);
+    user.MaxDisccountPerDocument = MaxDisccountPerDocument(row);
+    user.PermissionMode = PermissionMode(row);
+    user.Department = Department(row);
+    user.SuperUser = SuperUser(row);
+    user.IsLocked = IsLocked(row);
+    user.IsActive = IsActive(row);
+    user.ChangePasswordNextLogin = ChangePasswordNextLogin(row);
+    user.PasswordNeverExpires = PasswordNeverExpires(row);
+    user.CreatedBy = CreatedBy(row);
+    user.CreateDate = std::string(CreateDate(row));
+    user.LastUpdatedBy = LastUpdatedBy(row);
+    if (auto v = UpdateDate(row)) user.UpdateDate = std::string(*v);
+    return user;
+  }
+
+  // Heap bytes held by the batch
+  size_t MemoryBytes() const {
+    return rows.capacity() * sizeof(Row) + strings.capacity();
+  }
+
+private:
+  struct StringRef {
+    uint32_t Offset = 0;
+    uint32_t Length = 0;
+  };
+
+  struct Row {
+    int Entry = 0;
+    uint32_t Present = 0;
+    uint32_t Flags = 0;
+    omnisphere::enums::PermissionMode Mode = omnisphere::enums::PermissionMode::P;
+    int Ints[5] = {};
+    double Doubles[2] = {};
+    StringRef Strings[6];
+  };
+
+  std::vector<Row> rows;
+  std::string strings;
+
+  static size_t StringSlot(UserField field) {
+    switch (field) {
+    case UserField::Code: return 0;
+    case UserField::Name: return 1;
+    case UserField::Email: return 2;
+    case UserField::Phone: return 3;
+    case UserField::CreateDate: return 4;
+    case UserField::UpdateDate: return 5;
+    default: throw std::invalid_argument("Not a string user field");
+    }
+  }
+
+  static size_t IntSlot(UserField field) {
+    switch (field) {
+    case UserField::Employee: return 0;
+    case UserField::RoleEntry: return 1;
+    case UserField::Department: return 2;
+    case UserField::CreatedBy: return 3;
+    case UserField::LastUpdatedBy: return 4;
+    default: throw std::invalid_argument("Not an integer user field");
+    }
+  }
+
+  std::optional<std::string_view> String(size_t row, UserField field) const {
+    if (!Has(row, field))
+      return std::nullopt;
+    const StringRef &ref = rows[row].Strings[StringSlot(field)];
+    return std::string_view(strings).substr(ref.Offset, ref.Length);
+  }
+
+  std::optional<int> Int(size_t row, UserField field) const {
+    if (!Has(row, field))
+      return std::nullopt;
+    return rows[row].Ints[IntSlot(field)];
+  }
+
+  bool Flag(size_t row, UserField field) const {
+    return (rows.at(row).Flags & static_cast<uint32_t>(field)) != 0;
+  }
+
+  void SetOptional(size_t row, UserField field,
+                   const std::optional<std::string> &value) {
+    if (value)
+      SetString(row, field, *value);
+  }
+
+  void SetOptional(size_t row, UserField field,
+                   const std::optional<int> &value) {
+    if (value)
+      SetInt(row, field, *value);
+  }
+};
+} // namespace omnisphere::models
@@ -0,0 +1,19 @@
+#pragma once
+#include "../Enums/UserChangeKind.hpp"
+#include "User.hpp"
+#include <string>
+#include <vector>
+
+namespace omnisphere::models {
+struct UserChange {
+  omnisphere::enums::UserChangeKind Kind;
+  omnisphere::models::User User;
+};
+
+class UserChangeSet {
+public:
+  std::vector<UserChange> Changes;
+  std::string NextWatermark;
+  bool HasMore = false;
+};
+} // namespace omnisphere::models
@@ -2,14 +2,415 @@
 #include "User/Enums/PermissionMode.hpp"
 #include "User/Repositories/User.hpp"
 #include <functional>
+#include <limits>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <sstream>
+#include <unordered_set>
 
 namespace omnisphere::repositories {
 
+namespace {
+struct PageCursor {
+  std::optional<std::string> Value;
+  int Entry = 0;
+};
+
+const char base64UrlAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+std::string Base64UrlEncode(const std::string &in) {
+  std::string out;
+  out.reserve((in.size() * 4 + 2) / 3);
+  int val = 0, valb = -6;
+  for (unsigned char c : in) {
+    val = (val << 8) + c;
+    valb += 8;
+    while (valb >= 0) {
+      out.push_back(base64UrlAlphabet[(val >> valb) & 0x3F]);
+      valb -= 6;
+    }
+  }
+  if (valb > -6)
+    out.push_back(base64UrlAlphabet[((val << 8) >> (valb + 8)) & 0x3F]);
+  return out;
+}
+
+std::string Base64UrlDecode(const std::string &in) {
+  std::string out;
+  int val = 0, valb = -8;
+  for (char c : in) {
+    const char *pos = std::strchr(base64UrlAlphabet, c);
+    if (c == '\0' || pos == nullptr)
+      throw std::invalid_argument("Invalid cursor");
+    val = (val << 6) + static_cast<int>(pos - base64UrlAlphabet);
+    valb += 6;
+    if (valb >= 0) {
+      out.push_back(static_cast<char>((val >> valb) & 0xFF));
+      valb -= 8;
+    }
+  }
+  return out;
+}
+
+std::string SortColumn(omnisphere::enums::UserSortKey key) {
+  switch (key) {
+  case omnisphere::enums::UserSortKey::Code:
+    return "[Code]";
+  case omnisphere::enums::UserSortKey::Name:
+    return "[Name]";
+  case omnisphere::enums::UserSortKey::CreateDate:
+    return "CreateDate";
+  default:
+    return "[Entry]";
+  }
+}
+
+// Cursor layout before encoding: "<sortKey><dir>:<entry>:<n|v><value>"
+std::string EncodeCursor(const omnisphere::dtos::GetUserPage &request,
+                         const omnisphere::models::User &user) {
+  std::optional<std::string> value;
+  switch (request.SortBy) {
+  case omnisphere::enums::UserSortKey::Code:
+    value = user.Code;
+    break;
+  case omnisphere::enums::UserSortKey::Name:
+    value = user.Name;
+    break;
+  case omnisphere::enums::UserSortKey::CreateDate:
+    value = user.CreateDate;
+    break;
+  default:
+    break;
+  }
+
+  std::string raw = std::to_string(static_cast<int>(request.SortBy));
+  raw += request.Descending ? "d:" : "a:";
+  raw += std::to_string(user.Entry) + ":";
+  raw += value.has_value() ? "v" + value.value() : "n";
+  return Base64UrlEncode(raw);
+}
+
+PageCursor DecodeCursor(const std::string &token,
+                        const omnisphere::dtos::GetUserPage &request) {
+  const std::string raw = Base64UrlDecode(token);
+
+  std::string prefix = std::to_string(static_cast<int>(request.SortBy));
+  prefix += request.Descending ? "d:" : "a:";
+  if (raw.rfind(prefix, 0) != 0)
+    throw std::invalid_argument("Cursor does not match the requested order");
+
+  const size_t sep = raw.find(':', prefix.size());
+  if (sep == std::string::npos || sep + 1 >= raw.size())
+    throw std::invalid_argument("Invalid cursor");
+
+  PageCursor cursor;
+  try {
+    cursor.Entry = std::stoi(raw.substr(prefix.size(), sep - prefix.size()));
+  } catch (const std::exception &) {
+    throw std::invalid_argument("Invalid cursor");
+  }
+
+  if (raw[sep + 1] == 'v')
+    cursor.Value = raw.substr(sep + 2);
+  else if (raw[sep + 1] != 'n' ||
+           request.SortBy == omnisphere::enums::UserSortKey::Code ||
+           request.SortBy == omnisphere::enums::UserSortKey::CreateDate)
+    throw std::invalid_argument("Invalid cursor");
+
+  return cursor;
+}
+
+// GetChanges walks the rowversion column [Version], which SQL Server bumps on
+// every insert and update. A version is taken when the statement runs, not
+// when it commits, so rows at or above MIN_ACTIVE_ROWVERSION() may still be
+// joined by a slower transaction with a lower version; they are left for the
+// next call. The watermark is the highest version returned so far.
+long long DecodeWatermark(const std::string &token) {
+  const std::string raw = Base64UrlDecode(token);
+  if (raw.size() < 3 || raw.compare(0, 2, "v:") != 0)
+    throw std::invalid_argument("[GetChanges] Invalid watermark");
+  try {
+    size_t used = 0;
+    const long long version = std::stoll(raw.substr(2), &used);
+    if (used != raw.size() - 2 || version < 0)
+      throw std::invalid_argument("[GetChanges] Invalid watermark");
+    return version;
+  } catch (const std::logic_error &) {
+    throw std::invalid_argument("[GetChanges] Invalid watermark");
+  }
+}
+
+std::string EncodeWatermark(long long version) {
+  return Base64UrlEncode("v:" + std::to_string(version));
+}
+} // namespace
+
 User::User(std::shared_ptr<omnisphere::data::DatabasePool> _database)
     : database(std::move(_database)) {}
 
+namespace {
+struct UserColumn {
+  omnisphere::enums::UserField Field;
+  const char *Name;
+};
+
+constexpr UserColumn userColumns[] = {
+    {omnisphere::enums::UserField::Entry, "Entry"},
+    {omnisphere::enums::UserField::Code, "Code"},
+    {omnisphere::enums::UserField::Name, "Name"},
+    {omnisphere::enums::UserField::Email, "Email"},
+    {omnisphere::enums::UserField::Phone, "Phone"},
+    {omnisphere::enums::UserField::Employee, "Employee"},
+    {omnisphere::enums::UserField::RoleEntry, "RoleEntry"},
+    {omnisphere::enums::UserField::MaxDisccountPerLine, "MaxDisccountPerLine"},
+    {omnisphere::enums::UserField::MaxDisccountPerDocument,
+     "MaxDisccountPerDocument"},
+    {omnisphere::enums::UserField::PermissionMode, "PermissionMode"},
+    {omnisphere::enums::UserField::Department, "Department"},
+    {omnisphere::enums::UserField::SuperUser, "SuperUser"},
+    {omnisphere::enums::UserField::IsLocked, "IsLocked"},
+    {omnisphere::enums::UserField::IsActive, "IsActive"},
+    {omnisphere::enums::UserField::ChangePasswordNextLogin,
+     "ChangePasswordNextLogin"},
+    {omnisphere::enums::UserField::PasswordNeverExpires,
+     "PasswordNeverExpires"},
+    {omnisphere::enums::UserField::CreatedBy, "CreatedBy"},
+    {omnisphere::enums::UserField::CreateDate, "CreateDate"},
+    {omnisphere::enums::UserField::LastUpdatedBy, "LastUpdatedBy"},
+    {omnisphere::enums::UserField::UpdateDate, "UpdateDate"}};
+
+// Rows fetched per round trip by the batch reads, so only one chunk of the
+// result set is held as a DataTable next to the batch being filled
+constexpr int batchChunkRows = 4096;
+
+enum class BatchKind { String, Int, Double, Bool, Mode };
+
+BatchKind KindOf(omnisphere::enums::UserField field) {
+  using omnisphere::enums::UserField;
+  switch (field) {
+  case UserField::Employee:
+  case UserField::RoleEntry:
+  case UserField::Department:
+  case UserField::CreatedBy:
+  case UserField::LastUpdatedBy:
+    return BatchKind::Int;
+  case UserField::MaxDisccountPerLine:
+  case UserField::MaxDisccountPerDocument:
+    return BatchKind::Double;
+  case UserField::SuperUser:
+  case UserField::IsLocked:
+  case UserField::IsActive:
+  case UserField::ChangePasswordNextLogin:
+  case UserField::PasswordNeverExpires:
+    return BatchKind::Bool;
+  case UserField::PermissionMode:
+    return BatchKind::Mode;
+  default:
+    return BatchKind::String;
+  }
+}
+
+// A selected column with its lookup key and kind, resolved once per read
+// instead of once per cell
+struct BatchColumn {
+  omnisphere::enums::UserField Field;
+  std::string Key;
+  BatchKind Kind;
+};
+
+std::vector<BatchColumn> BatchColumns(omnisphere::enums::UserField fields) {
+  std::vector<BatchColumn> columns;
+  for (const UserColumn &column : userColumns)
+    if (column.Field != omnisphere::enums::UserField::Entry &&
+        omnisphere::enums::HasField(fields, column.Field))
+      columns.push_back({column.Field, column.Name, KindOf(column.Field)});
+  return columns;
+}
+
+void AppendBatch(const omnisphere::types::DataTable &table,
+                 const std::vector<BatchColumn> &columns,
+                 omnisphere::models::UserBatch &batch) {
+  static const std::string entryKey = "Entry";
+
+  for (size_t i = 0; i < table.RowsCount(); ++i) {
+    const auto &values = table[i];
+    const size_t row = batch.AddRow(values[entryKey]);
+
+    for (const BatchColumn &column : columns) {
+      const auto &value = values[column.Key];
+      if (value.IsNull())
+        continue;
+
+      switch (column.Kind) {
+      case BatchKind::String:
+        batch.SetString(row, column.Field, static_cast<std::string>(value));
+        break;
+      case BatchKind::Int:
+        batch.SetInt(row, column.Field, static_cast<int>(value));
+        break;
+      case BatchKind::Double:
+        batch.SetDouble(row, column.Field, static_cast<double>(value));
+        break;
+      case BatchKind::Bool:
+        batch.SetBool(row, column.Field, static_cast<bool>(value));
+        break;
+      case BatchKind::Mode:
+        batch.SetPermissionMode(row, static_cast<std::string>(value) == "P"
+                                         ? omnisphere::enums::PermissionMode::P
+                                         : omnisphere::enums::PermissionMode::M);
+        break;
+      }
+    }
+  }
+}
+
+// WHERE conditions of a search, shared by Read and ReadBatch
+void SearchConditions(const omnisphere::dtos::SearchUsers &filter,
+                      std::vector<std::string> &conditions,
+                      std::vector<omnisphere::types::SQLParam> &parameters) {
+  auto equalsTo = [&](const char *column,
+                      const std::optional<std::string> &value) {
+    if (!value.has_value())
+      return;
+    conditions.push_back(std::string(column) + " = ?");
+    parameters.push_back(omnisphere::types::MakeSQLParam(value.value()));
+  };
+
+  auto contains = [&](const char *column,
+                      const std::optional<std::string> &value) {
+    if (!value.has_value())
+      return;
+    std::string pattern = "%";
+    for (char c : value.value()) {
+      if (c == '%' || c == '_' || c == '[')
+        pattern += std::string("[") + c + "]";
+      else
+        pattern += c;
+    }
+    pattern += "%";
+    conditions.push_back(std::string(column) + " LIKE ?");
+    parameters.push_back(omnisphere::types::MakeSQLParam(pattern));
+  };
+
+  equalsTo("[Code]", filter.CodeEqualsTo);
+  contains("[Code]", filter.CodeContains);
+  equalsTo("[Name]", filter.NameEqualsTo);
+  contains("[Name]", filter.NameContains);
+  equalsTo("Email", filter.EmailEqualsTo);
+  contains("Email", filter.EmailContains);
+  equalsTo("Phone", filter.PhoneEqualsTo);
+  contains("Phone", filter.PhoneContains);
+}
+} // namespace
+
+std::string User::SelectList(omnisphere::enums::UserField fields) {
+  fields |= omnisphere::enums::UserField::Entry;
+
+  std::string list;
+  for (const UserColumn &column : userColumns) {
+    if (!omnisphere::enums::HasField(fields, column.Field))
+      continue;
+    if (!list.empty())
+      list += ", ";
+    list += std::string("[") + column.Name + "]";
+  }
+  return list;
+}
+
+omnisphere::models::User
+User::ToModel(const omnisphere::types::DataTable &table, size_t row,
+              omnisphere::enums::UserField fields) {
+  using omnisphere::enums::HasField;
+  using omnisphere::enums::UserField;
+
+  omnisphere::models::User user;
+  user.Entry = table[row]["Entry"];
+
+  if (HasField(fields, UserField::Code))
+    user.Code = static_cast<std::string>(table[row]["Code"]);
+
+  if (HasField(fields, UserField::Name) && !table[row]["Name"].IsNull())
+    user.Name = static_cast<std::string>(table[row]["Name"]);
+
+  if (HasField(fields, UserField::Email) && !table[row]["Email"].IsNull())
+    user.Email = static_cast<std::string>(table[row]["Email"]);
+
+  if (HasField(fields, UserField::Phone) && !table[row]["Phone"].IsNull())
+    user.Phone = static_cast<std::string>(table[row]["Phone"]);
+
+  if (HasField(fields, UserField::Employee) &&
+      !table[row]["Employee"].IsNull())
+    user.Employee = static_cast<int>(table[row]["Employee"]);
+
+  if (HasField(fields, UserField::RoleEntry) &&
+      !table[row]["RoleEntry"].IsNull())
+    user.RoleEntry = static_cast<int>(table[row]["RoleEntry"]);
+
+  if (HasField(fields, UserField::MaxDisccountPerLine) &&
+      !table[row]["MaxDisccountPerLine"].IsNull())
+    user.MaxDisccountPerLine =
+        static_cast<double>(table[row]["MaxDisccountPerLine"]);
+
+  if (HasField(fields, UserField::MaxDisccountPerDocument) &&
+      !table[row]["MaxDisccountPerDocument"].IsNull())
+    user.MaxDisccountPerDocument =
+        static_cast<double>(table[row]["MaxDisccountPerDocument"]);
+
+  if (HasField(fields, UserField::PermissionMode) &&
+      !table[row]["PermissionMode"].IsNull()) {
+    std::string mode = static_cast<std::string>(table[row]["PermissionMode"]);
+    user.PermissionMode = mode == "P" ? omnisphere::enums::PermissionMode::P
+                                      : omnisphere::enums::PermissionMode::M;
+  }
+
+  if (HasField(fields, UserField::Department) &&
+      !table[row]["Department"].IsNull())
+    user.Department = static_cast<int>(table[row]["Department"]);
+
+  if (HasField(fields, UserField::SuperUser))
+    user.SuperUser = table[row]["SuperUser"];
+
+  if (HasField(fields, UserField::IsLocked))
+    user.IsLocked = table[row]["IsLocked"];
+
+  if (HasField(fields, UserField::IsActive))
+    user.IsActive = table[row]["IsActive"];
+
+  if (HasField(fields, UserField::PasswordNeverExpires))
+    user.PasswordNeverExpires = table[row]["PasswordNeverExpires"];
+
+  if (HasField(fields, UserField::ChangePasswordNextLogin))
+    user.ChangePasswordNextLogin = table[row]["ChangePasswordNextLogin"];
+
+  if (HasField(fields, UserField::CreatedBy))
+    user.CreatedBy = table[row]["CreatedBy"];
+
+  if (HasField(fields, UserField::CreateDate))
+    user.CreateDate = static_cast<std::string>(table[row]["CreateDate"]);
+
+  if (HasField(fields, UserField::LastUpdatedBy) &&
+      !table[row]["LastUpdatedBy"].IsNull())
+    user.LastUpdatedBy = static_cast<int>(table[row]["LastUpdatedBy"]);
+
+  if (HasField(fields, UserField::UpdateDate) &&
+      !table[row]["UpdateDate"].IsNull())
+    user.UpdateDate = static_cast<std::string>(table[row]["UpdateDate"]);
+
+  return user;
+}
+
+omnisphere::models::UserBatch
+User::ToBatch(const omnisphere::types::DataTable &table,
+              omnisphere::enums::UserField fields) {
+  omnisphere::models::UserBatch batch;
+  // Rough guess of 16 bytes per selected string column
+  batch.Reserve(table.RowsCount(), table.RowsCount() * 16 * 6);
+  AppendBatch(table, BatchColumns(fields), batch);
+  return batch;
+}
+
 bool User::Create(const omnisphere::dtos::CreateUser &user) const {
   auto conn = database->Acquire();
   try {
@@ -42,7 +443,8 @@ bool User::Create(const omnisphere::dtos::CreateUser &user) const {
         "CreatedBy, "
         "CreateDate"
         ") "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+        "SYSDATETIME())";
 
     const std::vector<omnisphere::types::SQLParam> params = {
         omnisphere::types::MakeSQLParam(nextSeq),
@@ -69,8 +471,7 @@ bool User::Create(const omnisphere::dtos::CreateUser &user) const {
         omnisphere::types::MakeSQLParam(hashedPassword),
         omnisphere::types::MakeSQLParam(user.PasswordNeverExpires),
         omnisphere::types::MakeSQLParam(user.ChangePasswordNextLogin),
-        omnisphere::types::MakeSQLParam(user.CreatedBy),
-        omnisphere::types::MakeSQLParam(user.CreateDate)};
+        omnisphere::types::MakeSQLParam(user.CreatedBy)};
 
     if (!conn->RunPrepared(sQuery, params)) {
       conn->RollbackTransaction();
@@ -84,6 +485,12 @@ bool User::Create(const omnisphere::dtos::CreateUser &user) const {
 
     conn->CommitTransaction();
 
+    {
+      std::lock_guard<std::mutex> lock(countMutex);
+      if (cachedCount.has_value())
+        ++cachedCount.value();
+    }
+
     return true;
   } catch (const std::exception &e) {
     conn->RollbackTransaction();
@@ -127,6 +534,11 @@ int User::GetCurrentSequence() const {
 }
 
 bool User::Update(const omnisphere::dtos::UpdateUser &user) const {
+  // Without a key the statement would update every user
+  if (!user.Where.Entry.has_value() && !user.Where.Code.has_value())
+    throw std::invalid_argument("[UpdateUser] Where.Entry or Where.Code is "
+                                "required");
+
   auto conn = database->Acquire();
   try {
     std::string sQuery = "UPDATE Users SET ";
@@ -189,16 +601,22 @@ bool User::Update(const omnisphere::dtos::UpdateUser &user) const {
           omnisphere::types::MakeSQLParam(user.Data.Department.value()));
     }
 
+    // Always the server clock; the caller's UpdateDate is ignored
+    sQuery += "UpdateDate = SYSDATETIME(), ";
+
+    sQuery += "LastUpdatedBy = ? ";
+    updateParams.emplace_back(omnisphere::types::MakeSQLParam(user.UpdatedBy));
+
     if (user.Where.Entry.has_value()) {
       sQuery += "WHERE Entry = ?";
       updateParams.emplace_back(
           omnisphere::types::MakeSQLParam(user.Where.Entry.value()));
-    }
-
-    if (user.Where.Code.has_value()) {
+    } else if (user.Where.Code.has_value()) {
       sQuery += "WHERE Code = ?";
       updateParams.emplace_back(
           omnisphere::types::MakeSQLParam(user.Where.Code.value()));
+    } else {
+      throw std::invalid_argument("Where.Entry or Where.Code is required");
     }
 
     conn->BeginTransaction();
@@ -255,31 +673,11 @@ bool User::UpdatePassword(const omnisphere::enums::UserFilter &filter,
 }
 
 types::DataTable User::Read(const omnisphere::enums::UserFilter &filter,
-                            const std::string &value) const {
+                            const std::string &value,
+                            omnisphere::enums::UserField fields) const {
   auto conn = database->Acquire();
   try {
-    std::string sQuery = "SELECT "
-                         "[Entry] AS UserEntry, "
-                         "[Code], "
-                         "[Name], "
-                         "Email, "
-                         "Phone, "
-                         "Employee AS EmpEntry, "
-                         "RoleEntry, "
-                         "MaxDisccountPerLine, "
-                         "MaxDisccountPerDocument, "
-                         "PermissionMode, "
-                         "Department, "
-                         "SuperUser, "
-                         "IsLocked, "
-                         "IsActive, "
-                         "ChangePasswordNextLogin, "
-                         "PasswordNeverExpires, "
-                         "CreateDate, "
-                         "CreatedBy, "
-                         "LastUpdatedBy, "
-                         "UpdateDate "
-                         "FROM Users WHERE ";
+    std::string sQuery = "SELECT " + SelectList(fields) + " FROM Users WHERE ";
 
     switch (filter) {
     case omnisphere::enums::UserFilter::Entry:
@@ -320,33 +718,18 @@ types::DataTable User::Read(const omnisphere::enums::UserFilter &filter,
   }
 }
 
-types::DataTable User::Read(const omnisphere::dtos::SearchUsers &filter) const {
+types::DataTable User::Read(const omnisphere::dtos::SearchUsers &filter,
+                            omnisphere::enums::UserField fields) const {
   auto conn = database->Acquire();
   try {
-    std::string baseQuery = "SELECT "
-                            "[Entry] AS UserEntry, "
-                            "[Code], "
-                            "[Name], "
-                            "Email, "
-                            "Phone, "
-                            "IsLocked, "
-                            "IsActive, "
-                            "Employee AS EmpEntry, "
-                            "RoleEntry, "
-                            "MaxDisccountPerLine, "
-                            "MaxDisccountPerDocument, "
-                            "PermissionMode, "
-                            "Department, "
-                            "SuperUser, "
-                            "PasswordNeverExpires, "
-                            "ChangePasswordNextLogin, "
-                            "CreatedBy, "
-                            "LastUpdatedBy, "
-                            "UpdateDate "
-                            "FROM Users";
+    std::string baseQuery = "SELECT " + SelectList(fields) + " FROM Users";
 
     std::vector<std::string> conditions;
-    std::vector<std::string> parameters;
+    std::vector<omnisphere::types::SQLParam> parameters;
+    SearchConditions(filter, conditions, parameters);
+
+    for (size_t i = 0; i < conditions.size(); ++i)
+      baseQuery += (i == 0 ? " WHERE " : " AND ") + conditions[i];
 
     omnisphere::types::DataTable dataTable =
         conn->FetchPrepared(baseQuery, parameters);
@@ -357,11 +740,13 @@ types::DataTable User::Read(const omnisphere::dtos::SearchUsers &filter) const {
   }
 }
 
-omnisphere::types::DataTable User::GetByIds(const std::vector<int> &ids) const {
+omnisphere::types::DataTable
+User::GetByIds(const std::vector<int> &ids,
+               omnisphere::enums::UserField fields) const {
   if (ids.empty()) return omnisphere::types::DataTable{};
   auto conn = database->Acquire();
-  std::string sQuery = "SELECT Entry, Code, Name, Email, Phone, IsLocked, IsActive, "
-                       "RoleEntry, SuperUser, CreateDate FROM Users WHERE Entry IN (";
+  std::string sQuery =
+      "SELECT " + SelectList(fields) + " FROM Users WHERE Entry IN (";
   std::vector<omnisphere::types::SQLParam> params;
   for (size_t i = 0; i < ids.size(); ++i) {
     if (i > 0) sQuery += ", ";
@@ -372,54 +757,311 @@ omnisphere::types::DataTable User::GetByIds(const std::vector<int> &ids) const {
   return conn->FetchPrepared(sQuery, params);
 }
 
-UserCursorPage User::GetPage(std::optional<int> afterEntry, int limit) const {
-  auto conn = database->Acquire();
-  std::string countQuery = "SELECT COALESCE(COUNT(*), 0) AS Total FROM Users";
-  auto totalTable = conn->FetchResults(countQuery);
-  int totalCount = 0;
-  if (totalTable.RowsCount() > 0) {
-    totalCount = totalTable[0]["Total"];
+omnisphere::models::UserBatch
+User::ReadBatch(const omnisphere::dtos::SearchUsers &filter,
+                omnisphere::enums::UserField fields) const {
+  std::vector<std::string> conditions;
+  std::vector<omnisphere::types::SQLParam> parameters;
+  SearchConditions(filter, conditions, parameters);
+
+  std::string sQuery =
+      "SELECT TOP (?) " + SelectList(fields) + " FROM Users WHERE [Entry] > ?";
+  for (const std::string &condition : conditions)
+    sQuery += " AND " + condition;
+  sQuery += " ORDER BY [Entry]";
+
+  const std::vector<BatchColumn> columns = BatchColumns(fields);
+  omnisphere::models::UserBatch batch;
+  try {
+    auto conn = database->Acquire();
+    // Keyset chunks on Entry: each chunk's table is released before the next
+    int after = std::numeric_limits<int>::min();
+    for (;;) {
+      std::vector<omnisphere::types::SQLParam> params = {
+          omnisphere::types::MakeSQLParam(batchChunkRows),
+          omnisphere::types::MakeSQLParam(after)};
+      params.insert(params.end(), parameters.begin(), parameters.end());
+
+      const omnisphere::types::DataTable chunk =
+          conn->FetchPrepared(sQuery, params);
+      if (chunk.RowsCount() == 0)
+        break;
+      AppendBatch(chunk, columns, batch);
+      after = batch.Entry(batch.Size() - 1);
+      if (chunk.RowsCount() < static_cast<size_t>(batchChunkRows))
+        break;
+    }
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[ReadBatch Exception] ") + e.what());
   }
+  return batch;
+}
 
-  std::string sQuery;
-  std::vector<omnisphere::types::SQLParam> params;
+omnisphere::models::UserBatch
+User::GetBatchByIds(const std::vector<int> &ids,
+                    omnisphere::enums::UserField fields) const {
+  const std::vector<BatchColumn> columns = BatchColumns(fields);
+  omnisphere::models::UserBatch batch;
+  batch.Reserve(ids.size(), ids.size() * 16 * columns.size());
+  for (size_t start = 0; start < ids.size(); start += batchChunkRows) {
+    const size_t end = std::min(ids.size(), start + batchChunkRows);
+    AppendBatch(GetByIds(std::vector<int>(ids.begin() + start, ids.begin() + end),
+                         fields),
+                columns, batch);
+  }
+  return batch;
+}
 
-  if (afterEntry.has_value()) {
-    sQuery = "SELECT Entry, Code, Name, Email, Phone, IsLocked, IsActive, CreatedBy, CreateDate "
-             "FROM Users WHERE Entry > ? ORDER BY Entry ASC LIMIT ?";
-    params.push_back(omnisphere::types::MakeSQLParam(afterEntry.value()));
-    params.push_back(omnisphere::types::MakeSQLParam(limit + 1));
-  } else {
-    sQuery = "SELECT Entry, Code, Name, Email, Phone, IsLocked, IsActive, CreatedBy, CreateDate "
-             "FROM Users ORDER BY Entry ASC LIMIT ?";
-    params.push_back(omnisphere::types::MakeSQLParam(limit + 1));
+UserCursorPage User::GetPage(const omnisphere::dtos::GetUserPage &request) const {
+  if (request.Limit <= 0)
+    throw std::invalid_argument("[GetPage] Limit must be greater than zero");
+
+  if (request.After.has_value() && request.Before.has_value())
+    throw std::invalid_argument("[GetPage] After and Before are exclusive");
+
+  const bool backward = request.Before.has_value();
+  std::optional<PageCursor> cursor;
+  if (request.After.has_value())
+    cursor = DecodeCursor(request.After.value(), request);
+  else if (backward)
+    cursor = DecodeCursor(request.Before.value(), request);
+
+  // Backward pages walk the index in reverse and are flipped afterwards
+  const bool scanAscending = request.Descending == backward;
+  const std::string column = SortColumn(request.SortBy);
+  const std::string cmp = scanAscending ? " > ?" : " < ?";
+
+  omnisphere::enums::UserField fields = request.Fields;
+  switch (request.SortBy) {
+  case omnisphere::enums::UserSortKey::Code:
+    fields |= omnisphere::enums::UserField::Code;
+    break;
+  case omnisphere::enums::UserSortKey::Name:
+    fields |= omnisphere::enums::UserField::Name;
+    break;
+  case omnisphere::enums::UserSortKey::CreateDate:
+    fields |= omnisphere::enums::UserField::CreateDate;
+    break;
+  default:
+    break;
   }
 
-  auto table = conn->FetchPrepared(sQuery, params);
+  std::string sQuery =
+      "SELECT TOP (?) " + SelectList(fields) + " FROM Users";
+  std::vector<omnisphere::types::SQLParam> params = {
+      omnisphere::types::MakeSQLParam(request.Limit + 1)};
+
+  if (cursor.has_value()) {
+    if (request.SortBy == omnisphere::enums::UserSortKey::Entry) {
+      sQuery += " WHERE [Entry]" + cmp;
+    } else if (!cursor->Value.has_value()) {
+      // Only Name is nullable; NULLs sort first ascending, last descending
+      sQuery += scanAscending
+                    ? " WHERE ([Name] IS NULL AND [Entry] > ?) OR "
+                      "[Name] IS NOT NULL"
+                    : " WHERE [Name] IS NULL AND [Entry] < ?";
+    } else {
+      sQuery += " WHERE (" + column + cmp + " OR (" + column +
+                " = ? AND [Entry]" + cmp + ")";
+      if (!scanAscending && request.SortBy == omnisphere::enums::UserSortKey::Name)
+        sQuery += " OR [Name] IS NULL";
+      sQuery += ")";
+      params.push_back(omnisphere::types::MakeSQLParam(cursor->Value.value()));
+      params.push_back(omnisphere::types::MakeSQLParam(cursor->Value.value()));
+    }
+    params.push_back(omnisphere::types::MakeSQLParam(cursor->Entry));
+  }
+
+  const std::string dir = scanAscending ? " ASC" : " DESC";
+  sQuery += " ORDER BY ";
+  if (request.SortBy != omnisphere::enums::UserSortKey::Entry)
+    sQuery += column + dir + ", ";
+  sQuery += "[Entry]" + dir;
+
   UserCursorPage page;
-  page.totalCount = totalCount;
-  page.hasPreviousPage = afterEntry.has_value();
+  try {
+    auto conn = database->Acquire();
+    omnisphere::types::DataTable table = conn->FetchPrepared(sQuery, params);
+
+    const bool hasMore = table.RowsCount() > static_cast<size_t>(request.Limit);
+    const size_t rowLimit =
+        std::min<size_t>(table.RowsCount(), static_cast<size_t>(request.Limit));
+
+    page.users.reserve(rowLimit);
+    for (size_t i = 0; i < rowLimit; ++i)
+      page.users.push_back(ToModel(table, i, fields));
+
+    if (backward) {
+      std::reverse(page.users.begin(), page.users.end());
+      page.hasPreviousPage = hasMore;
+      page.hasNextPage = true;
+    } else {
+      page.hasNextPage = hasMore;
+      page.hasPreviousPage = cursor.has_value();
+    }
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[GetPage Exception] ") + e.what());
+  }
 
-  size_t rowLimit = std::min<size_t>(table.RowsCount(), static_cast<size_t>(limit));
-  for (size_t i = 0; i < rowLimit; ++i) {
-    omnisphere::models::User u;
-    u.Entry = table[i]["Entry"];
-    u.Code = static_cast<std::string>(table[i]["Code"]);
-    if (!table[i]["Name"].IsNull()) u.Name = static_cast<std::string>(table[i]["Name"]);
-    if (!table[i]["Email"].IsNull()) u.Email = static_cast<std::string>(table[i]["Email"]);
-    if (!table[i]["Phone"].IsNull()) u.Phone = static_cast<std::string>(table[i]["Phone"]);
-    u.IsLocked = table[i]["IsLocked"];
-    u.IsActive = table[i]["IsActive"];
-    page.users.push_back(u);
+  if (!page.users.empty()) {
+    if (page.hasNextPage)
+      page.nextCursor = EncodeCursor(request, page.users.back());
+    if (page.hasPreviousPage)
+      page.previousCursor = EncodeCursor(request, page.users.front());
   }
 
-  if (table.RowsCount() > static_cast<size_t>(limit)) {
-    page.nextCursor = page.users.back().Entry;
+  if (request.Count != omnisphere::enums::UserCountMode::None) {
+    bool approximate = false;
+    page.totalCount = CountUsers(request.Count, approximate);
+    page.totalCountIsApproximate = approximate;
   }
 
   return page;
 }
 
+int User::CountUsers(omnisphere::enums::UserCountMode mode,
+                     bool &isApproximate) const {
+  // How long an approximate count may be served before it is refreshed
+  constexpr auto countTtl = std::chrono::seconds(60);
+
+  const auto now = std::chrono::steady_clock::now();
+  if (mode == omnisphere::enums::UserCountMode::Approximate) {
+    std::lock_guard<std::mutex> lock(countMutex);
+    if (cachedCount.has_value() && now - cachedCountAt < countTtl) {
+      isApproximate = true;
+      return cachedCount.value();
+    }
+  }
+
+  try {
+    auto conn = database->Acquire();
+    omnisphere::types::DataTable data = conn->FetchResults(
+        "SELECT COALESCE(COUNT(*), 0) AS Total FROM Users");
+
+    const int total = data.RowsCount() > 0 ? static_cast<int>(data[0]["Total"]) : 0;
+
+    std::lock_guard<std::mutex> lock(countMutex);
+    cachedCount = total;
+    cachedCountAt = now;
+    isApproximate = false;
+    return total;
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[CountUsers Exception] ") + e.what());
+  }
+}
+
+omnisphere::models::UserChangeSet
+User::GetChanges(const omnisphere::dtos::GetUserChanges &request) const {
+  if (request.Limit <= 0)
+    throw std::invalid_argument("[GetChanges] Limit must be greater than zero");
+
+  std::optional<long long> since;
+  if (request.Watermark.has_value() && !request.Watermark->empty())
+    since = DecodeWatermark(request.Watermark.value());
+
+  const omnisphere::enums::UserField fields =
+      request.Fields | omnisphere::enums::UserField::IsLocked |
+      omnisphere::enums::UserField::UpdateDate;
+
+  std::string sQuery = "SELECT TOP (?) " + SelectList(fields) +
+                       ", CONVERT(BIGINT, [Version]) AS ChangeVersion "
+                       "FROM Users WHERE [Version] < MIN_ACTIVE_ROWVERSION()";
+  std::vector<omnisphere::types::SQLParam> params = {
+      omnisphere::types::MakeSQLParam(request.Limit + 1)};
+
+  if (since.has_value()) {
+    // BINARY(8) of a BIGINT is big-endian, so it orders like the rowversion
+    sQuery += " AND [Version] > CONVERT(BINARY(8), CONVERT(BIGINT, ?))";
+    params.push_back(omnisphere::types::MakeSQLParam(since.value()));
+  }
+
+  sQuery += " ORDER BY [Version] ASC";
+
+  omnisphere::models::UserChangeSet changes;
+  changes.NextWatermark = request.Watermark.value_or("");
+
+  try {
+    auto conn = database->Acquire();
+    omnisphere::types::DataTable table = conn->FetchPrepared(sQuery, params);
+
+    const size_t rowLimit =
+        std::min<size_t>(table.RowsCount(), static_cast<size_t>(request.Limit));
+    changes.HasMore = table.RowsCount() > rowLimit;
+    changes.Changes.reserve(rowLimit);
+
+    for (size_t i = 0; i < rowLimit; ++i) {
+      omnisphere::models::UserChange change;
+      change.User = ToModel(table, i, fields);
+
+      // The lock state decides first: locking stamps UpdateDate like any
+      // other update, so the dates alone cannot tell a lock apart
+      if (change.User.IsLocked)
+        change.Kind = omnisphere::enums::UserChangeKind::Locked;
+      else if (!change.User.UpdateDate.has_value())
+        change.Kind = omnisphere::enums::UserChangeKind::Inserted;
+      else
+        change.Kind = omnisphere::enums::UserChangeKind::Updated;
+
+      changes.Changes.push_back(std::move(change));
+    }
+
+    if (rowLimit > 0)
+      changes.NextWatermark = EncodeWatermark(
+          static_cast<long long>(table[rowLimit - 1]["ChangeVersion"]));
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[GetChanges Exception] ") + e.what());
+  }
+
+  return changes;
+}
+
+bool User::UpdateLock(const omnisphere::enums::UserFilter &filter,
+                      const std::string &value, bool lock) const {
+  auto conn = database->Acquire();
+  try {
+    std::string sQuery =
+        "UPDATE Users SET IsLocked = ?, UpdateDate = SYSDATETIME() WHERE ";
+
+    switch (filter) {
+    case omnisphere::enums::UserFilter::Entry:
+      sQuery += "[Entry] = ?";
+      break;
+
+    case omnisphere::enums::UserFilter::Code:
+      sQuery += "[Code] = ?";
+      break;
+
+    case omnisphere::enums::UserFilter::Email:
+      sQuery += "Email = ?";
+      break;
+
+    case omnisphere::enums::UserFilter::Phone:
+      sQuery += "Phone = ?";
+      break;
+
+    default:
+      throw std::invalid_argument("Unsupported user filter");
+    }
+
+    const std::vector<omnisphere::types::SQLParam> params = {
+        omnisphere::types::MakeSQLParam(lock),
+        omnisphere::types::MakeSQLParam(value)};
+
+    conn->BeginTransaction();
+
+    if (!conn->RunPrepared(sQuery, params))
+      throw std::runtime_error("UpdateLock failed");
+
+    conn->CommitTransaction();
+
+    return true;
+  } catch (const std::exception &e) {
+    conn->RollbackTransaction();
+    throw std::runtime_error(std::string("[UpdateLock Exception]: ") +
+                             e.what());
+  }
+}
+
 bool User::ValidatePassword(const omnisphere::enums::UserFilter &searchFilter,
                             const std::string &filterValue,
                             const std::string &Password) const {
@@ -479,7 +1121,7 @@ bool User::ExistsEntry(const int &entry) const {
     if (data.RowsCount() == 0)
       return false;
 
-    return true;
+    return static_cast<int>(data[0]["Total"]) > 0;
   } catch (const std::exception &e) {
     throw std::runtime_error(e.what());
   }
@@ -496,10 +1138,101 @@ bool User::ExistsCode(const std::string &code) const {
     if (data.RowsCount() == 0)
       return false;
 
-    return true;
+    return static_cast<int>(data[0]["Total"]) > 0;
   } catch (const std::exception &e) {
     throw std::runtime_error(e.what());
   }
 }
 
+UserUniqueConflicts User::FindConflicts(const UserUniqueProbe &probe) const {
+  return FindConflicts(std::vector<UserUniqueProbe>{probe}).front();
+}
+
+std::vector<UserUniqueConflicts>
+User::FindConflicts(const std::vector<UserUniqueProbe> &probes) const {
+  // SQL Server accepts at most 2100 parameters per statement; each probe
+  // binds seven of them.
+  constexpr size_t maxProbesPerStatement = 280;
+
+  std::vector<UserUniqueConflicts> conflicts(probes.size());
+  if (probes.empty())
+    return conflicts;
+
+  auto conn = database->Acquire();
+  try {
+    for (size_t first = 0; first < probes.size();
+         first += maxProbesPerStatement) {
+      const size_t last =
+          std::min(probes.size(), first + maxProbesPerStatement);
+
+      std::string sQuery =
+          "SELECT c.Idx, "
+          "MAX(CASE WHEN u.[Code] = c.Code THEN 1 ELSE 0 END) AS CodeTaken, "
+          "MAX(CASE WHEN u.[Name] = c.Name THEN 1 ELSE 0 END) AS NameTaken, "
+          "MAX(CASE WHEN u.Email = c.Email THEN 1 ELSE 0 END) AS EmailTaken, "
+          "MAX(CASE WHEN u.Phone = c.Phone THEN 1 ELSE 0 END) AS PhoneTaken "
+          "FROM (VALUES ";
+      std::vector<omnisphere::types::SQLParam> params;
+      params.reserve((last - first) * 7);
+
+      for (size_t i = first; i < last; ++i) {
+        if (i > first)
+          sQuery += ", ";
+        sQuery += "(?, ?, ?, ?, ?, ?, ?)";
+
+        const UserUniqueProbe &probe = probes[i];
+        params.push_back(omnisphere::types::MakeSQLParam(static_cast<int>(i)));
+        params.push_back(omnisphere::types::MakeSQLParam(probe.Code));
+        params.push_back(omnisphere::types::MakeSQLParam(probe.Name));
+        params.push_back(omnisphere::types::MakeSQLParam(probe.Email));
+        params.push_back(omnisphere::types::MakeSQLParam(probe.Phone));
+        params.push_back(omnisphere::types::MakeSQLParam(probe.ExcludeEntry));
+        params.push_back(omnisphere::types::MakeSQLParam(probe.ExcludeCode));
+      }
+
+      sQuery += ") AS c(Idx, Code, Name, Email, Phone, ExcludeEntry, "
+                "ExcludeCode) "
+                "INNER JOIN Users u ON (u.[Code] = c.Code OR u.[Name] = c.Name "
+                "OR u.Email = c.Email OR u.Phone = c.Phone) "
+                "AND (c.ExcludeEntry IS NULL OR u.[Entry] <> c.ExcludeEntry) "
+                "AND (c.ExcludeCode IS NULL OR u.[Code] <> c.ExcludeCode) "
+                "GROUP BY c.Idx";
+
+      omnisphere::types::DataTable data = conn->FetchPrepared(sQuery, params);
+
+      for (size_t row = 0; row < data.RowsCount(); ++row) {
+        const int idx = data[row]["Idx"];
+        if (idx < 0 || static_cast<size_t>(idx) >= conflicts.size())
+          continue;
+
+        UserUniqueConflicts &c = conflicts[idx];
+        c.Code = static_cast<int>(data[row]["CodeTaken"]) > 0;
+        c.Name = static_cast<int>(data[row]["NameTaken"]) > 0;
+        c.Email = static_cast<int>(data[row]["EmailTaken"]) > 0;
+        c.Phone = static_cast<int>(data[row]["PhoneTaken"]) > 0;
+      }
+    }
+
+    if (probes.size() > 1) {
+      std::unordered_set<std::string> codes, names, emails, phones;
+      auto repeated = [](std::unordered_set<std::string> &seen,
+                         const std::optional<std::string> &value) {
+        return value.has_value() && !seen.insert(value.value()).second;
+      };
+
+      for (size_t i = 0; i < probes.size(); ++i) {
+        conflicts[i].Code |= repeated(codes, probes[i].Code);
+        conflicts[i].Name |= repeated(names, probes[i].Name);
+        conflicts[i].Email |= repeated(emails, probes[i].Email);
+        conflicts[i].Phone |= repeated(phones, probes[i].Phone);
+      }
+    }
+
+    return conflicts;
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[FindConflicts Exception] ") +
+                             e.what());
+  }
+}
+
 } // namespace omnisphere::repositories
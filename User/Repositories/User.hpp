@@ -2,11 +2,18 @@
 #include <OmniData/DataTable.hpp>
 #include <OmniData/DatabasePool.hpp>
 #include "User/DTOs/CreateUser.hpp"
+#include "User/DTOs/GetUserChanges.hpp"
+#include "User/DTOs/GetUserPage.hpp"
 #include "User/DTOs/SearchUsers.hpp"
 #include "User/DTOs/UpdateUser.hpp"
+#include "User/Enums/UserField.hpp"
 #include "User/Enums/UserFilter.hpp"
 #include "User/Models/User.hpp"
+#include "User/Models/UserBatch.hpp"
+#include "User/Models/UserChangeSet.hpp"
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <vector>
 
@@ -14,9 +21,32 @@ namespace omnisphere::repositories {
 
 struct UserCursorPage {
   std::vector<omnisphere::models::User> users;
-  std::optional<int> nextCursor;
+  std::optional<std::string> nextCursor;
+  std::optional<std::string> previousCursor;
+  bool hasNextPage = false;
   bool hasPreviousPage = false;
-  int totalCount = 0;
+  std::optional<int> totalCount;
+  bool totalCountIsApproximate = false;
+};
+
+// Candidate values for the unique columns of Users. Unset fields are not
+// probed; ExcludeEntry/ExcludeCode skip the row being modified.
+struct UserUniqueProbe {
+  std::optional<std::string> Code;
+  std::optional<std::string> Name;
+  std::optional<std::string> Email;
+  std::optional<std::string> Phone;
+  std::optional<int> ExcludeEntry;
+  std::optional<std::string> ExcludeCode;
+};
+
+struct UserUniqueConflicts {
+  bool Code = false;
+  bool Name = false;
+  bool Email = false;
+  bool Phone = false;
+
+  bool Any() const { return Code || Name || Email || Phone; }
 };
 
 class User {
@@ -24,8 +54,14 @@ private:
   std::shared_ptr<omnisphere::data::DatabasePool> database;
   int _UserEntry = -1;
 
+  mutable std::mutex countMutex;
+  mutable std::optional<int> cachedCount;
+  mutable std::chrono::steady_clock::time_point cachedCountAt;
+
   bool UpdateUserSequence() const;
   int GetCurrentSequence() const;
+  int CountUsers(omnisphere::enums::UserCountMode mode,
+                 bool &isApproximate) const;
 
 public:
   explicit User(std::shared_ptr<omnisphere::data::DatabasePool> database);
@@ -37,21 +73,70 @@ public:
   bool Update(const omnisphere::dtos::UpdateUser &user) const;
 
   omnisphere::types::DataTable
-  Read(const omnisphere::dtos::SearchUsers &user) const;
+  Read(const omnisphere::dtos::SearchUsers &user,
+       omnisphere::enums::UserField fields =
+           omnisphere::enums::UserField::All) const;
 
-  omnisphere::types::DataTable Read(const omnisphere::enums::UserFilter &filter,
-                                    const std::string &value) const;
+  omnisphere::types::DataTable
+  Read(const omnisphere::enums::UserFilter &filter, const std::string &value,
+       omnisphere::enums::UserField fields =
+           omnisphere::enums::UserField::All) const;
 
   // Batch lookup for DataLoader
-  omnisphere::types::DataTable GetByIds(const std::vector<int> &ids) const;
-
-  // Keyset pagination (cursor = Entry)
-  UserCursorPage GetPage(std::optional<int> afterEntry, int limit) const;
+  omnisphere::types::DataTable
+  GetByIds(const std::vector<int> &ids,
+           omnisphere::enums::UserField fields =
+               omnisphere::enums::UserField::All) const;
+
+  // SELECT list for the requested fields; Entry is always included
+  static std::string SelectList(omnisphere::enums::UserField fields);
+
+  // Maps one row of a projected read, touching only the requested fields
+  static omnisphere::models::User
+  ToModel(const omnisphere::types::DataTable &table, size_t row,
+          omnisphere::enums::UserField fields);
+
+  // Maps a whole projected read into a single arena-backed batch
+  static omnisphere::models::UserBatch
+  ToBatch(const omnisphere::types::DataTable &table,
+          omnisphere::enums::UserField fields);
+
+  // Search straight into a batch, fetched in Entry order in chunks so the
+  // whole result set is never held as a DataTable
+  omnisphere::models::UserBatch
+  ReadBatch(const omnisphere::dtos::SearchUsers &filter,
+            omnisphere::enums::UserField fields) const;
+
+  // GetByIds into a batch, one chunk of ids per round trip
+  omnisphere::models::UserBatch
+  GetBatchByIds(const std::vector<int> &ids,
+                omnisphere::enums::UserField fields) const;
+
+  // Keyset pagination over (SortBy, Entry) with opaque cursors
+  UserCursorPage GetPage(const omnisphere::dtos::GetUserPage &request) const;
+
+  // Users inserted or updated after the watermark, in rowversion order.
+  // Needs a ROWVERSION column [Version] on Users (indexed for large tables).
+  // Rows whose transaction may not have committed yet are held back until
+  // it has, so a late commit is never skipped.
+  omnisphere::models::UserChangeSet
+  GetChanges(const omnisphere::dtos::GetUserChanges &request) const;
+
+  bool UpdateLock(const omnisphere::enums::UserFilter &filter,
+                  const std::string &value, bool lock) const;
 
   bool ExistsEntry(const int &entry) const;
 
   bool ExistsCode(const std::string &code) const;
 
+  // Checks every supplied unique field in a single statement
+  UserUniqueConflicts FindConflicts(const UserUniqueProbe &probe) const;
+
+  // Batched form: one result per probe, in the same order. Values repeated
+  // inside the batch are reported as conflicts as well.
+  std::vector<UserUniqueConflicts>
+  FindConflicts(const std::vector<UserUniqueProbe> &probes) const;
+
   bool UpdatePassword(const omnisphere::enums::UserFilter &filter,
                       const std::string &value, const std::string &oldPassword,
                       const std::string &newPassword) const;
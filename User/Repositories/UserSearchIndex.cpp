@@ -0,0 +1,472 @@
+#include "User/Repositories/UserSearchIndex.hpp"
+#include <algorithm>
+#include <cwctype>
+#include <mutex>
+
+#ifndef _WIN32
+#include <locale.h>
+#include <wctype.h>
+#endif
+
+namespace omnisphere::repositories {
+
+namespace {
+enum Field { CodeField, NameField, EmailField, PhoneField };
+
+#ifndef _WIN32
+// towlower of the "C" locale only knows ASCII; a UTF-8 locale of our own
+// gives the full Unicode mapping without touching the process locale
+locale_t FoldLocale() {
+  static const locale_t locale = [] {
+    for (const char *name : {"C.UTF-8", "C.utf8", "en_US.UTF-8"})
+      if (locale_t l = newlocale(LC_CTYPE_MASK, name, locale_t(0)))
+        return l;
+    return locale_t(0);
+  }();
+  return locale;
+}
+#endif
+
+uint32_t FoldCodePoint(uint32_t cp) {
+  if (cp < 0x80)
+    return cp >= 'A' && cp <= 'Z' ? cp + ('a' - 'A') : cp;
+#ifdef _WIN32
+  return cp <= 0xFFFF ? static_cast<uint32_t>(towlower(static_cast<wint_t>(cp)))
+                      : cp;
+#else
+  const locale_t locale = FoldLocale();
+  return locale ? static_cast<uint32_t>(towlower_l(static_cast<wint_t>(cp), locale))
+                : cp;
+#endif
+}
+
+void AppendUtf8(std::string &out, uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | cp >> 6);
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | cp >> 12);
+    out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | cp >> 18);
+    out += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+    out += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+// Case folds UTF-8 text code point by code point. Bytes that are not valid
+// UTF-8 are copied unchanged, so odd data still matches itself.
+std::string ToLower(std::string_view s) {
+  std::string r;
+  r.reserve(s.size());
+  for (size_t i = 0; i < s.size();) {
+    const unsigned char c = static_cast<unsigned char>(s[i]);
+    size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3
+                                 : (c >> 3) == 0x1E ? 4 : 0;
+    uint32_t cp = length == 1 ? c : length == 2 ? c & 0x1F
+                                  : length == 3 ? c & 0x0F : c & 0x07;
+    for (size_t k = 1; k < length; ++k) {
+      const unsigned char next =
+          i + k < s.size() ? static_cast<unsigned char>(s[i + k]) : 0;
+      if ((next & 0xC0) != 0x80) {
+        length = 0;
+        break;
+      }
+      cp = cp << 6 | (next & 0x3F);
+    }
+    if (length == 0) {
+      r += s[i++];
+      continue;
+    }
+    AppendUtf8(r, FoldCodePoint(cp));
+    i += length;
+  }
+  return r;
+}
+
+// Keeps only the elements of `candidates` present in the sorted `list`
+void Intersect(std::vector<uint32_t> &candidates,
+               const std::vector<uint32_t> &list) {
+  auto out = candidates.begin();
+  if (list.size() > candidates.size() * 16) {
+    for (uint32_t id : candidates)
+      if (std::binary_search(list.begin(), list.end(), id))
+        *out++ = id;
+  } else {
+    auto it = list.begin();
+    for (uint32_t id : candidates) {
+      it = std::lower_bound(it, list.end(), id);
+      if (it == list.end())
+        break;
+      if (*it == id)
+        *out++ = id;
+    }
+  }
+  candidates.erase(out, candidates.end());
+}
+} // namespace
+
+std::vector<uint32_t> UserSearchIndex::Trigrams(int field,
+                                                std::string_view text) {
+  std::vector<uint32_t> keys;
+  if (text.size() < 3)
+    return keys;
+
+  keys.reserve(text.size() - 2);
+  for (size_t i = 0; i + 3 <= text.size(); ++i) {
+    keys.push_back(static_cast<uint32_t>(field) << 24 |
+                   static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16 |
+                   static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8 |
+                   static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2])));
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+std::vector<UserSearchIndex::Query>
+UserSearchIndex::ToQueries(const omnisphere::dtos::SearchUsers &f) {
+  std::vector<Query> queries;
+  auto add = [&](int field, const std::optional<std::string> &value,
+                 bool exact) {
+    if (value.has_value())
+      queries.push_back({field, ToLower(value.value()), exact});
+  };
+
+  add(CodeField, f.CodeEqualsTo, true);
+  add(CodeField, f.CodeContains, false);
+  add(NameField, f.NameEqualsTo, true);
+  add(NameField, f.NameContains, false);
+  add(EmailField, f.EmailEqualsTo, true);
+  add(EmailField, f.EmailContains, false);
+  add(PhoneField, f.PhoneEqualsTo, true);
+  add(PhoneField, f.PhoneContains, false);
+  return queries;
+}
+
+std::string_view UserSearchIndex::Original(const Document &doc,
+                                           int field) const {
+  return std::string_view(pool).substr(doc.Offset[field], doc.Length[field]);
+}
+
+std::string_view UserSearchIndex::Lower(const Document &doc, int field) const {
+  return std::string_view(pool).substr(doc.Offset[field] + doc.Length[field],
+                                       doc.FoldedLength[field]);
+}
+
+bool UserSearchIndex::Matches(const Document &doc,
+                              const std::vector<Query> &queries) const {
+  for (const Query &q : queries) {
+    if (doc.Length[q.Field] == nullLength)
+      return false;
+
+    std::string_view value = Lower(doc, q.Field);
+    if (q.Exact ? value != q.Value : value.find(q.Value) == std::string_view::npos)
+      return false;
+  }
+  return true;
+}
+
+void UserSearchIndex::Store(Document &doc,
+                            const omnisphere::models::User &user) {
+  const std::string *values[fieldCount] = {
+      &user.Code, user.Name ? &user.Name.value() : nullptr,
+      user.Email ? &user.Email.value() : nullptr,
+      user.Phone ? &user.Phone.value() : nullptr};
+
+  doc.Entry = user.Entry;
+  doc.Alive = true;
+
+  for (int field = 0; field < fieldCount; ++field) {
+    const std::string *value = values[field];
+    if (value == nullptr) {
+      doc.Offset[field] = 0;
+      doc.Length[field] = nullLength;
+      doc.FoldedLength[field] = 0;
+      continue;
+    }
+
+    const size_t length =
+        std::min<size_t>(value->size(), static_cast<size_t>(nullLength - 1));
+    std::string folded = ToLower(std::string_view(value->data(), length));
+    if (folded.size() > static_cast<size_t>(nullLength - 1))
+      folded.resize(nullLength - 1);
+    doc.Offset[field] = static_cast<uint32_t>(pool.size());
+    doc.Length[field] = static_cast<uint16_t>(length);
+    doc.FoldedLength[field] = static_cast<uint16_t>(folded.size());
+    pool.append(value->data(), length);
+    pool += folded;
+  }
+}
+
+void UserSearchIndex::Index(uint32_t docId, bool add) {
+  const Document &doc = documents[docId];
+
+  for (int field = 0; field < fieldCount; ++field) {
+    if (doc.Length[field] == nullLength)
+      continue;
+
+    for (uint32_t key : Trigrams(field, Lower(doc, field))) {
+      if (add) {
+        std::vector<uint32_t> &list = postings[key];
+        if (list.empty() || list.back() < docId)
+          list.push_back(docId);
+        else
+          list.insert(std::lower_bound(list.begin(), list.end(), docId), docId);
+        continue;
+      }
+
+      auto it = postings.find(key);
+      if (it == postings.end())
+        continue;
+
+      std::vector<uint32_t> &list = it->second;
+      auto pos = std::lower_bound(list.begin(), list.end(), docId);
+      if (pos != list.end() && *pos == docId)
+        list.erase(pos);
+      if (list.empty())
+        postings.erase(it);
+    }
+  }
+}
+
+void UserSearchIndex::Compact() {
+  if (garbageBytes < pool.size() / 2)
+    return;
+
+  std::string compacted;
+  compacted.reserve(pool.size() - garbageBytes);
+
+  for (Document &doc : documents) {
+    if (!doc.Alive)
+      continue;
+
+    for (int field = 0; field < fieldCount; ++field) {
+      if (doc.Length[field] == nullLength)
+        continue;
+
+      const uint32_t offset = static_cast<uint32_t>(compacted.size());
+      compacted.append(pool, doc.Offset[field],
+                       doc.Length[field] + doc.FoldedLength[field]);
+      doc.Offset[field] = offset;
+    }
+  }
+
+  pool.swap(compacted);
+  garbageBytes = 0;
+}
+
+void UserSearchIndex::Build(const std::vector<omnisphere::models::User> &users) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+
+  documents.clear();
+  entryToDocument.clear();
+  postings.clear();
+  pool.clear();
+  garbageBytes = 0;
+
+  documents.reserve(users.size());
+  entryToDocument.reserve(users.size());
+
+  for (const omnisphere::models::User &user : users) {
+    if (entryToDocument.count(user.Entry))
+      continue;
+
+    const uint32_t docId = static_cast<uint32_t>(documents.size());
+    documents.emplace_back();
+    Store(documents.back(), user);
+    entryToDocument.emplace(user.Entry, docId);
+    Index(docId, true);
+  }
+
+  aliveCount = documents.size();
+}
+
+void UserSearchIndex::Upsert(const omnisphere::models::User &user) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+
+  auto it = entryToDocument.find(user.Entry);
+  if (it == entryToDocument.end()) {
+    const uint32_t docId = static_cast<uint32_t>(documents.size());
+    documents.emplace_back();
+    Store(documents.back(), user);
+    entryToDocument.emplace(user.Entry, docId);
+    Index(docId, true);
+    ++aliveCount;
+    return;
+  }
+
+  const uint32_t docId = it->second;
+  Document &doc = documents[docId];
+  Index(docId, false);
+  for (int field = 0; field < fieldCount; ++field)
+    if (doc.Length[field] != nullLength)
+      garbageBytes += doc.Length[field] + doc.FoldedLength[field];
+
+  Store(doc, user);
+  Index(docId, true);
+  Compact();
+}
+
+void UserSearchIndex::Remove(int entry) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+
+  auto it = entryToDocument.find(entry);
+  if (it == entryToDocument.end())
+    return;
+
+  const uint32_t docId = it->second;
+  Document &doc = documents[docId];
+  Index(docId, false);
+  for (int field = 0; field < fieldCount; ++field)
+    if (doc.Length[field] != nullLength)
+      garbageBytes += doc.Length[field] + doc.FoldedLength[field];
+
+  doc.Alive = false;
+  entryToDocument.erase(it);
+  --aliveCount;
+  Compact();
+}
+
+bool UserSearchIndex::Collect(const omnisphere::dtos::SearchUsers &filter,
+                              std::vector<uint32_t> &docIds,
+                              size_t limit) const {
+  const std::vector<Query> queries = ToQueries(filter);
+
+  std::vector<const std::vector<uint32_t> *> lists;
+  for (const Query &q : queries) {
+    for (uint32_t key : Trigrams(q.Field, q.Value)) {
+      auto it = postings.find(key);
+      if (it == postings.end())
+        return true;
+      lists.push_back(&it->second);
+    }
+  }
+
+  std::vector<uint32_t> candidates;
+  if (lists.empty()) {
+    // Queries shorter than a trigram fall back to a scan of the documents
+    for (uint32_t docId = 0; docId < documents.size(); ++docId) {
+      if (!documents[docId].Alive || !Matches(documents[docId], queries))
+        continue;
+      if (candidates.size() == limit)
+        return false;
+      candidates.push_back(docId);
+    }
+    docIds.swap(candidates);
+    return true;
+  }
+
+  std::sort(lists.begin(), lists.end(),
+            [](const auto *a, const auto *b) { return a->size() < b->size(); });
+
+  // Intersecting very common trigrams costs more than verifying the shortest
+  // list directly, which can also stop as soon as the limit is exceeded
+  constexpr size_t maxIntersectedPosting = 1 << 16;
+
+  const std::vector<uint32_t> *source = lists.front();
+  if (source->size() <= maxIntersectedPosting) {
+    candidates = *source;
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i)
+      Intersect(candidates, *lists[i]);
+    source = &candidates;
+  }
+
+  std::vector<uint32_t> matched;
+  for (uint32_t docId : *source) {
+    if (!Matches(documents[docId], queries))
+      continue;
+    if (matched.size() == limit)
+      return false;
+    matched.push_back(docId);
+  }
+
+  docIds.swap(matched);
+  return true;
+}
+
+bool UserSearchIndex::Search(const omnisphere::dtos::SearchUsers &filter,
+                             std::vector<int> &entries, size_t limit) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+
+  std::vector<uint32_t> docIds;
+  if (!Collect(filter, docIds, limit))
+    return false;
+
+  entries.clear();
+  entries.reserve(docIds.size());
+  for (uint32_t docId : docIds)
+    entries.push_back(documents[docId].Entry);
+  std::sort(entries.begin(), entries.end());
+  return true;
+}
+
+bool UserSearchIndex::Search(const omnisphere::dtos::SearchUsers &filter,
+                             std::vector<omnisphere::models::User> &users,
+                             size_t limit) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+
+  std::vector<uint32_t> docIds;
+  if (!Collect(filter, docIds, limit))
+    return false;
+
+  std::sort(docIds.begin(), docIds.end(), [&](uint32_t a, uint32_t b) {
+    return documents[a].Entry < documents[b].Entry;
+  });
+
+  users.clear();
+  users.reserve(docIds.size());
+  for (uint32_t docId : docIds) {
+    const Document &doc = documents[docId];
+    omnisphere::models::User user;
+    user.Entry = doc.Entry;
+    user.Code = std::string(Original(doc, CodeField));
+    if (doc.Length[NameField] != nullLength)
+      user.Name = std::string(Original(doc, NameField));
+    if (doc.Length[EmailField] != nullLength)
+      user.Email = std::string(Original(doc, EmailField));
+    if (doc.Length[PhoneField] != nullLength)
+      user.Phone = std::string(Original(doc, PhoneField));
+    users.push_back(std::move(user));
+  }
+  return true;
+}
+
+size_t UserSearchIndex::Size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return aliveCount;
+}
+
+UserSearchIndexMemory UserSearchIndex::Memory() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+
+  // Approximate per-node cost of the unordered_map node allocations
+  constexpr size_t nodeOverhead = 2 * sizeof(void *);
+
+  UserSearchIndexMemory memory;
+  memory.Users = aliveCount;
+  memory.Trigrams = postings.size();
+
+  memory.PostingBytes = postings.bucket_count() * sizeof(void *);
+  for (const auto &[key, list] : postings)
+    memory.PostingBytes += sizeof(std::pair<const uint32_t, std::vector<uint32_t>>) +
+                           nodeOverhead + list.capacity() * sizeof(uint32_t);
+
+  memory.StringBytes = pool.capacity();
+
+  memory.DocumentBytes =
+      documents.capacity() * sizeof(Document) +
+      entryToDocument.bucket_count() * sizeof(void *) +
+      entryToDocument.size() *
+          (sizeof(std::pair<const int, uint32_t>) + nodeOverhead);
+
+  memory.TotalBytes =
+      memory.PostingBytes + memory.StringBytes + memory.DocumentBytes;
+  return memory;
+}
+
+} // namespace omnisphere::repositories
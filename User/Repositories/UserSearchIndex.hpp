@@ -0,0 +1,95 @@
+#pragma once
+#include "User/DTOs/SearchUsers.hpp"
+#include "User/Models/User.hpp"
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace omnisphere::repositories {
+
+struct UserSearchIndexMemory {
+  size_t Users = 0;
+  size_t Trigrams = 0;
+  size_t PostingBytes = 0;
+  size_t StringBytes = 0;
+  size_t DocumentBytes = 0;
+  size_t TotalBytes = 0;
+};
+
+// In-memory trigram index over Code, Name, Email and Phone. Contains and
+// equality filters are answered by intersecting posting lists and then
+// verifying the candidates, matching case-insensitively like the default
+// SQL Server collation (Unicode case folding, accents significant).
+class UserSearchIndex {
+public:
+  UserSearchIndex() = default;
+  ~UserSearchIndex() = default;
+
+  // Replaces the whole index; only Entry, Code, Name, Email and Phone are read
+  void Build(const std::vector<omnisphere::models::User> &users);
+
+  void Upsert(const omnisphere::models::User &user);
+
+  void Remove(int entry);
+
+  // Entries matching every filter that is set, in ascending Entry order.
+  // Returns false without touching `entries` when more than `limit` match.
+  bool Search(const omnisphere::dtos::SearchUsers &filter,
+              std::vector<int> &entries, size_t limit = SIZE_MAX) const;
+
+  // Same as Search but materializes Entry, Code, Name, Email and Phone
+  bool Search(const omnisphere::dtos::SearchUsers &filter,
+              std::vector<omnisphere::models::User> &users,
+              size_t limit = SIZE_MAX) const;
+
+  size_t Size() const;
+
+  UserSearchIndexMemory Memory() const;
+
+private:
+  static constexpr int fieldCount = 4;
+  static constexpr uint16_t nullLength = UINT16_MAX;
+
+  // Each field is stored in `pool` as its original text immediately
+  // followed by the case-folded copy used for matching, which can differ in
+  // length for non-ASCII text.
+  struct Document {
+    int Entry = 0;
+    bool Alive = false;
+    uint32_t Offset[fieldCount] = {};
+    uint16_t Length[fieldCount] = {nullLength, nullLength, nullLength,
+                                   nullLength};
+    uint16_t FoldedLength[fieldCount] = {};
+  };
+
+  struct Query {
+    int Field;
+    std::string Value;
+    bool Exact;
+  };
+
+  mutable std::shared_mutex mutex;
+  std::vector<Document> documents;
+  std::unordered_map<int, uint32_t> entryToDocument;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+  std::string pool;
+  size_t garbageBytes = 0;
+  size_t aliveCount = 0;
+
+  static std::vector<uint32_t> Trigrams(int field, std::string_view text);
+  static std::vector<Query> ToQueries(const omnisphere::dtos::SearchUsers &f);
+
+  std::string_view Original(const Document &doc, int field) const;
+  std::string_view Lower(const Document &doc, int field) const;
+  bool Matches(const Document &doc, const std::vector<Query> &queries) const;
+
+  void Store(Document &doc, const omnisphere::models::User &user);
+  void Index(uint32_t docId, bool add);
+  void Compact();
+  bool Collect(const omnisphere::dtos::SearchUsers &filter,
+               std::vector<uint32_t> &docIds, size_t limit) const;
+};
+} // namespace omnisphere::repositories
@@ -1,14 +1,54 @@
+#include <mutex>
 #include <stdexcept>
 
-#include "Enums/PermissionMode.hpp"
 #include "Repositories/User.hpp"
+#include "Repositories/UserSearchIndex.hpp"
 #include "User.hpp"
 
 namespace omnisphere::services {
+namespace {
+// Fields the search index can return without a round trip to the database
+constexpr omnisphere::enums::UserField indexedFields =
+    omnisphere::enums::UserField::Entry | omnisphere::enums::UserField::Code |
+    omnisphere::enums::UserField::Name | omnisphere::enums::UserField::Email |
+    omnisphere::enums::UserField::Phone;
+
+// Larger index hits go to SQL instead of an oversized GetByIds statement
+constexpr size_t maxIndexedResults = 2000;
+} // namespace
+
 struct User::Impl {
   std::shared_ptr<omnisphere::repositories::User> user;
+  std::mutex indexMutex;
+  std::shared_ptr<omnisphere::repositories::UserSearchIndex> index;
+
+  // While EnableSearchIndex reads its snapshot, writes are logged here and
+  // replayed into the new index before it is published
+  uint64_t buildGeneration = 0;
+  bool building = false;
+  std::vector<omnisphere::models::User> buildLog;
+
   explicit Impl(std::shared_ptr<omnisphere::data::DatabasePool> db)
       : user(std::make_shared<omnisphere::repositories::User>(db)) {}
+
+  std::shared_ptr<omnisphere::repositories::UserSearchIndex> SearchIndex() {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return index;
+  }
+
+  // Called after the write is committed, with the user as stored
+  void Indexed(const omnisphere::models::User &stored) {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if (index)
+      index->Upsert(stored);
+    if (building)
+      buildLog.push_back(stored);
+  }
+
+  bool Indexing() {
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return index || building;
+  }
 };
 
 User::User(std::shared_ptr<omnisphere::data::DatabasePool> db)
@@ -18,25 +58,35 @@ User::~User() = default;
 
 bool User::Add(const omnisphere::dtos::CreateUser &newUser) const {
   try {
-    if (Exists(omnisphere::enums::UserFilter::Code, newUser.Code))
+    omnisphere::repositories::UserUniqueProbe probe;
+    probe.Code = newUser.Code;
+    probe.Name = newUser.Name;
+    probe.Phone = newUser.Phone;
+    probe.Email = newUser.Email;
+
+    const omnisphere::repositories::UserUniqueConflicts conflicts =
+        pimpl->user->FindConflicts(probe);
+
+    if (conflicts.Code)
       throw std::runtime_error("Code already exists");
 
-    if (newUser.Name.has_value() &&
-        Exists(omnisphere::enums::UserFilter::Name, newUser.Name.value()))
+    if (conflicts.Name)
       throw std::runtime_error("Name already exists");
 
-    if (newUser.Phone.has_value() &&
-        Exists(omnisphere::enums::UserFilter::Phone, newUser.Phone.value()))
+    if (conflicts.Phone)
       throw std::runtime_error("Phone already exists");
 
-    if (newUser.Email.has_value() &&
-        Exists(omnisphere::enums::UserFilter::Email, newUser.Email.value()))
+    if (conflicts.Email)
       throw std::runtime_error("Email already exists");
 
-    if (pimpl->user->Create(newUser))
-      return true;
+    if (!pimpl->user->Create(newUser))
+      return false;
 
-    return false;
+    if (pimpl->Indexing())
+      pimpl->Indexed(Get(omnisphere::enums::UserFilter::Code, newUser.Code,
+                         indexedFields));
+
+    return true;
   } catch (const std::exception &e) {
     throw std::runtime_error(std::string("[UserExeption] ") + e.what());
   }
@@ -49,22 +99,38 @@ User::Modify(const omnisphere::dtos::UpdateUser &uUser) const {
         !Exists(omnisphere::enums::UserFilter::Code, uUser.Where.Code.value()))
       throw std::invalid_argument("User Code doesn't exists");
 
-    if (uUser.Data.Email.has_value() &&
-        Exists(omnisphere::enums::UserFilter::Email, uUser.Data.Email.value()))
-      throw std::runtime_error("UserEmail already exists");
+    if (uUser.Data.Email.has_value() || uUser.Data.Name.has_value() ||
+        uUser.Data.Phone.has_value()) {
+      omnisphere::repositories::UserUniqueProbe probe;
+      probe.Email = uUser.Data.Email;
+      probe.Name = uUser.Data.Name;
+      probe.Phone = uUser.Data.Phone;
+      probe.ExcludeEntry = uUser.Where.Entry;
+      probe.ExcludeCode = uUser.Where.Code;
 
-    if (uUser.Data.Name.has_value() &&
-        Exists(omnisphere::enums::UserFilter::Name, uUser.Data.Name.value()))
-      throw std::runtime_error("UserName already exists");
+      const omnisphere::repositories::UserUniqueConflicts conflicts =
+          pimpl->user->FindConflicts(probe);
 
-    if (uUser.Data.Phone.has_value() &&
-        Exists(omnisphere::enums::UserFilter::Phone, uUser.Data.Phone.value()))
-      throw std::runtime_error("User Phone already exists");
+      if (conflicts.Email)
+        throw std::runtime_error("UserEmail already exists");
+
+      if (conflicts.Name)
+        throw std::runtime_error("UserName already exists");
+
+      if (conflicts.Phone)
+        throw std::runtime_error("User Phone already exists");
+    }
 
     if (!pimpl->user->Update(uUser))
       throw std::runtime_error("User wasn't modified");
 
-    return Get(omnisphere::enums::UserFilter::Code, uUser.Where.Code.value());
+    omnisphere::models::User modified =
+        Get(omnisphere::enums::UserFilter::Code, uUser.Where.Code.value());
+
+    if (pimpl->Indexing())
+      pimpl->Indexed(modified);
+
+    return modified;
 
   } catch (const std::exception &e) {
     throw std::runtime_error(std::string("[ModifyUser Exeption] ") + e.what());
@@ -110,143 +176,95 @@ bool User::CheckPassword(const omnisphere::enums::UserFilter &filter,
 
 bool User::LockUnlockUser(const omnisphere::enums::UserFilter &filter,
                           const std::string &value, const bool &lock) const {
-  return true;
+  try {
+    return pimpl->user->UpdateLock(filter, value, lock);
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[LockUnlockUser Exception] ") +
+                             e.what());
+  }
 }
 
 std::vector<omnisphere::models::User>
-User::Search(const omnisphere::dtos::SearchUsers &user) const {
+User::Search(const omnisphere::dtos::SearchUsers &user,
+             omnisphere::enums::UserField fields) const {
   try {
-    omnisphere::types::DataTable dataTable = pimpl->user->Read(user);
-    std::vector<omnisphere::models::User> vUsers;
-
-    for (size_t i = 0; i < dataTable.RowsCount(); i++) {
-      omnisphere::models::User UserData;
-
-      UserData.Entry = dataTable[i]["UserEntry"];
-      UserData.Code = static_cast<std::string>(dataTable[i]["Code"]);
-
-      if (!dataTable[i]["Name"].IsNull())
-        UserData.Name = static_cast<std::string>(dataTable[i]["Name"]);
-
-      if (!dataTable[i]["Email"].IsNull())
-        UserData.Email = static_cast<std::string>(dataTable[i]["Email"]);
-
-      if (!dataTable[i]["Phone"].IsNull())
-        UserData.Phone = static_cast<std::string>(dataTable[i]["Phone"]);
-
-      if (!dataTable[i]["EmpEntry"].IsNull())
-        UserData.Employee = static_cast<int>(dataTable[i]["EmpEntry"]);
-
-      if (!dataTable[i]["RoleEntry"].IsNull())
-        UserData.RoleEntry = static_cast<int>(dataTable[i]["RoleEntry"]);
-
-      if (!dataTable[i]["MaxDisccountPerLine"].IsNull())
-        UserData.MaxDisccountPerLine =
-            static_cast<double>(dataTable[i]["MaxDisccountPerLine"]);
-
-      if (!dataTable[i]["MaxDisccountPerDocument"].IsNull())
-        UserData.MaxDisccountPerDocument =
-            static_cast<double>(dataTable[i]["MaxDisccountPerDocument"]);
-
-      if (!dataTable[i]["PermissionMode"].IsNull()) {
-        std::string mode =
-            static_cast<std::string>(dataTable[i]["PermissionMode"]);
-        UserData.PermissionMode = mode == "P"
-                                      ? omnisphere::enums::PermissionMode::P
-                                      : omnisphere::enums::PermissionMode::M;
+    if (auto index = pimpl->SearchIndex()) {
+      const bool narrow = (static_cast<uint32_t>(fields) &
+                           ~static_cast<uint32_t>(indexedFields)) == 0;
+      if (narrow) {
+        std::vector<omnisphere::models::User> vUsers;
+        if (index->Search(user, vUsers, maxIndexedResults))
+          return vUsers;
+      } else {
+        std::vector<int> entries;
+        if (index->Search(user, entries, maxIndexedResults))
+          return entries.empty() ? std::vector<omnisphere::models::User>{}
+                                 : GetByIds(entries, fields);
       }
+    }
 
-      if (!dataTable[i]["Department"].IsNull())
-        UserData.Department = static_cast<int>(dataTable[i]["Department"]);
-
-      UserData.SuperUser = dataTable[i]["SuperUser"];
-      UserData.IsLocked = dataTable[i]["IsLocked"];
-      UserData.IsActive = dataTable[i]["IsActive"];
-      UserData.PasswordNeverExpires = dataTable[i]["PasswordNeverExpires"];
-      UserData.ChangePasswordNextLogin = dataTable[i]["ChangePasswordNextLogin"];
-      UserData.CreatedBy = dataTable[i]["CreatedBy"];
-      UserData.CreateDate = static_cast<std::string>(dataTable[i]["CreateDate"]);
+    omnisphere::types::DataTable dataTable = pimpl->user->Read(user, fields);
+    std::vector<omnisphere::models::User> vUsers;
+    vUsers.reserve(dataTable.RowsCount());
 
-      if (!dataTable[i]["LastUpdatedBy"].IsNull())
-        UserData.LastUpdatedBy = static_cast<int>(dataTable[i]["LastUpdatedBy"]);
+    for (size_t i = 0; i < dataTable.RowsCount(); i++)
+      vUsers.push_back(
+          omnisphere::repositories::User::ToModel(dataTable, i, fields));
 
-      if (!dataTable[i]["UpdateDate"].IsNull())
-        UserData.UpdateDate =
-            static_cast<std::string>(dataTable[i]["UpdateDate"]);
+    return vUsers;
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[SearchUser Exception] ") + e.what());
+  }
+}
 
-      vUsers.push_back(UserData);
+omnisphere::models::UserBatch
+User::SearchBatch(const omnisphere::dtos::SearchUsers &user,
+                  omnisphere::enums::UserField fields) const {
+  try {
+    if (auto index = pimpl->SearchIndex()) {
+      std::vector<int> entries;
+      if (index->Search(user, entries, maxIndexedResults))
+        return pimpl->user->GetBatchByIds(entries, fields);
     }
 
-    return vUsers;
+    return pimpl->user->ReadBatch(user, fields);
   } catch (const std::exception &e) {
-    throw std::runtime_error(std::string("[SearchUser Exception] ") + e.what());
+    throw std::runtime_error(std::string("[SearchUserBatch Exception] ") +
+                             e.what());
   }
 }
 
 omnisphere::models::User User::Get(const omnisphere::enums::UserFilter &filter,
-                                   const std::string &value) const {
+                                   const std::string &value,
+                                   omnisphere::enums::UserField fields) const {
   try {
-    omnisphere::types::DataTable dataTable = pimpl->user->Read(filter, value);
+    omnisphere::types::DataTable dataTable =
+        pimpl->user->Read(filter, value, fields);
     if (dataTable.RowsCount() == 0)
       throw std::invalid_argument("User not found");
 
-    omnisphere::models::User UserData;
-
-    UserData.Entry = dataTable[0]["UserEntry"];
-    UserData.Code = static_cast<std::string>(dataTable[0]["Code"]);
-
-    if (!dataTable[0]["Name"].IsNull())
-      UserData.Name = static_cast<std::string>(dataTable[0]["Name"]);
-
-    if (!dataTable[0]["Email"].IsNull())
-      UserData.Email = static_cast<std::string>(dataTable[0]["Email"]);
-
-    if (!dataTable[0]["Phone"].IsNull())
-      UserData.Phone = static_cast<std::string>(dataTable[0]["Phone"]);
-
-    if (!dataTable[0]["EmpEntry"].IsNull())
-      UserData.Employee = static_cast<int>(dataTable[0]["EmpEntry"]);
-
-    if (!dataTable[0]["RoleEntry"].IsNull())
-      UserData.RoleEntry = static_cast<int>(dataTable[0]["RoleEntry"]);
-
-    if (!dataTable[0]["MaxDisccountPerLine"].IsNull())
-      UserData.MaxDisccountPerLine =
-          static_cast<double>(dataTable[0]["MaxDisccountPerLine"]);
-
-    if (!dataTable[0]["MaxDisccountPerDocument"].IsNull())
-      UserData.MaxDisccountPerDocument =
-          static_cast<double>(dataTable[0]["MaxDisccountPerDocument"]);
-
-    if (!dataTable[0]["PermissionMode"].IsNull()) {
-      std::string mode =
-          static_cast<std::string>(dataTable[0]["PermissionMode"]);
-      UserData.PermissionMode = mode == "P"
-                                    ? omnisphere::enums::PermissionMode::P
-                                    : omnisphere::enums::PermissionMode::M;
-    }
-
-    if (!dataTable[0]["Department"].IsNull())
-      UserData.Department = static_cast<int>(dataTable[0]["Department"]);
-
-    UserData.SuperUser = dataTable[0]["SuperUser"];
-    UserData.IsLocked = dataTable[0]["IsLocked"];
-    UserData.IsActive = dataTable[0]["IsActive"];
-    UserData.PasswordNeverExpires = dataTable[0]["PasswordNeverExpires"];
-    UserData.ChangePasswordNextLogin = dataTable[0]["ChangePasswordNextLogin"];
-    UserData.CreatedBy = dataTable[0]["CreatedBy"];
-    UserData.CreateDate = static_cast<std::string>(dataTable[0]["CreateDate"]);
+    return omnisphere::repositories::User::ToModel(dataTable, 0, fields);
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[GetUser Exception] ") + e.what());
+  }
+}
 
-    if (!dataTable[0]["LastUpdatedBy"].IsNull())
-      UserData.LastUpdatedBy = static_cast<int>(dataTable[0]["LastUpdatedBy"]);
+std::vector<omnisphere::models::User>
+User::GetByIds(const std::vector<int> &ids,
+               omnisphere::enums::UserField fields) const {
+  try {
+    omnisphere::types::DataTable dataTable = pimpl->user->GetByIds(ids, fields);
+    std::vector<omnisphere::models::User> vUsers;
+    vUsers.reserve(dataTable.RowsCount());
 
-    if (!dataTable[0]["UpdateDate"].IsNull())
-      UserData.UpdateDate =
-          static_cast<std::string>(dataTable[0]["UpdateDate"]);
+    for (size_t i = 0; i < dataTable.RowsCount(); i++)
+      vUsers.push_back(
+          omnisphere::repositories::User::ToModel(dataTable, i, fields));
 
-    return UserData;
+    return vUsers;
   } catch (const std::exception &e) {
-    throw std::runtime_error(std::string("[GetUser Exception] ") + e.what());
+    throw std::runtime_error(std::string("[GetUsersByIds Exception] ") +
+                             e.what());
   }
 }
 
@@ -260,6 +278,24 @@ bool User::Exists(const omnisphere::enums::UserFilter &filter,
     case omnisphere::enums::UserFilter::Code:
       return pimpl->user->ExistsCode(value);
 
+    case omnisphere::enums::UserFilter::Name: {
+      omnisphere::repositories::UserUniqueProbe probe;
+      probe.Name = value;
+      return pimpl->user->FindConflicts(probe).Name;
+    }
+
+    case omnisphere::enums::UserFilter::Email: {
+      omnisphere::repositories::UserUniqueProbe probe;
+      probe.Email = value;
+      return pimpl->user->FindConflicts(probe).Email;
+    }
+
+    case omnisphere::enums::UserFilter::Phone: {
+      omnisphere::repositories::UserUniqueProbe probe;
+      probe.Phone = value;
+      return pimpl->user->FindConflicts(probe).Phone;
+    }
+
     default:
       return false;
     }
@@ -268,9 +304,95 @@ bool User::Exists(const omnisphere::enums::UserFilter &filter,
   }
 }
 
+omnisphere::models::UserChangeSet
+User::ChangesSince(const omnisphere::dtos::GetUserChanges &request) const {
+  try {
+    return pimpl->user->GetChanges(request);
+  } catch (const std::exception &e) {
+    throw std::runtime_error(std::string("[ChangesSince Exception] ") +
+                             e.what());
+  }
+}
+
+std::string User::ChangesSince(
+    const omnisphere::dtos::GetUserChanges &request,
+    const std::function<bool(const omnisphere::models::UserChangeSet &)> &sink)
+    const {
+  omnisphere::dtos::GetUserChanges page = request;
+  while (true) {
+    omnisphere::models::UserChangeSet changes = ChangesSince(page);
+    if (!changes.Changes.empty() && !sink(changes))
+      return changes.NextWatermark;
+    if (!changes.HasMore)
+      return changes.NextWatermark;
+    page.Watermark = changes.NextWatermark;
+  }
+}
+
+void User::EnableSearchIndex() const {
+  uint64_t generation;
+  {
+    // Logging starts before the snapshot is read: a write the read misses
+    // is in the log, one it sees is replayed harmlessly
+    std::lock_guard<std::mutex> lock(pimpl->indexMutex);
+    generation = ++pimpl->buildGeneration;
+    pimpl->building = true;
+    pimpl->buildLog.clear();
+  }
+
+  try {
+    omnisphere::types::DataTable dataTable =
+        pimpl->user->Read(omnisphere::dtos::SearchUsers{}, indexedFields);
+
+    std::vector<omnisphere::models::User> users;
+    users.reserve(dataTable.RowsCount());
+    for (size_t i = 0; i < dataTable.RowsCount(); i++)
+      users.push_back(
+          omnisphere::repositories::User::ToModel(dataTable, i, indexedFields));
+
+    auto index = std::make_shared<omnisphere::repositories::UserSearchIndex>();
+    index->Build(users);
+
+    std::lock_guard<std::mutex> lock(pimpl->indexMutex);
+    if (pimpl->buildGeneration != generation)
+      return; // Disabled or enabled again meanwhile
+    for (const omnisphere::models::User &stored : pimpl->buildLog)
+      index->Upsert(stored);
+    pimpl->index = std::move(index);
+    pimpl->building = false;
+    pimpl->buildLog.clear();
+    pimpl->buildLog.shrink_to_fit();
+  } catch (const std::exception &e) {
+    {
+      std::lock_guard<std::mutex> lock(pimpl->indexMutex);
+      if (pimpl->buildGeneration == generation) {
+        pimpl->building = false;
+        pimpl->buildLog.clear();
+      }
+    }
+    throw std::runtime_error(std::string("[EnableSearchIndex Exception] ") +
+                             e.what());
+  }
+}
+
+void User::DisableSearchIndex() const {
+  std::lock_guard<std::mutex> lock(pimpl->indexMutex);
+  ++pimpl->buildGeneration;
+  pimpl->building = false;
+  pimpl->buildLog.clear();
+  pimpl->index.reset();
+}
+
+std::optional<omnisphere::repositories::UserSearchIndexMemory>
+User::SearchIndexMemory() const {
+  if (auto index = pimpl->SearchIndex())
+    return index->Memory();
+  return std::nullopt;
+}
+
 omnisphere::repositories::UserCursorPage
-User::GetPage(std::optional<int> afterEntry, int limit) const {
-  return pimpl->user->GetPage(afterEntry, limit);
+User::GetPage(const omnisphere::dtos::GetUserPage &request) const {
+  return pimpl->user->GetPage(request);
 }
 
 } // namespace omnisphere::services
\ No newline at end of file
@@ -1,14 +1,21 @@
 #pragma once
 
 #include <OmniData/DatabasePool.hpp>
+#include <functional>
 
 #include "DTOs/ChangePassword.hpp"
 #include "DTOs/CreateUser.hpp"
+#include "DTOs/GetUserChanges.hpp"
+#include "DTOs/GetUserPage.hpp"
 #include "DTOs/SearchUsers.hpp"
 #include "DTOs/UpdateUser.hpp"
+#include "Enums/UserField.hpp"
 #include "Enums/UserFilter.hpp"
 #include "Models/User.hpp"
+#include "Models/UserBatch.hpp"
+#include "Models/UserChangeSet.hpp"
 #include "Repositories/User.hpp"
+#include "Repositories/UserSearchIndex.hpp"
 
 namespace omnisphere::services {
 class User {
@@ -27,14 +34,45 @@ public:
   bool LockUnlockUser(const omnisphere::enums::UserFilter &filter,
                       const std::string &value, const bool &lock) const;
   std::vector<omnisphere::models::User>
-  Search(const omnisphere::dtos::SearchUsers &user) const;
+  Search(const omnisphere::dtos::SearchUsers &user,
+         omnisphere::enums::UserField fields =
+             omnisphere::enums::UserField::All) const;
+  // Bulk variant of Search backed by a single string arena
+  omnisphere::models::UserBatch
+  SearchBatch(const omnisphere::dtos::SearchUsers &user,
+              omnisphere::enums::UserField fields =
+                  omnisphere::enums::UserField::All) const;
   omnisphere::models::User Get(const omnisphere::enums::UserFilter &filter,
-                               const std::string &value) const;
+                               const std::string &value,
+                               omnisphere::enums::UserField fields =
+                                   omnisphere::enums::UserField::All) const;
+  std::vector<omnisphere::models::User>
+  GetByIds(const std::vector<int> &ids,
+           omnisphere::enums::UserField fields =
+               omnisphere::enums::UserField::All) const;
   bool Exists(const omnisphere::enums::UserFilter &filter,
               const std::string &value) const;
 
+  // One page of users inserted, updated or locked after the watermark
+  omnisphere::models::UserChangeSet
+  ChangesSince(const omnisphere::dtos::GetUserChanges &request) const;
+
+  // Walks every page, stopping early when the sink returns false. Returns
+  // the watermark to resume from.
+  std::string ChangesSince(
+      const omnisphere::dtos::GetUserChanges &request,
+      const std::function<bool(const omnisphere::models::UserChangeSet &)>
+          &sink) const;
+
+  // Serves Search from an in-memory trigram index kept current by Add and
+  // Modify. Building reads Entry, Code, Name, Email and Phone of every user.
+  void EnableSearchIndex() const;
+  void DisableSearchIndex() const;
+  std::optional<omnisphere::repositories::UserSearchIndexMemory>
+  SearchIndexMemory() const;
+
   omnisphere::repositories::UserCursorPage
-  GetPage(std::optional<int> afterEntry, int limit) const;
+  GetPage(const omnisphere::dtos::GetUserPage &request) const;
 
 private:
   struct Impl;